@@ -1,5 +1,5 @@
 #include <stdio.h>
 #include "esp_spiffs.h"
+#include "ixora_storage.h"
 
-void mount_spiffs(void);
 void load_font(uint8_t *load_font);
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//Asset storage. The font and the images live in one of three backends,
+//picked by storage_mount at start up:
+//  STORAGE_SPIFFS    the "storage" partition through esp_spiffs
+//  STORAGE_LITTLEFS  the "littlefs" partition through esp_littlefs
+//  STORAGE_RAW       the "assets" partition, the files packed one after the
+//                    other by tools/pack_assets.py, memory mapped and read
+//                    through a small read-only VFS driver, no file system
+//Every backend is mounted at STORAGE_BASE_PATH, so the /spiffs paths of
+//FONT_FILE, load_image, load_jpeg and the rest work unchanged whichever one
+//is mounted. The three partitions are built from spiffs_image and flashed
+//with the app. STORAGE_RAW cannot write: record_start fails on it.
+
+#define STORAGE_BASE_PATH "/spiffs"
+#define STORAGE_MAX_FILES 5 //open at the same time
+
+typedef enum {
+    STORAGE_SPIFFS,
+    STORAGE_LITTLEFS,
+    STORAGE_RAW,
+    STORAGE_COUNT
+} storage_backend_t;
+
+bool storage_mount(storage_backend_t backend);
+void storage_unmount(void);
+bool storage_mounted(storage_backend_t *backend);
+const char *storage_name(storage_backend_t backend);
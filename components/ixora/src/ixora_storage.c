@@ -0,0 +1,340 @@
+#include "ixora_storage.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_littlefs.h"
+#include "esp_partition.h"
+#include "esp_vfs.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+
+static const char *TAG = "storage";
+
+#define SPIFFS_LABEL "storage"
+#define LITTLEFS_LABEL "littlefs"
+#define RAW_LABEL "assets"
+#define RAW_SUBTYPE 0x40 //data partition subtype of "assets" in partitions.csv
+#define RAW_MAGIC 0x54535341 //"ASST", see tools/pack_assets.py
+#define RAW_VERSION 1
+#define RAW_NAME_LEN 24
+
+typedef struct {
+    const char *name;
+    bool (*mount)(void);
+    void (*unmount)(void);
+} storage_ops_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t size; //of the whole image, header included
+} raw_header_t;
+
+typedef struct {
+    char name[RAW_NAME_LEN];
+    uint32_t offset; //from the start of the partition
+    uint32_t size;
+} raw_entry_t;
+
+static struct {
+    const uint8_t *base;
+    const raw_entry_t *entries;
+    uint16_t count;
+    esp_partition_mmap_handle_t handle;
+    struct {
+        const raw_entry_t *entry; //NULL when the descriptor is free
+        uint32_t pos;
+    } files[STORAGE_MAX_FILES];
+} raw;
+
+static int8_t mounted = -1;
+
+
+static void log_info(esp_err_t ret, size_t total, size_t used) {
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to get partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %lu, used: %lu", (unsigned long)total, (unsigned long)used);
+    }
+}
+
+/**
+ * @brief Mounts the SPIFFS partition, formatting it if it cannot be mounted.
+ */
+static bool spiffs_mount(void) {
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = STORAGE_BASE_PATH,
+        .partition_label = SPIFFS_LABEL,
+        .max_files = STORAGE_MAX_FILES,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGE(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return false;
+    }
+
+    size_t total = 0, used = 0;
+    log_info(esp_spiffs_info(SPIFFS_LABEL, &total, &used), total, used);
+    return true;
+}
+
+static void spiffs_unmount(void) {
+    esp_vfs_spiffs_unregister(SPIFFS_LABEL);
+}
+
+/**
+ * @brief Mounts the LittleFS partition, formatting it if it cannot be mounted.
+ */
+static bool littlefs_mount(void) {
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = STORAGE_BASE_PATH,
+        .partition_label = LITTLEFS_LABEL,
+        .format_if_mount_failed = true,
+        .dont_mount = false
+    };
+
+    esp_err_t ret = esp_vfs_littlefs_register(&conf);
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find LittleFS partition");
+        } else {
+            ESP_LOGE(TAG, "Failed to initialize LittleFS (%s)", esp_err_to_name(ret));
+        }
+        return false;
+    }
+
+    size_t total = 0, used = 0;
+    log_info(esp_littlefs_info(LITTLEFS_LABEL, &total, &used), total, used);
+    return true;
+}
+
+static void littlefs_unmount(void) {
+    esp_vfs_littlefs_unregister(LITTLEFS_LABEL);
+}
+
+static const raw_entry_t *raw_find(const char *path) {
+    if (*path == '/') path++;
+    for (uint16_t i = 0; i < raw.count; i++) {
+        if (strcmp(raw.entries[i].name, path) == 0) return &raw.entries[i];
+    }
+    return NULL;
+}
+
+static int raw_open(const char *path, int flags, int mode) {
+    if ((flags & O_ACCMODE) != O_RDONLY) {
+        errno = EROFS;
+        return -1;
+    }
+    const raw_entry_t *entry = raw_find(path);
+    if (entry == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    for (int fd = 0; fd < STORAGE_MAX_FILES; fd++) {
+        if (raw.files[fd].entry == NULL) {
+            raw.files[fd].entry = entry;
+            raw.files[fd].pos = 0;
+            return fd;
+        }
+    }
+    errno = ENFILE;
+    return -1;
+}
+
+static bool raw_valid(int fd) {
+    if (fd < 0 || fd >= STORAGE_MAX_FILES || raw.files[fd].entry == NULL) {
+        errno = EBADF;
+        return false;
+    }
+    return true;
+}
+
+static ssize_t raw_read(int fd, void *dst, size_t size) {
+    if (!raw_valid(fd)) return -1;
+    const raw_entry_t *entry = raw.files[fd].entry;
+    uint32_t pos = raw.files[fd].pos;
+    if (pos >= entry->size) return 0;
+    if (size > entry->size - pos) size = entry->size - pos;
+    memcpy(dst, raw.base + entry->offset + pos, size);
+    raw.files[fd].pos = pos + size;
+    return size;
+}
+
+static off_t raw_lseek(int fd, off_t offset, int whence) {
+    if (!raw_valid(fd)) return -1;
+    off_t base = (whence == SEEK_SET) ? 0
+               : (whence == SEEK_CUR) ? (off_t)raw.files[fd].pos
+               : (whence == SEEK_END) ? (off_t)raw.files[fd].entry->size
+               : -1;
+    if (base < 0 || base + offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    raw.files[fd].pos = base + offset;
+    return raw.files[fd].pos;
+}
+
+static int raw_close(int fd) {
+    if (!raw_valid(fd)) return -1;
+    raw.files[fd].entry = NULL;
+    return 0;
+}
+
+static void raw_fill_stat(const raw_entry_t *entry, struct stat *st) {
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFREG | 0444;
+    st->st_size = entry->size;
+}
+
+static int raw_fstat(int fd, struct stat *st) {
+    if (!raw_valid(fd)) return -1;
+    raw_fill_stat(raw.files[fd].entry, st);
+    return 0;
+}
+
+static int raw_stat(const char *path, struct stat *st) {
+    const raw_entry_t *entry = raw_find(path);
+    if (entry == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    raw_fill_stat(entry, st);
+    return 0;
+}
+
+static const esp_vfs_t raw_vfs = {
+    .flags = ESP_VFS_FLAG_DEFAULT,
+    .open = &raw_open,
+    .read = &raw_read,
+    .lseek = &raw_lseek,
+    .close = &raw_close,
+    .fstat = &raw_fstat,
+    .stat = &raw_stat,
+};
+
+/**
+ * @brief Maps the packed "assets" partition and registers the VFS driver
+ * that reads it.
+ *
+ * The header is checked before anything is mapped and the file table right
+ * after, so a partition that was never flashed, or was packed by another
+ * version of tools/pack_assets.py, fails to mount instead of returning
+ * garbage. Reads are a memcpy from the mapped flash, through the cache.
+ */
+static bool raw_mount(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, RAW_SUBTYPE, RAW_LABEL);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Failed to find raw assets partition");
+        return false;
+    }
+
+    raw_header_t header;
+    esp_err_t ret = esp_partition_read(part, 0, &header, sizeof(header));
+    if (ret != ESP_OK || header.magic != RAW_MAGIC || header.version != RAW_VERSION ||
+        header.size > part->size || sizeof(header) + (size_t)header.count * sizeof(raw_entry_t) > header.size) {
+        ESP_LOGE(TAG, "No packed assets in partition %s", RAW_LABEL);
+        return false;
+    }
+
+    const void *base;
+    ret = esp_partition_mmap(part, 0, header.size, ESP_PARTITION_MMAP_DATA, &base, &raw.handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition %s (%s)", RAW_LABEL, esp_err_to_name(ret));
+        return false;
+    }
+    raw.base = base;
+    raw.entries = (const raw_entry_t *)(raw.base + sizeof(header));
+    raw.count = header.count;
+    memset(raw.files, 0, sizeof(raw.files));
+
+    for (uint16_t i = 0; i < raw.count; i++) {
+        const raw_entry_t *e = &raw.entries[i];
+        if (memchr(e->name, 0, RAW_NAME_LEN) == NULL || e->offset > header.size || e->size > header.size - e->offset) {
+            ESP_LOGE(TAG, "Corrupt file table in partition %s", RAW_LABEL);
+            esp_partition_munmap(raw.handle);
+            return false;
+        }
+    }
+
+    ret = esp_vfs_register(STORAGE_BASE_PATH, &raw_vfs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register raw assets (%s)", esp_err_to_name(ret));
+        esp_partition_munmap(raw.handle);
+        return false;
+    }
+    ESP_LOGI(TAG, "Raw assets: %u files, %lu bytes mapped", raw.count, (unsigned long)header.size);
+    return true;
+}
+
+static void raw_unmount(void) {
+    esp_vfs_unregister(STORAGE_BASE_PATH);
+    esp_partition_munmap(raw.handle);
+    memset(&raw, 0, sizeof(raw));
+}
+
+static const storage_ops_t backends[STORAGE_COUNT] = {
+    [STORAGE_SPIFFS] = {"spiffs", spiffs_mount, spiffs_unmount},
+    [STORAGE_LITTLEFS] = {"littlefs", littlefs_mount, littlefs_unmount},
+    [STORAGE_RAW] = {"raw", raw_mount, raw_unmount},
+};
+
+
+/**
+ * @brief Mounts an asset backend at STORAGE_BASE_PATH.
+ *
+ * The backend mounted before, if any, is unmounted first; files still open
+ * on it must be closed by then.
+ *
+ * @param backend The storage to read the assets from.
+ * @return false if the backend could not be mounted; nothing is mounted then.
+ */
+bool storage_mount(storage_backend_t backend) {
+    if (backend >= STORAGE_COUNT) return false;
+    if (mounted == backend) return true;
+    storage_unmount();
+    if (!backends[backend].mount()) return false;
+    mounted = backend;
+    ESP_LOGI(TAG, "Assets on %s", backends[backend].name);
+    return true;
+}
+
+/**
+ * @brief Unmounts the current backend, if any.
+ */
+void storage_unmount(void) {
+    if (mounted < 0) return;
+    backends[mounted].unmount();
+    mounted = -1;
+}
+
+/**
+ * @brief Tells which backend is mounted.
+ *
+ * @param backend Set to the mounted backend; may be NULL.
+ * @return false if none is.
+ */
+bool storage_mounted(storage_backend_t *backend) {
+    if (mounted < 0) return false;
+    if (backend) *backend = mounted;
+    return true;
+}
+
+/**
+ * @brief The short name of a backend, for logs.
+ */
+const char *storage_name(storage_backend_t backend) {
+    return (backend < STORAGE_COUNT) ? backends[backend].name : "?";
+}
@@ -1,13 +1,13 @@
+#pragma once
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
-#include "driver/gpio.h"
-#include "driver/spi_master.h"
 #include "esp_log.h"
 #include "freertos/task.h"
 #include "freertos/FreeRTOS.h"
 #include "esp_system.h"
-#include "driver/ledc.h"
+#include "esp_attr.h"
 #include "ixora.h"
 
 #define TFT_CS 5
@@ -54,6 +54,26 @@
 #define TFT_WIDTH 135
 #define WINDOW_PIXEL TFT_HEIGHT * TFT_WIDTH
 
+//frame buffer format: 16 = RGB565, 8 or 4 = palette indices expanded at flush (st7789_indexed.h)
+#ifndef FRAME_BUFFER_BPP
+#define FRAME_BUFFER_BPP 16
+#endif
+//1 = per-stage cycle counters and the FPS overlay (st7789_perf.h), 0 = compiled out
+#ifndef ST7789_PERF
+#define ST7789_PERF 0
+#endif
+//1 = bus transaction recorder (st7789_trace.h), 0 = compiled out
+#ifndef ST7789_TRACE
+#define ST7789_TRACE 0
+#endif
+//1 = draw call recorder (st7789_record.h), 0 = compiled out; replay is always built
+#ifndef ST7789_RECORD
+#define ST7789_RECORD 0
+#endif
+#define DIRECT_FILL_CHUNK 1024 //pixels per queued solid-color transaction
+#define DIRECT_FILL_QUEUE 4 //transactions in flight
+#define FLUSH_RECT_CHUNK 512 //pixels per transfer of flush_frame_buffer_rect
+
 //backlight
 #define SPEED_MODE LEDC_HIGH_SPEED_MODE
 #define TIMER_NUM LEDC_TIMER_0
@@ -73,9 +93,11 @@
 
 #define FONT_FILE   "/spiffs/font.bin"  
 
+//two RGB565 pixels stored as one 32-bit word, allowed to alias uint16_t pixels
+typedef uint32_t __attribute__((__may_alias__)) pixel_pair_t;
+
 
 void RESET();
-void spi_init();
 void send_data(const uint8_t* data, size_t size);
 void send_word(uint16_t data);
 void send_cmd(uint8_t cmd);
@@ -86,9 +108,17 @@ void set_window(uint16_t x1, uint16_t x2, uint16_t y1, uint16_t y2);
 uint16_t rgb888_to_rgb565(uint8_t r, uint8_t g, uint8_t b);
 void draw_pixel(uint16_t x, uint16_t y, uint16_t color);
 void draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+void draw_hline(int16_t x0, int16_t x1, int16_t y, uint16_t color);
 void send_color(uint16_t * color, uint16_t size);
 void load_image(const char* path);
+bool read_image(const char *path, uint16_t *pixels);
+void fill_rect_direct(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color);
+void direct_fill_keep_frame_buffer(bool enable);
 void flush_frame_buffer();
+void flush_frame_buffer_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 void clear_frame_buffer(uint16_t color);
+uint16_t *get_frame_buffer(void);
+void fill_pixels(uint16_t *dst, uint32_t count, uint16_t color);
+void fill_pixels_strided(uint16_t *dst, uint32_t count, uint32_t stride, uint16_t color);
 void draw_char_scaled(uint16_t x, uint16_t y, char c, uint16_t color, uint8_t scale, uint8_t *font);
 void draw_text_scaled(uint16_t x, uint16_t y, const char *text, uint16_t color, uint8_t scale, uint8_t *font_data);
\ No newline at end of file
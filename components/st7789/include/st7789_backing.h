@@ -0,0 +1,42 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_region.h"
+
+//Backing store for small objects moving over a static background. Before an
+//object is drawn, backing_save copies the frame buffer under its bounding box
+//aside; backing_restore puts that background back when the object moves or
+//goes away. Both add their box to the frame's region list, so backing_flush
+//sends only the old and the new boxes of the objects that moved (merged into
+//their union when they overlap, as in st7789_region.h) and a frame costs in
+//proportion to the area of the objects, not of the screen.
+//
+//With several objects the restores must run in the reverse order of the
+//saves, so that an object overlapping another one gets back the background
+//and not the other object. A frame is then:
+//
+//    backing_begin();
+//    for (i = n - 1; i >= 0; i--) backing_restore(&objects[i]);
+//    for (i = 0; i < n; i++) { backing_save(&objects[i], ...); draw object i; }
+//    backing_flush();
+//
+//Works with every frame buffer format: the store keeps raw frame buffer
+//bytes. At 4 bpp a saved row is padded to whole bytes, which only rewrites
+//neighbouring pixels with the values they had when saved.
+
+typedef struct {
+    uint8_t *pixels; //frame buffer bytes under the box, row by row
+    uint16_t max_width, max_height;
+    region_rect_t box; //where the object was drawn, inclusive
+    bool saved; //the box holds the background under a drawn object
+} backing_t;
+
+bool backing_init(backing_t *b, uint16_t max_width, uint16_t max_height);
+void backing_free(backing_t *b);
+void backing_forget(backing_t *b);
+void backing_begin(void);
+void backing_restore(backing_t *b);
+bool backing_save(backing_t *b, int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+uint16_t backing_flush(void);
+#if FRAME_BUFFER_BPP == 16
+bool backing_load(const char *path);
+#endif
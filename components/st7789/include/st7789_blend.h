@@ -0,0 +1,60 @@
+#pragma once
+#include "st7789.h"
+
+//RGB565 spread over 32 bits as ------GGGGGG-----RRRRR------BBBBB so every
+//channel has room for a 5-bit multiply without touching its neighbour
+#define BLEND_SPREAD_MASK 0x07E0F81F
+//two packed pixels: even fields (B0, R0, G1) and odd fields (G0, B1, R1) shifted down by 5
+#define BLEND_PAIR_MASK_EVEN 0x07E0F81F
+#define BLEND_PAIR_MASK_ODD 0x07C0F83F
+
+#define ALPHA5_OPAQUE 32
+
+//8-bit alpha (0-255) to blend weight (0-32)
+#define ALPHA8_TO_5(a) (((a) + 4) >> 3)
+//5-bit mask value (0-31) to blend weight (0-32)
+#define MASK5_TO_ALPHA5(m) ((m) + ((m) >> 4))
+
+
+/**
+ * @brief Blends one RGB565 pixel over another with a single multiply.
+ *
+ * @param fg The source pixel.
+ * @param bg The destination pixel.
+ * @param alpha Blend weight of the source, 0 to ALPHA5_OPAQUE.
+ * @return The blended pixel.
+ */
+static inline uint16_t blend565(uint16_t fg, uint16_t bg, uint32_t alpha) {
+    uint32_t f = (fg | ((uint32_t)fg << 16)) & BLEND_SPREAD_MASK;
+    uint32_t b = (bg | ((uint32_t)bg << 16)) & BLEND_SPREAD_MASK;
+    uint32_t r = ((((f - b) * alpha) >> 5) + b) & BLEND_SPREAD_MASK;
+    return (uint16_t)(r | (r >> 16));
+}
+
+/**
+ * @brief Blends two packed RGB565 pixels over two others.
+ *
+ * The word is split into two sets of non-adjacent fields, so two pixels cost
+ * two multiplies instead of six.
+ *
+ * @param fg Two source pixels.
+ * @param bg Two destination pixels.
+ * @param alpha Blend weight of the source, 0 to ALPHA5_OPAQUE.
+ * @return The two blended pixels.
+ */
+static inline uint32_t blend565x2(uint32_t fg, uint32_t bg, uint32_t alpha) {
+    uint32_t f0 = fg & BLEND_PAIR_MASK_EVEN;
+    uint32_t b0 = bg & BLEND_PAIR_MASK_EVEN;
+    uint32_t f1 = (fg >> 5) & BLEND_PAIR_MASK_ODD;
+    uint32_t b1 = (bg >> 5) & BLEND_PAIR_MASK_ODD;
+    uint32_t r0 = ((((f0 - b0) * alpha) >> 5) + b0) & BLEND_PAIR_MASK_EVEN;
+    uint32_t r1 = ((((f1 - b1) * alpha) >> 5) + b1) & BLEND_PAIR_MASK_ODD;
+    return r0 | (r1 << 5);
+}
+
+void blend_fill(uint16_t *dst, uint32_t count, uint16_t color, uint8_t alpha);
+void blend_row(uint16_t *dst, const uint16_t *src, uint32_t count, uint8_t alpha);
+void blend_row_alpha8(uint16_t *dst, const uint16_t *src, const uint8_t *alpha, uint32_t count);
+void blend_row_mask5(uint16_t *dst, const uint16_t *src, const uint8_t *mask, uint32_t count);
+void blend_color_mask5(uint16_t *dst, uint16_t color, const uint8_t *mask, uint32_t count);
+void fill_rect_alpha(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha);
@@ -0,0 +1,21 @@
+#pragma once
+#include "st7789.h"
+
+//RGB565 bitmap in frame buffer pixel order, optionally with an 8-bit alpha plane
+typedef struct {
+    const uint16_t *pixels;
+    const uint8_t *alpha; //same layout as pixels, NULL when the sprite has no alpha
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride; //pixels per source row, 0 means width
+} sprite_t;
+
+//source rectangle selecting the whole sprite
+#define BLIT_FULL_W 0xFFFF
+#define BLIT_FULL_H 0xFFFF
+
+void blit(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy);
+void blit_keyed(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy, uint16_t key);
+void blit_alpha(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy);
+void blit_blend(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy, uint8_t alpha);
+void draw_sprite(const sprite_t *src, int16_t dx, int16_t dy);
@@ -0,0 +1,44 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_region.h"
+
+//Layer compositor, RGB565 frame buffer only. A fixed stack of COMP_LAYERS
+//layers, 0 at the bottom, each an RGB565 bitmap owned by the caller with a
+//position on screen and a mode: opaque, color keyed, or alpha (a constant
+//alpha, times an 8-bit alpha plane when there is one). Every layer tracks
+//its own dirty rectangles: moving or showing a layer dirties its old and new
+//bounds, and writing its pixels through comp_layer_fill, comp_layer_text or
+//comp_layer_invalidate dirties just that part.
+//
+//comp_update recomposites only the dirty rectangles into the frame buffer
+//and sends them with flush_frame_buffer_rect. Every row of a rectangle is
+//resolved top-down: the walk stops at the first opaque layer that covers the
+//whole row span, and only that layer and the ones above it are drawn, bottom
+//up. Spans no layer covers get the background color.
+
+#if FRAME_BUFFER_BPP == 16
+
+#define COMP_LAYERS 4
+
+typedef enum {
+    COMP_OPAQUE,
+    COMP_KEYED, //pixels equal to the key are transparent
+    COMP_ALPHA
+} comp_mode_t;
+
+void comp_init(uint16_t background);
+void comp_layer_attach(uint8_t layer, uint16_t *pixels, const uint8_t *alpha, uint16_t width, uint16_t height,
+                       comp_mode_t mode);
+void comp_layer_detach(uint8_t layer);
+bool comp_layer_load(uint8_t layer, const char *path);
+void comp_layer_move(uint8_t layer, int16_t x, int16_t y);
+void comp_layer_show(uint8_t layer, bool visible);
+void comp_layer_set_key(uint8_t layer, uint16_t key);
+void comp_layer_set_alpha(uint8_t layer, uint8_t alpha);
+void comp_layer_invalidate(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+void comp_layer_fill(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+void comp_layer_text(uint8_t layer, int16_t x, int16_t y, const char *text, uint16_t color, uint8_t scale,
+                     const uint8_t *font);
+uint16_t comp_update(void);
+
+#endif
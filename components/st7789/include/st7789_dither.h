@@ -0,0 +1,36 @@
+#pragma once
+#include "st7789.h"
+
+//Bulk RGB888 to RGB565 conversion, a row or a whole buffer per call, into
+//RGB565 values or straight into panel byte order (high byte first, what
+//send_color and the flushes put on the wire). Three modes:
+//  DITHER_NONE       truncation, the same values as rgb888_to_rgb565
+//  DITHER_ORDERED    4x4 Bayer threshold added before truncating
+//  DITHER_DIFFUSION  Floyd-Steinberg, left to right, with a one-line error
+//                    buffer of 3 x width int16 per converter
+//Rows are converted top to bottom; the converter remembers the row for the
+//Bayer matrix and the error carried to the next row. All arithmetic is
+//integer and tools/image.py does exactly the same, so an image converted
+//offline is bit-identical to the same RGB888 rows converted on the device.
+
+#define DITHER_BAYER_SIZE 4
+
+typedef enum {
+    DITHER_NONE,
+    DITHER_ORDERED,
+    DITHER_DIFFUSION
+} dither_mode_t;
+
+typedef struct {
+    dither_mode_t mode;
+    uint16_t width;
+    uint16_t row; //rows converted since the last reset, picks the Bayer row
+    int16_t *error; //diffusion: error for the next row, r g b per pixel, in 1/16
+} dither_t;
+
+bool dither_init(dither_t *d, dither_mode_t mode, uint16_t width);
+void dither_free(dither_t *d);
+void dither_reset(dither_t *d);
+void rgb888_to_rgb565_row(dither_t *d, const uint8_t *rgb, uint16_t *out);
+void rgb888_to_rgb565_row_panel(dither_t *d, const uint8_t *rgb, uint8_t *out);
+bool rgb888_to_rgb565_buffer(dither_mode_t mode, const uint8_t *rgb, uint16_t *out, uint16_t width, uint16_t height);
@@ -0,0 +1,64 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_blit.h"
+
+//Retained display list. The dl_* calls do not touch the frame buffer: they
+//append commands to a list that dl_flush rasterizes one screen tile at a
+//time into a small tile buffer and queues straight to the panel, so a full
+//frame needs two tile buffers (DL_TILE_WIDTH * DL_TILE_HEIGHT * 2 bytes each,
+//one drawn while the other is sent) instead of a whole frame of pixels.
+//
+//At flush every command is binned by the tiles its bounding box covers. In
+//each tile rasterization starts at the topmost opaque command covering the
+//whole tile (rectangles, sprites and circles containing it), so whatever it
+//hides is never drawn. Every tile also keeps a signature of the commands
+//touching it, and a tile whose signature is the same as at the previous
+//flush is neither drawn nor sent. The list stays across flushes: commands
+//can be moved, recolored or hidden through their handle and only the tiles
+//they leave and enter are redrawn. Rebuilding the same list after dl_reset
+//gives the same signatures, so rebuilding every frame skips unchanged tiles
+//just as well.
+//
+//Colors are RGB565 whatever FRAME_BUFFER_BPP is. Text is copied into the
+//list; sprites and fonts are referenced and must stay valid until the list is
+//reset. Changes to sprite pixels and anything drawn on the panel by other
+//means (flush_frame_buffer, fill_rect_direct) are not seen by the
+//signatures: call dl_invalidate to redraw every tile at the next flush.
+
+#ifndef DL_TILE_WIDTH
+#define DL_TILE_WIDTH 45
+#endif
+#ifndef DL_TILE_HEIGHT
+#define DL_TILE_HEIGHT 30
+#endif
+#ifndef DL_MAX_COMMANDS
+#define DL_MAX_COMMANDS 128
+#endif
+#define DL_TEXT_POOL 512 //bytes of text kept by the list
+
+#define DL_TILES_X ((TFT_WIDTH + DL_TILE_WIDTH - 1) / DL_TILE_WIDTH)
+#define DL_TILES_Y ((TFT_HEIGHT + DL_TILE_HEIGHT - 1) / DL_TILE_HEIGHT)
+
+typedef int16_t dl_handle_t; //command index, -1 when the command was not added
+
+typedef struct {
+    uint32_t commands; //in the list
+    uint32_t tiles_drawn;
+    uint32_t tiles_skipped; //unchanged since the previous flush
+    uint32_t commands_drawn; //command and tile pairs rasterized
+    uint32_t commands_culled; //command and tile pairs hidden under an opaque command
+    uint32_t bytes; //pixel bytes sent
+} dl_stats_t;
+
+void dl_reset(uint16_t background);
+dl_handle_t dl_rect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+dl_handle_t dl_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+dl_handle_t dl_text(int16_t x, int16_t y, const char *text, uint16_t color, uint8_t scale, const uint8_t *font);
+dl_handle_t dl_sprite(const sprite_t *sprite, int16_t x, int16_t y);
+dl_handle_t dl_sprite_keyed(const sprite_t *sprite, int16_t x, int16_t y, uint16_t key);
+void dl_move(dl_handle_t handle, int16_t dx, int16_t dy);
+void dl_set_color(dl_handle_t handle, uint16_t color);
+void dl_set_visible(dl_handle_t handle, bool visible);
+void dl_invalidate(void);
+void dl_flush(void);
+void dl_get_stats(dl_stats_t *out);
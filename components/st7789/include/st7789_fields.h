@@ -0,0 +1,24 @@
+#pragma once
+#include "st7789.h"
+
+//Static per-pixel fields for animated effects. A field map holds one 8-bit
+//phase per pixel in frame buffer order, where 256 is one full cycle through
+//the effect colors. Anything that does not depend on time is computed once
+//into the map, and every frame is just phase + offset looked up in a table.
+
+#define FIELD_MAP_SIZE (TFT_WIDTH * TFT_HEIGHT)
+#define FIELD_LUT_SIZE 256
+
+//one spatial sine wave, angle steps in binary angle units * 256 per pixel
+typedef struct {
+    int32_t step_x;
+    int32_t step_y;
+} field_wave_t;
+
+void field_radius(uint8_t *map, int16_t cx, int16_t cy, uint16_t period);
+void field_angle(uint8_t *map, int16_t cx, int16_t cy, uint8_t repeats);
+void field_tunnel(uint8_t *map, uint16_t depth);
+void field_sines(uint8_t *map, const field_wave_t *waves, uint8_t count, uint16_t gain);
+void field_lut_cycle(uint16_t *lut, const uint16_t *colors, uint8_t count);
+void field_render_rows(const uint8_t *map, uint8_t offset, const uint16_t *lut, int16_t first, int16_t last);
+void field_render(const uint8_t *map, uint8_t offset, const uint16_t *lut);
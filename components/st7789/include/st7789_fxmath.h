@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+//Q16.16 fixed point
+typedef int32_t fx16_t;
+#define FX_SHIFT 16
+#define FX_ONE (1 << FX_SHIFT)
+#define FX_FROM_INT(i) ((fx16_t)(i) << FX_SHIFT)
+#define FX_FROM_FLOAT(f) ((fx16_t)((f) * FX_ONE))
+#define FX_TO_INT(x) ((x) >> FX_SHIFT)
+#define FX_MUL(a, b) ((fx16_t)(((int64_t)(a) * (b)) >> FX_SHIFT))
+
+//Binary angles: 65536 units per turn, so wrap-around is free in a uint16_t
+#define FX_ANGLE_TURN 65536
+#define FX_ANGLE_PER_RAD 10430 //65536 / (2 * pi)
+#define FX_ANGLE_FROM_DEG(d) ((uint16_t)(((int32_t)(d) * FX_ANGLE_TURN) / 360))
+#define FX_ANGLE_FROM_RAD(r) ((uint16_t)(int32_t)((r) * 10430.378f))
+
+//sin and cos return Q1.15, -32767 to 32767
+#define FX_TRIG_ONE 32767
+
+//table sizes, must match tools/gen_fxmath_tables.py
+#define FX_SIN_BITS 10
+#define FX_ATAN_BITS 8
+#define FX_LOG_BITS 8
+
+#define FX_LN2 45426 //ln(2) in Q16
+
+int16_t fx_sin(uint16_t angle);
+int16_t fx_cos(uint16_t angle);
+uint16_t fx_atan2(int32_t y, int32_t x);
+uint32_t fx_isqrt(uint32_t x);
+fx16_t fx_sqrt(fx16_t x);
+fx16_t fx_log2(fx16_t x);
+fx16_t fx_ln(fx16_t x);
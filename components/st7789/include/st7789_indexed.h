@@ -0,0 +1,17 @@
+#pragma once
+#include "st7789.h"
+
+//Indexed frame buffer. Build with FRAME_BUFFER_BPP set to 8 or 4 and every
+//drawing function takes a palette index instead of an RGB565 color.
+
+#if FRAME_BUFFER_BPP == 8 || FRAME_BUFFER_BPP == 4
+
+#define PALETTE_SIZE (1 << FRAME_BUFFER_BPP)
+#define INDEX_BUFFER_SIZE ((TFT_WIDTH * TFT_HEIGHT * FRAME_BUFFER_BPP) / 8)
+
+void palette_set(uint16_t first, const uint16_t *colors, uint16_t count);
+uint16_t palette_get(uint8_t index);
+void palette_rotate(uint8_t first, uint16_t count, int16_t step);
+uint8_t *get_index_buffer(void);
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_dither.h"
+
+//Streaming baseline JPEG decoder. load_jpeg reads the file through a small
+//input buffer and decodes one MCU row (8 or 16 image rows) at a time into a
+//strip, which is sent to the panel, or written to the RGB565 frame buffer,
+//as soon as it is ready; the decoded image is never held whole. Strips go
+//out through two buffers, so the next one is decoded while the previous one
+//is on the bus.
+//
+//Images use the orientation of load_image: every image row is a screen
+//column, so the 240x135 images tools/image.py writes with --jpeg cover the
+//screen, and an image row of any width fills a column from the top.
+//Supported: baseline and extended sequential Huffman JPEG, 8-bit samples,
+//grayscale or YCbCr with sampling factors of 1 or 2 (4:4:4, 4:2:2, 4:2:0),
+//restart intervals. Progressive and arithmetic-coded files are rejected.
+//Chroma is upsampled by replication and colors are converted to RGB565 with
+//the dither modes of st7789_dither.h.
+
+#define JPEG_INPUT_BUFFER 512 //bytes read from the file at a time
+#define JPEG_MAX_STRIP_ROWS 16 //tallest MCU: vertical sampling factor 2
+
+typedef enum {
+    JPEG_TO_PANEL,
+    JPEG_TO_FRAME_BUFFER //RGB565 frame buffer only
+} jpeg_target_t;
+
+typedef struct {
+    uint16_t width, height; //of the image
+    uint32_t bytes_read; //from the file
+    uint16_t strips; //MCU rows decoded
+    uint32_t pixels; //pixels written on screen
+    uint32_t total_us; //from opening the file to the last strip sent
+} jpeg_stats_t;
+
+bool load_jpeg(const char *path, int16_t x, int16_t y, jpeg_target_t target, dither_mode_t dither);
+void jpeg_get_stats(jpeg_stats_t *out);
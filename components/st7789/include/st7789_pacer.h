@@ -0,0 +1,31 @@
+#pragma once
+#include "st7789.h"
+#include "esp_timer.h"
+
+//Frame pacing against absolute deadlines. Frame n is due at start + n * period,
+//so render time never adds up into drift, and the wait is timed by a one-shot
+//esp_timer instead of being rounded to FreeRTOS ticks.
+
+#define FRAME_PACER_SPIN_US 100 //the last part of a wait is spun instead of slept
+
+typedef struct {
+    int64_t period_us;
+    int64_t deadline_us; //when the next frame is due
+    int64_t last_frame_us; //when the previous wait returned
+    esp_timer_handle_t timer;
+    TaskHandle_t task; //the task blocked in frame_pacer_wait
+
+    uint32_t frames;
+    uint32_t late_frames; //waits that started after the deadline
+    uint32_t dropped_frames; //whole periods skipped to catch up
+    int32_t interval_min_us; //time between consecutive frames
+    int32_t interval_max_us;
+    uint32_t jitter_max_us; //largest |interval - period|
+    uint64_t jitter_total_us;
+} frame_pacer_t;
+
+bool frame_pacer_init(frame_pacer_t *pacer, uint32_t period_us);
+void frame_pacer_deinit(frame_pacer_t *pacer);
+void frame_pacer_reset_stats(frame_pacer_t *pacer);
+uint32_t frame_pacer_wait(frame_pacer_t *pacer);
+uint32_t frame_pacer_jitter_avg_us(const frame_pacer_t *pacer);
@@ -0,0 +1,18 @@
+#pragma once
+#include "st7789.h"
+
+//Row-parallel rendering on both ESP32 cores. A row shader draws one whole
+//frame buffer row; parallel_rows hands out the rows to the calling task and
+//to helper tasks pinned to the other cores, and returns when all are done.
+
+#define PARALLEL_MAX_WORKERS 2
+#define PARALLEL_CHUNK_ROWS 4 //rows taken at a time by the worker that owns them
+#define PARALLEL_STEAL_ROWS 2 //rows taken at a time from another worker
+#define PARALLEL_TASK_STACK 4096
+
+typedef void (*row_shader_t)(int16_t y, void *arg);
+
+void parallel_init(void);
+void parallel_set_workers(uint8_t count);
+uint8_t parallel_get_workers(void);
+void parallel_rows(int16_t first, int16_t last, row_shader_t shader, void *arg);
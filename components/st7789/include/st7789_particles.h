@@ -0,0 +1,63 @@
+#pragma once
+#include "st7789.h"
+
+//Particle engine with structure-of-arrays storage. Positions and velocities
+//are fixed point with PARTICLE_SHIFT fractional bits, so one int16_t covers
+//+-512 pixels in steps of 1/64 pixel. Dead slots are kept on a free list
+//and reused by the next emit.
+
+#define PARTICLE_SHIFT 6
+#define PARTICLE_ONE (1 << PARTICLE_SHIFT)
+#define PARTICLE_FROM_INT(i) ((int16_t)((i) << PARTICLE_SHIFT))
+#define PARTICLE_TO_INT(p) ((p) >> PARTICLE_SHIFT)
+#define PARTICLE_MARGIN 16 //pixels a particle may leave the screen before it is culled
+
+typedef struct {
+    int16_t *x, *y; //positions
+    int16_t *vx, *vy; //velocities per update
+    uint16_t *life; //updates left, 0 for a free slot
+    uint16_t *color;
+    uint16_t *free_list; //indices of free slots, free_count of them
+    uint16_t capacity;
+    uint16_t free_count;
+    uint16_t span; //slots at or above this index have never been used
+    int16_t ax, ay; //acceleration added to the velocity every update
+    uint32_t rng; //xorshift32 state
+} particle_system_t;
+
+typedef struct {
+    int16_t x, y; //spawn position
+    int16_t vx, vy; //base velocity
+    int16_t spread_x, spread_y; //random velocity added in [-spread, spread]
+    uint16_t life; //base lifetime in updates
+    uint16_t life_spread; //random lifetime added in [0, life_spread]
+    const uint16_t *colors; //a random one is picked per particle
+    uint8_t color_count;
+} particle_emitter_t;
+
+bool particle_system_init(particle_system_t *ps, uint16_t capacity, uint32_t seed);
+void particle_system_free(particle_system_t *ps);
+void particle_clear(particle_system_t *ps);
+uint16_t particle_emit(particle_system_t *ps, const particle_emitter_t *em, uint16_t count);
+void particle_kill(particle_system_t *ps, uint16_t i);
+void particle_update(particle_system_t *ps);
+void particle_render(const particle_system_t *ps);
+
+/**
+ * @brief Returns the number of live particles.
+ */
+static inline uint16_t particle_count(const particle_system_t *ps) {
+    return ps->capacity - ps->free_count;
+}
+
+/**
+ * @brief Returns the next value of the system's xorshift32 generator.
+ */
+static inline uint32_t particle_rand(particle_system_t *ps) {
+    uint32_t s = ps->rng;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    ps->rng = s;
+    return s;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "st7789.h"
+
+//Per-stage performance counters. Build with ST7789_PERF 1 and every frame is
+//split into stages timed with the CPU cycle counter: rendering (from
+//perf_frame_begin or the previous flush up to the next flush), the overlay,
+//window/command setup, pixel conversion (byte swap or palette expansion) and
+//SPI transfers. The counters read the cycle counter of the calling core, so
+//drawing and flushing must stay on one task pinned to a core (app_main is).
+//With ST7789_PERF 0 the PERF_* hooks expand to nothing.
+
+#define PERF_HIST_BINS 16 //frame time histogram, the last bin collects everything above
+#define PERF_HIST_BIN_US 2000
+#define PERF_STACK_DEPTH 4 //nesting of PERF_PUSH
+#define PERF_OVERLAY_REFRESH 15 //frames averaged per overlay update
+#define PERF_OVERLAY_COLS 15 //characters per overlay line
+#define PERF_OVERLAY_LINES 3
+
+typedef enum {
+    PERF_STAGE_RENDER,
+    PERF_STAGE_OVERLAY,
+    PERF_STAGE_WINDOW,
+    PERF_STAGE_CONVERT,
+    PERF_STAGE_SPI,
+    PERF_STAGE_COUNT
+} perf_stage_t;
+
+typedef struct {
+    uint32_t frames; //completed flushes
+    uint64_t stage_total[PERF_STAGE_COUNT]; //cycles per stage over all frames
+    uint32_t stage_last[PERF_STAGE_COUNT]; //cycles per stage in the last frame
+    uint32_t stage_max[PERF_STAGE_COUNT];
+    uint32_t frame_us_last; //sum of all stages of the last frame
+    uint32_t frame_us_min;
+    uint32_t frame_us_max;
+    uint32_t interval_us_last; //time between the last two flushes
+    uint32_t flush_bytes; //bytes sent by the last flush
+    uint32_t flush_transactions; //SPI transactions of the last flush
+    uint64_t total_bytes; //every transfer, flushes and direct fills
+    uint32_t total_transactions;
+    uint32_t histogram[PERF_HIST_BINS]; //frame_us in PERF_HIST_BIN_US wide bins
+} perf_stats_t;
+
+#if ST7789_PERF
+
+#define PERF_FRAME_BEGIN() perf_frame_begin()
+#define PERF_FLUSH_BEGIN() perf_flush_begin()
+#define PERF_FLUSH_END() perf_flush_end()
+#define PERF_ENTER(stage) perf_enter(stage)
+#define PERF_PUSH(stage) perf_push(stage)
+#define PERF_POP() perf_pop()
+#define PERF_TRANSFER(bytes) perf_transfer(bytes)
+
+void perf_reset(void);
+void perf_frame_begin(void);
+void perf_flush_begin(void);
+void perf_flush_end(void);
+void perf_enter(perf_stage_t stage);
+void perf_push(perf_stage_t stage);
+void perf_pop(void);
+void perf_transfer(uint32_t bytes);
+void perf_get_stats(perf_stats_t *out);
+uint32_t perf_cycles_to_us(uint64_t cycles);
+void perf_log_stats(void);
+void perf_overlay_enable(uint8_t *font, uint16_t x, uint16_t y, uint16_t color, uint16_t background);
+void perf_overlay_disable(void);
+
+#else
+
+#define PERF_FRAME_BEGIN() ((void)0)
+#define PERF_FLUSH_BEGIN() ((void)0)
+#define PERF_FLUSH_END() ((void)0)
+#define PERF_ENTER(stage) ((void)0)
+#define PERF_PUSH(stage) ((void)0)
+#define PERF_POP() ((void)0)
+#define PERF_TRANSFER(bytes) ((void)0)
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include "st7789.h"
+
+//Draw call recording and replay. Build with ST7789_RECORD 1 and, between
+//record_start and record_stop, every call to clear_frame_buffer, draw_pixel,
+//draw_hline, draw_rectangle, draw_char_scaled, draw_text_scaled,
+//fill_rect_direct, load_image, load_jpeg, flush_frame_buffer and
+//flush_frame_buffer_rect made by the application is appended to a binary
+//log with its arguments.
+//Calls the driver makes internally (the pixels of a character, the perf
+//overlay) are not recorded, and primitives outside this list only show up
+//through the calls above that they make: the shapes through their spans,
+//blits and bulk frame buffer writes not at all. record_replay re-issues a log
+//as fast as possible, on the device or in the host build, and times every
+//frame, so a captured session becomes a repeatable benchmark. Replay is
+//always available; with ST7789_RECORD 0 the RECORD_* hooks expand to nothing.
+//
+//Log format, little endian: "ST7R", version, FRAME_BUFFER_BPP, TFT_WIDTH and
+//TFT_HEIGHT as uint16, then one record per call: the op byte, its uint16
+//arguments and, for text and images, a uint16 length and the bytes.
+
+#define RECORD_VERSION 1
+#define RECORD_MAX_DATA 1024 //longest text or path kept in a record
+#define REPLAY_CHUNK 4096 //bytes of the log read at a time during replay
+
+typedef enum {
+    RECORD_OP_CLEAR, //color
+    RECORD_OP_PIXEL, //x, y, color
+    RECORD_OP_HLINE, //x0, x1, y, color as int16
+    RECORD_OP_RECT, //x1, y1, x2, y2, color
+    RECORD_OP_CHAR, //x, y, c, color, scale
+    RECORD_OP_TEXT, //x, y, color, scale, text
+    RECORD_OP_DIRECT_FILL, //x0, y0, x1, y1, color
+    RECORD_OP_IMAGE, //path
+    RECORD_OP_FLUSH,
+    RECORD_OP_FLUSH_RECT, //x0, y0, x1, y1
+    RECORD_OP_JPEG, //x, y, target, dither as int16, path
+    RECORD_OP_COUNT
+} record_op_t;
+
+typedef struct {
+    uint32_t frames; //flushes replayed
+    uint32_t calls;
+    uint32_t op_count[RECORD_OP_COUNT];
+    uint64_t total_us; //replay time without reading the log
+    uint64_t frames_us; //sum of the frame times
+    uint32_t frame_min_us; //from the previous flush to the end of this one
+    uint32_t frame_max_us;
+} replay_result_t;
+
+bool record_replay(const char *path, uint8_t *font, const char *image_dir, replay_result_t *result);
+void record_log_result(const replay_result_t *result);
+
+#if ST7789_RECORD
+
+#define RECORD_CALL(op, ...) \
+    record_call(op, (const uint16_t[]){__VA_ARGS__}, sizeof((uint16_t[]){__VA_ARGS__}) / sizeof(uint16_t), NULL, 0)
+#define RECORD_TEXT(x, y, text, color, scale) \
+    record_call(RECORD_OP_TEXT, (const uint16_t[]){x, y, color, scale}, 4, text, strlen(text))
+#define RECORD_IMAGE(path) record_call(RECORD_OP_IMAGE, NULL, 0, path, strlen(path))
+#define RECORD_JPEG(path, x, y, target, dither) \
+    record_call(RECORD_OP_JPEG, (const uint16_t[]){x, y, target, dither}, 4, path, strlen(path))
+#define RECORD_FLUSH() record_call(RECORD_OP_FLUSH, NULL, 0, NULL, 0)
+#define RECORD_SUSPEND() record_suspend()
+#define RECORD_RESUME() record_resume()
+
+bool record_start(const char *path);
+void record_stop(void);
+void record_call(record_op_t op, const uint16_t *args, uint8_t count, const void *data, size_t size);
+void record_suspend(void);
+void record_resume(void);
+
+#else
+
+#define RECORD_CALL(op, ...) ((void)0)
+#define RECORD_TEXT(x, y, text, color, scale) ((void)0)
+#define RECORD_IMAGE(path) ((void)0)
+#define RECORD_JPEG(path, x, y, target, dither) ((void)0)
+#define RECORD_FLUSH() ((void)0)
+#define RECORD_SUSPEND() ((void)0)
+#define RECORD_RESUME() ((void)0)
+
+#endif
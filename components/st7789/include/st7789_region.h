@@ -0,0 +1,27 @@
+#pragma once
+#include "st7789.h"
+
+//Lists of screen rectangles to redraw, for the modules that flush only what
+//changed (st7789_ui.h, st7789_compositor.h). Rectangles are clipped to the
+//screen when added. region_merge joins the ones that are cheaper to send as
+//one window than as two; when a list is full the pair whose union adds the
+//fewest pixels is joined to make room.
+
+#define REGION_MAX 8 //rectangles per list
+#define REGION_MERGE_SLACK 256 //extra pixels worth sending to save a window
+
+typedef struct {
+    int16_t x0, y0, x1, y1; //inclusive
+} region_rect_t;
+
+typedef struct {
+    region_rect_t rects[REGION_MAX];
+    uint16_t count;
+} region_list_t;
+
+void region_clear(region_list_t *list);
+void region_add(region_list_t *list, int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+void region_add_list(region_list_t *list, const region_list_t *other);
+void region_merge(region_list_t *list);
+bool region_overlap(const region_rect_t *a, const region_rect_t *b);
+region_rect_t region_union(const region_rect_t *a, const region_rect_t *b);
@@ -0,0 +1,17 @@
+#pragma once
+#include "st7789.h"
+
+//arc angles are in degrees, 0 = +x (right), growing clockwise on screen
+#define ARC_FULL_CIRCLE 360
+
+void draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+void draw_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void fill_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void draw_ellipse(int16_t x0, int16_t y0, uint16_t rx, uint16_t ry, uint16_t color);
+void fill_ellipse(int16_t x0, int16_t y0, uint16_t rx, uint16_t ry, uint16_t color);
+void draw_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+void draw_round_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color);
+void fill_round_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color);
+void draw_arc(int16_t x0, int16_t y0, uint16_t r, int16_t start_deg, int16_t end_deg, uint16_t color);
+void fill_arc(int16_t x0, int16_t y0, uint16_t r_outer, uint16_t r_inner, int16_t start_deg, int16_t end_deg, uint16_t color);
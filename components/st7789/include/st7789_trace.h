@@ -0,0 +1,56 @@
+#pragma once
+#include "st7789.h"
+
+//Bus transaction recorder. Build with ST7789_TRACE 1 and every transport
+//write, queued write and wait made by the driver is stored in a RAM ring
+//buffer: start cycle, duration, D/C level, length and the first bytes. Each
+//flush adds a frame marker. trace_dump prints the ring on the console (UART)
+//as text lines that tools/trace.py turns into per-frame statistics and a gap
+//analysis. Timestamps come from the cycle counter of the calling core, so
+//drawing and flushing must stay on one task pinned to a core, as with
+//st7789_perf.h. With ST7789_TRACE 0 the TRACE_* hooks expand to nothing.
+
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS 1024 //ring size, 16 bytes per record
+#endif
+#define TRACE_HEAD_BYTES 4 //bytes of each transaction kept in the record
+
+typedef enum {
+    TRACE_WRITE, //blocking write, the duration is the transfer
+    TRACE_QUEUE, //queued write, the duration is only the queueing
+    TRACE_WAIT, //wait for a queued write, no data
+    TRACE_FRAME, //start of a flush, no data
+} trace_kind_t;
+
+typedef struct {
+    uint32_t start; //cycle count
+    uint32_t cycles; //duration
+    uint16_t length; //bytes, saturated at 0xFFFF
+    uint8_t kind; //trace_kind_t
+    uint8_t dc; //CMD_MODE or DATA_MODE
+    uint8_t head[TRACE_HEAD_BYTES];
+} trace_record_t;
+
+#if ST7789_TRACE
+
+#define TRACE_BEGIN() trace_begin()
+#define TRACE_END(kind, dc, data, size) trace_end(kind, dc, data, size)
+#define TRACE_FRAME_MARK() trace_end(TRACE_FRAME, DATA_MODE, NULL, 0)
+
+void trace_start(void);
+void trace_stop(void);
+void trace_clear(void);
+void trace_begin(void);
+void trace_end(trace_kind_t kind, uint8_t dc, const void *data, size_t size);
+uint32_t trace_count(void);
+uint32_t trace_overwritten(void);
+const trace_record_t *trace_get(uint32_t index);
+void trace_dump(void);
+
+#else
+
+#define TRACE_BEGIN() ((void)0)
+#define TRACE_END(kind, dc, data, size) ((void)0)
+#define TRACE_FRAME_MARK() ((void)0)
+
+#endif
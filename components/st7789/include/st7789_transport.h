@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+//Bus access of the driver. Every byte the driver sends goes through a
+//transport, so the same code runs against the ESP32 SPI master
+//(st7789_transport_spi.c) or against the host panel emulator.
+
+typedef struct {
+    void (*init)(void); //sets up the bus and the control pins
+    void (*set_dc)(uint32_t level); //CMD_MODE or DATA_MODE for the following writes
+    void (*set_reset)(uint32_t level);
+    void (*write)(const void *data, size_t size); //blocking
+    void (*queue)(const void *data, size_t size); //asynchronous, data must stay valid until waited for
+    void (*wait)(void); //blocks until the oldest queued write is done
+    void (*backlight)(uint8_t duty);
+} st7789_transport_t;
+
+const st7789_transport_t *st7789_default_transport(void);
+void st7789_set_transport(const st7789_transport_t *transport);
+const st7789_transport_t *st7789_get_transport(void);
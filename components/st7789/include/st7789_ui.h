@@ -0,0 +1,38 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_blit.h"
+
+//Retained widgets for mostly static screens: labels, numeric readouts,
+//progress bars, arc gauges and icons. Every widget keeps its state and its
+//bounds and is drawn opaque over them, in creation order. Setting a value
+//only invalidates what actually changes on screen: the character cells that
+//differ for labels and readouts, the strip between the old and the new fill
+//for bars, the gauge when its needle angle moves by a degree or more.
+//ui_update redraws the invalidated widgets, and the ones created after them
+//that overlap them, in the frame buffer and flushes just the invalidated
+//rectangles with flush_frame_buffer_rect, merged as in st7789_region.h.
+//Colors are frame buffer colors, like the other drawing functions (palette
+//indices in the indexed formats).
+
+#define UI_MAX_WIDGETS 32
+#define UI_TEXT_MAX 24 //characters of a label or readout
+#define UI_GAUGE_START 135 //degrees, the gauge sweeps clockwise from here
+#define UI_GAUGE_SWEEP 270
+
+typedef int16_t ui_handle_t; //widget index, -1 when the widget was not created
+
+void ui_init(uint16_t background, uint8_t *font);
+ui_handle_t ui_label(uint16_t x, uint16_t y, uint8_t columns, uint8_t scale, uint16_t color, uint16_t background, const char *text);
+ui_handle_t ui_number(uint16_t x, uint16_t y, uint8_t columns, uint8_t decimals, uint8_t scale, uint16_t color, uint16_t background);
+ui_handle_t ui_bar(uint16_t x, uint16_t y, uint16_t width, uint16_t height, int32_t min, int32_t max, uint16_t color, uint16_t background);
+ui_handle_t ui_gauge(uint16_t cx, uint16_t cy, uint16_t r, uint16_t thickness, int32_t min, int32_t max,
+                     uint16_t color, uint16_t track, uint16_t background);
+#if FRAME_BUFFER_BPP == 16
+ui_handle_t ui_icon(uint16_t x, uint16_t y, const sprite_t *sprite, uint16_t background);
+void ui_set_icon(ui_handle_t handle, const sprite_t *sprite);
+#endif
+void ui_set_text(ui_handle_t handle, const char *text);
+void ui_set_value(ui_handle_t handle, int32_t value);
+void ui_set_color(ui_handle_t handle, uint16_t color);
+void ui_invalidate(ui_handle_t handle);
+uint16_t ui_update(void);
@@ -1,7 +1,17 @@
 #include "st7789.h"
+#include "st7789_perf.h"
+#include "st7789_trace.h"
+#include "st7789_record.h"
+#include "st7789_transport.h"
 
-spi_device_handle_t spi;
+static const st7789_transport_t *transport = NULL;
+#if FRAME_BUFFER_BPP == 16
 static uint16_t frame_buffer[TFT_WIDTH * TFT_HEIGHT];
+#endif
+static DMA_ATTR uint16_t direct_fill_buffer[DIRECT_FILL_CHUNK];
+static uint16_t direct_fill_color;
+static bool direct_fill_ready = false;
+static bool direct_fill_keep_fb = false;
 
 /**
  * @brief Sends a command to the ST7789 display.
@@ -13,31 +23,29 @@ static uint16_t frame_buffer[TFT_WIDTH * TFT_HEIGHT];
  */
 
 void send_cmd(uint8_t cmd) {
-    gpio_set_level(TFT_DC, CMD_MODE);
-    spi_transaction_t t = {
-        .length = 8,
-        .tx_buffer = &cmd
-    };
-    ESP_ERROR_CHECK(spi_device_transmit(spi, &t));
+    transport->set_dc(CMD_MODE);
+    PERF_TRANSFER(1);
+    TRACE_BEGIN();
+    transport->write(&cmd, 1);
+    TRACE_END(TRACE_WRITE, CMD_MODE, &cmd, 1);
 }
 
 /**
  * @brief Sends data to the ST7789 display via SPI.
  *
- * This function sends a block of data to the ST7789 display using the SPI interface.
- * It sets the data/command pin to data mode, prepares the SPI transaction, and transmits
- * the data using polling mode.
+ * This function sends a block of data to the ST7789 display through the transport.
+ * It sets the data/command pin to data mode and transmits the data as one
+ * blocking write.
  *
  * @param data Pointer to the data buffer to be sent.
  * @param size Size of the data buffer in bytes.
  */
 void send_data(const uint8_t* data, size_t size) {
-    spi_transaction_t SPIT;
-    gpio_set_level(TFT_DC, DATA_MODE);
-    memset(&SPIT, 0, sizeof(spi_transaction_t));
-    SPIT.length = size * 8;
-    SPIT.tx_buffer = data;
-    ESP_ERROR_CHECK(spi_device_polling_transmit(spi, &SPIT));
+    transport->set_dc(DATA_MODE);
+    PERF_TRANSFER(size);
+    TRACE_BEGIN();
+    transport->write(data, size);
+    TRACE_END(TRACE_WRITE, DATA_MODE, data, size);
 }
 
 /**
@@ -55,26 +63,6 @@ void send_word(uint16_t data){
 
 
 
-/**
- * @brief Initialize GPIO pins for the TFT display.
- *
- * This function configures the GPIO pins used for the TFT display's
- * Data/Command (TFT_DC), Reset (TFT_RST), and Backlight (TFT_BL) signals.
- * The pins are set to output mode with no pull-up or pull-down resistors,
- * and interrupts are disabled.
- *
- * The specific pins used are defined by the macros TFT_DC, TFT_RST, and TFT_BL.
- */
-void gpio_init() {
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << TFT_DC) | (1ULL << TFT_RST) | (1ULL << TFT_BL),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
-    };
-    gpio_config(&io_conf);
-}
 
 /**
  * @brief Resets the TFT display.
@@ -86,59 +74,39 @@ void gpio_init() {
  * reset process.
  */
 void RESET(){
-    gpio_set_level(TFT_RST, 0);
+    transport->set_reset(0);
     vTaskDelay(pdMS_TO_TICKS(20));
-    gpio_set_level(TFT_RST, 1);
+    transport->set_reset(1);
     send_cmd(SWRESET);
 
     vTaskDelay(pdMS_TO_TICKS(150));
 }
 /**
- * @brief Configures and sets the backlight duty cycle.
- *
- * This function initializes the LEDC timer and channel configurations 
- * and sets the duty cycle for the backlight. It uses the LEDC (LED 
- * Controller) peripheral to control the brightness of the backlight.
+ * @brief Sets the backlight duty cycle through the transport.
  *
- * @param duty The duty cycle to set for the backlight. This value 
+ * @param duty The duty cycle to set for the backlight. This value
  *             determines the brightness of the backlight.
- *
- * @note The function assumes that the following macros are defined:
- *       - SPEED_MODE: The speed mode of the LEDC timer.
- *       - TIMER_NUM: The timer number to use for the LEDC timer.
- *       - DUTY_RESOLUTION: The resolution of the duty cycle.
- *       - FREQUENCY_TIMER: The frequency of the LEDC timer.
- *       - CLK_CFG: The clock configuration for the LEDC timer.
- *       - LEDC_CHANNEL: The LEDC channel to configure.
- *       - GPIO_NUM: The GPIO number to use for the LEDC channel.
- *       - LEDC_HIGH_SPEED_MODE: The high-speed mode for the LEDC.
  */
-
 void backlight(uint8_t duty) {
+    transport->backlight(duty);
+}
 
-    ledc_timer_config_t ledc_timer = {
-        .speed_mode = SPEED_MODE,
-        .timer_num = TIMER_NUM,
-        .duty_resolution = DUTY_RESOLUTION,
-        .freq_hz = FREQUENCY_TIMER,
-        .clk_cfg = CLK_CFG,
-    };
-
-    ledc_timer_config(&ledc_timer);
-
-    ledc_channel_config_t ledc_channel = {
-        .speed_mode = SPEED_MODE,
-        .channel = LEDC_CHANNEL,
-        .gpio_num = GPIO_NUM,
-        .timer_sel = TIMER_NUM,
-        .duty = 0,
-        .hpoint = 0,
-    };
-    ledc_channel_config(&ledc_channel);
-
-    ledc_set_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL, duty);
-    ledc_update_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL);
+/**
+ * @brief Selects the transport the driver sends through.
+ *
+ * Must be called before INIT, which otherwise picks st7789_default_transport.
+ *
+ * @param t The transport to use, it must stay valid.
+ */
+void st7789_set_transport(const st7789_transport_t *t) {
+    transport = t;
+}
 
+/**
+ * @brief Returns the transport in use, NULL before INIT.
+ */
+const st7789_transport_t *st7789_get_transport(void) {
+    return transport;
 }
 
 /**
@@ -204,6 +172,7 @@ void set_window(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
     y0 = (y0 >= TFT_HEIGHT) ? TFT_HEIGHT - 1 : y0;
     y1 = (y1 >= TFT_HEIGHT) ? TFT_HEIGHT - 1 : y1;
 
+    PERF_PUSH(PERF_STAGE_WINDOW);
     send_cmd(CASET);
     send_word(x0 + X_OFFSET);
     send_word(x1 + X_OFFSET);
@@ -211,6 +180,7 @@ void set_window(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
     send_cmd(RASET);
     send_word(y0 + Y_OFFSET);
     send_word(y1 + Y_OFFSET);
+    PERF_POP();
 }
 
 /**
@@ -221,7 +191,8 @@ void set_window(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
  * to configure the display, and setting the backlight brightness.
  *
  * The initialization sequence includes:
- * - Initializing SPI and GPIO interfaces.
+ * - Initializing the transport (SPI and GPIO on the ESP32), the default one
+ *   unless st7789_set_transport was called first.
  * - Resetting the display.
  * - Exiting sleep mode.
  * - Setting the color mode.
@@ -238,8 +209,8 @@ void set_window(uint16_t x0, uint16_t x1, uint16_t y0, uint16_t y1) {
  *       between commands.
  */
 void INIT() {
-    spi_init();
-    gpio_init();
+    if (transport == NULL) transport = st7789_default_transport();
+    transport->init();
     RESET();
     
     send_cmd(SLPOUT);
@@ -270,40 +241,6 @@ void INIT() {
     backlight(128); 
 }
 
-/**
- * @brief Initializes the SPI bus and adds the SPI device.
- *
- * This function configures the SPI bus with the specified settings and adds the SPI device to the bus.
- * It sets up the MOSI, SCLK, and other necessary pins, as well as the maximum transfer size.
- * The SPI device is configured with a clock speed of 80 MHz, mode 0, and other relevant settings.
- *
- * @note This function uses the ESP-IDF SPI driver and checks for errors during initialization.
- *
- * @param None
- *
- * @return None
- */
-void spi_init() {
-    spi_bus_config_t buscfg = {
-        .mosi_io_num = TFT_MOSI,
-        .sclk_io_num = TFT_SCLK,
-        .miso_io_num = -1,
-        .quadwp_io_num = -1,
-        .quadhd_io_num = -1,
-        .max_transfer_sz = TFT_HEIGHT * TFT_WIDTH * 2 
-    };
-
-    spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 80 * 1000 * 1000, 
-        .mode = 0,
-        .spics_io_num = TFT_CS,
-        .queue_size = 9,
-        .flags = SPI_DEVICE_NO_DUMMY
-    };
-
-    ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_CH_AUTO));
-    ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &devcfg, &spi));
-}
 
 
 
@@ -339,33 +276,117 @@ void send_color(uint16_t *color, uint16_t size) {
     const uint16_t chunk_size = 512;
     uint16_t sent = 0;
 
+    PERF_PUSH(PERF_STAGE_CONVERT);
     while (sent < size) {
         uint16_t remaining = size - sent;
         uint16_t current_chunk = (remaining > chunk_size) ? chunk_size : remaining;
         uint16_t index = 0;
 
+        PERF_ENTER(PERF_STAGE_CONVERT);
         for (uint16_t i = 0; i < current_chunk; i++) {
             uint16_t c = color[sent + i];
             byte_buffer[index++] = (c >> 8) & 0xFF;
             byte_buffer[index++] = c & 0xFF;
         }
 
+        PERF_ENTER(PERF_STAGE_SPI);
         send_data(byte_buffer, current_chunk * 2);
         sent += current_chunk;
     }
+    PERF_POP();
+}
+
+#if FRAME_BUFFER_BPP == 16
+/**
+ * @brief Returns the frame buffer that all drawing functions write to.
+ *
+ * The buffer is TFT_WIDTH * TFT_HEIGHT pixels in row-major order. It is meant
+ * for modules that need to read or write pixels in bulk (blits, effects).
+ *
+ * @return Pointer to the first pixel of the frame buffer.
+ */
+uint16_t *get_frame_buffer(void) {
+    return frame_buffer;
+}
+#endif
+
+/**
+ * @brief Fills a run of contiguous pixels with one color.
+ *
+ * This is the word-wide fill kernel behind every solid fill. A leading pixel
+ * is written if needed to reach 4-byte alignment, then the color is stored as
+ * 32-bit pixel pairs, 16 pixels per unrolled iteration, and the tail is
+ * finished with single stores.
+ *
+ * @param dst Pointer to the first pixel to fill.
+ * @param count Number of pixels to fill.
+ * @param color The color to fill with.
+ */
+void fill_pixels(uint16_t *dst, uint32_t count, uint16_t color) {
+    if (count == 0) return;
+
+    if ((uintptr_t)dst & 2) {
+        *dst++ = color;
+        count--;
+    }
+
+    pixel_pair_t pair = ((uint32_t)color << 16) | color;
+    pixel_pair_t *dst32 = (pixel_pair_t *)dst;
+    uint32_t pairs = count >> 1;
+
+    while (pairs >= 8) {
+        dst32[0] = pair; dst32[1] = pair; dst32[2] = pair; dst32[3] = pair;
+        dst32[4] = pair; dst32[5] = pair; dst32[6] = pair; dst32[7] = pair;
+        dst32 += 8;
+        pairs -= 8;
+    }
+    while (pairs--) {
+        *dst32++ = pair;
+    }
+
+    if (count & 1) {
+        *(uint16_t *)dst32 = color;
+    }
+}
+
+/**
+ * @brief Fills a run of pixels spaced by a fixed stride.
+ *
+ * Used for single-column fills, where every pixel lives on its own row.
+ *
+ * @param dst Pointer to the first pixel to fill.
+ * @param count Number of pixels to fill.
+ * @param stride Distance between two consecutive pixels, in pixels.
+ * @param color The color to fill with.
+ */
+void fill_pixels_strided(uint16_t *dst, uint32_t count, uint32_t stride, uint16_t color) {
+    while (count >= 4) {
+        dst[0] = color;
+        dst[stride] = color;
+        dst[2 * stride] = color;
+        dst[3 * stride] = color;
+        dst += 4 * stride;
+        count -= 4;
+    }
+    while (count--) {
+        *dst = color;
+        dst += stride;
+    }
 }
 
+//In indexed mode (FRAME_BUFFER_BPP 8 or 4) these live in st7789_indexed.c
+#if FRAME_BUFFER_BPP == 16
 /**
  * @brief Clears the frame buffer by filling it with the specified color.
  *
- * This function iterates over the entire frame buffer and sets each pixel to the given color.
+ * The whole buffer is one contiguous run, so it is filled with a single call
+ * to the word-wide kernel.
  *
  * @param color The color to fill the frame buffer with. The color is represented as a 16-bit value.
  */
 void clear_frame_buffer(uint16_t color) {
-    for (uint32_t i = 0; i < TFT_WIDTH * TFT_HEIGHT; i++) {
-        frame_buffer[i] = color;
-    }
+    RECORD_CALL(RECORD_OP_CLEAR, color);
+    fill_pixels(frame_buffer, TFT_WIDTH * TFT_HEIGHT, color);
 }
 
 /**
@@ -379,15 +400,41 @@ void clear_frame_buffer(uint16_t color) {
  * @param color The color of the pixel in 16-bit format.
  */
 void draw_pixel(uint16_t x, uint16_t y, uint16_t color) {
+    RECORD_CALL(RECORD_OP_PIXEL, x, y, color);
     if (x >= TFT_WIDTH || y >= TFT_HEIGHT) return;
     frame_buffer[y * TFT_WIDTH + x] = color;
 }
 
 
+/**
+ * @brief Fills a horizontal span of pixels in the frame buffer.
+ *
+ * This is the building block for all span-rasterized primitives. The span is
+ * clipped against the screen once and then written with a tight pointer loop,
+ * so callers can pass coordinates that lie partially or fully off screen.
+ *
+ * @param x0 The x-coordinate of the first pixel of the span.
+ * @param x1 The x-coordinate of the last pixel of the span (inclusive).
+ * @param y The row of the span.
+ * @param color The color to fill the span with.
+ */
+void draw_hline(int16_t x0, int16_t x1, int16_t y, uint16_t color) {
+    RECORD_CALL(RECORD_OP_HLINE, x0, x1, y, color);
+    if (y < 0 || y >= TFT_HEIGHT) return;
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (x1 < 0 || x0 >= TFT_WIDTH) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= TFT_WIDTH) x1 = TFT_WIDTH - 1;
+
+    fill_pixels(&frame_buffer[y * TFT_WIDTH + x0], x1 - x0 + 1, color);
+}
+
 /**
  * @brief Draws a filled rectangle on the display.
  *
- * This function sets a window on the display and fills it with the specified color.
+ * This function fills the rectangle in the frame buffer with the specified
+ * color. Full-width rectangles are filled as one contiguous run, single
+ * columns with a strided fill and everything else row by row.
  *
  * @param x1 The x-coordinate of the top-left corner of the rectangle.
  * @param y1 The y-coordinate of the top-left corner of the rectangle.
@@ -396,7 +443,7 @@ void draw_pixel(uint16_t x, uint16_t y, uint16_t color) {
  * @param color The color to fill the rectangle with.
  */
 void draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
-
+    RECORD_CALL(RECORD_OP_RECT, x1, y1, x2, y2, color);
     x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
     x2 = (x2 < TFT_WIDTH) ? x2 : TFT_WIDTH - 1;
     y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
@@ -405,9 +452,19 @@ void draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t
     if (x1 > x2) { uint16_t t = x1; x1 = x2; x2 = t; }
     if (y1 > y2) { uint16_t t = y1; y1 = y2; y2 = t; }
 
-    for (uint16_t y = y1; y <= y2; y++) {
-        for (uint16_t x = x1; x <= x2; x++) {
-            frame_buffer[y * TFT_WIDTH + x] = color;
+    uint16_t *row = &frame_buffer[y1 * TFT_WIDTH + x1];
+    uint16_t width = x2 - x1 + 1;
+    uint16_t height = y2 - y1 + 1;
+
+    if (width == TFT_WIDTH) {
+        // Full-width rows are one contiguous run
+        fill_pixels(row, (uint32_t)width * height, color);
+    } else if (width == 1) {
+        fill_pixels_strided(row, height, TFT_WIDTH, color);
+    } else {
+        for (uint16_t y = 0; y < height; y++) {
+            fill_pixels(row, width, color);
+            row += TFT_WIDTH;
         }
     }
 }
@@ -416,14 +473,151 @@ void draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t
  * @brief Flushes the entire frame buffer to the display.
  *
  * This function sets the window to cover the entire display area and sends the
- * frame buffer content to the display using the RAMWR command.
+ * frame buffer content to the display using the RAMWR command. With
+ * ST7789_PERF the frame's stage timings are recorded and the overlay is
+ * drawn first (st7789_perf.h).
  */
 void flush_frame_buffer() {
+    RECORD_FLUSH();
+    RECORD_SUSPEND();
+    PERF_FLUSH_BEGIN();
+    TRACE_FRAME_MARK();
     set_window(0, TFT_WIDTH - 1, 0, TFT_HEIGHT - 1);
     send_cmd(RAMWR);
     send_color(frame_buffer, TFT_WIDTH * TFT_HEIGHT);
+    PERF_FLUSH_END();
+    RECORD_RESUME();
 }
 
+/**
+ * @brief Flushes one rectangle of the frame buffer to the display.
+ *
+ * Only the window of the rectangle is written, so a small update costs its
+ * own pixels instead of a full frame. Rows are byte swapped into chunks of up
+ * to FLUSH_RECT_CHUNK pixels, as many whole rows per chunk as fit. It is not
+ * a frame for the performance counters and the overlay is not drawn.
+ *
+ * @param x0 The x-coordinate of the top-left corner.
+ * @param y0 The y-coordinate of the top-left corner.
+ * @param x1 The x-coordinate of the bottom-right corner.
+ * @param y1 The y-coordinate of the bottom-right corner.
+ */
+void flush_frame_buffer_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    static DMA_ATTR uint16_t rect_buffer[FLUSH_RECT_CHUNK];
+
+    RECORD_CALL(RECORD_OP_FLUSH_RECT, x0, y0, x1, y1);
+    x0 = (x0 < TFT_WIDTH) ? x0 : TFT_WIDTH - 1;
+    x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
+    y0 = (y0 < TFT_HEIGHT) ? y0 : TFT_HEIGHT - 1;
+    y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
+    if (x0 > x1) { uint16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { uint16_t t = y0; y0 = y1; y1 = t; }
+
+    TRACE_FRAME_MARK();
+    set_window(x0, x1, y0, y1);
+    send_cmd(RAMWR);
+
+    uint16_t width = x1 - x0 + 1;
+    uint16_t rows_per_chunk = FLUSH_RECT_CHUNK / width;
+    uint16_t y = y0;
+
+    PERF_PUSH(PERF_STAGE_CONVERT);
+    while (y <= y1) {
+        uint32_t n = 0;
+        PERF_ENTER(PERF_STAGE_CONVERT);
+        for (uint16_t r = 0; r < rows_per_chunk && y <= y1; r++, y++) {
+            const uint16_t *src = &frame_buffer[y * TFT_WIDTH + x0];
+            for (uint16_t i = 0; i < width; i++) {
+                rect_buffer[n++] = (src[i] >> 8) | (src[i] << 8);
+            }
+        }
+        PERF_ENTER(PERF_STAGE_SPI);
+        send_data((const uint8_t *)rect_buffer, n * 2);
+    }
+    PERF_POP();
+}
+#endif
+
+
+/**
+ * @brief Selects whether fill_rect_direct also updates the frame buffer.
+ *
+ * By default the direct fill only touches the panel, so the next
+ * flush_frame_buffer overwrites it with whatever the frame buffer holds. When
+ * enabled, the same rectangle is also filled in the frame buffer so both
+ * paths can be mixed without the screen jumping back to stale content.
+ * Only available with the RGB565 frame buffer (FRAME_BUFFER_BPP 16).
+ *
+ * @param enable true to keep the frame buffer consistent with the panel.
+ */
+void direct_fill_keep_frame_buffer(bool enable) {
+    direct_fill_keep_fb = enable;
+}
+
+/**
+ * @brief Fills a rectangle on the panel with a solid color.
+ *
+ * The window is set to the rectangle and one small DMA buffer holding the
+ * color in panel byte order is queued over and over until every pixel has
+ * been sent. The buffer is only rebuilt when the color changes, so the CPU
+ * cost is independent of the rectangle size and the frame buffer is left
+ * untouched (see direct_fill_keep_frame_buffer).
+ *
+ * @param x0 The x-coordinate of the top-left corner.
+ * @param y0 The y-coordinate of the top-left corner.
+ * @param x1 The x-coordinate of the bottom-right corner.
+ * @param y1 The y-coordinate of the bottom-right corner.
+ * @param color The fill color.
+ */
+void fill_rect_direct(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) {
+    RECORD_CALL(RECORD_OP_DIRECT_FILL, x0, y0, x1, y1, color);
+    x0 = (x0 < TFT_WIDTH) ? x0 : TFT_WIDTH - 1;
+    x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
+    y0 = (y0 < TFT_HEIGHT) ? y0 : TFT_HEIGHT - 1;
+    y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
+    if (x0 > x1) { uint16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { uint16_t t = y0; y0 = y1; y1 = t; }
+
+#if FRAME_BUFFER_BPP == 16
+    if (direct_fill_keep_fb) {
+        RECORD_SUSPEND();
+        draw_rectangle(x0, y0, x1, y1, color);
+        RECORD_RESUME();
+    }
+#endif
+
+    if (!direct_fill_ready || direct_fill_color != color) {
+        uint16_t swapped = (color >> 8) | (color << 8);
+        fill_pixels(direct_fill_buffer, DIRECT_FILL_CHUNK, swapped);
+        direct_fill_color = color;
+        direct_fill_ready = true;
+    }
+
+    set_window(x0, x1, y0, y1);
+    send_cmd(RAMWR);
+    transport->set_dc(DATA_MODE);
+
+    uint32_t remaining = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    uint8_t queued = 0;
+
+    PERF_PUSH(PERF_STAGE_SPI);
+    while (remaining || queued) {
+        while (remaining && queued < DIRECT_FILL_QUEUE) {
+            uint32_t pixels = (remaining > DIRECT_FILL_CHUNK) ? DIRECT_FILL_CHUNK : remaining;
+            PERF_TRANSFER(pixels * 2);
+            TRACE_BEGIN();
+            transport->queue(direct_fill_buffer, pixels * 2);
+            TRACE_END(TRACE_QUEUE, DATA_MODE, direct_fill_buffer, pixels * 2);
+            remaining -= pixels;
+            queued++;
+        }
+        TRACE_BEGIN();
+        transport->wait();
+        TRACE_END(TRACE_WAIT, DATA_MODE, NULL, 0);
+        queued--;
+    }
+    PERF_POP();
+}
 
 /**
  * @brief Loads an image from a file and displays it on the screen.
@@ -447,6 +641,7 @@ void flush_frame_buffer() {
  *       for the image being loaded.
  */
 void load_image(const char* path) {
+    RECORD_IMAGE(path);
     FILE* file = fopen(path, "rb");
     uint16_t* img_buf = malloc(TFT_WIDTH * TFT_HEIGHT * 2);
     
@@ -462,6 +657,33 @@ void load_image(const char* path) {
     free(img_buf);
 }
 
+/**
+ * @brief Reads an image in the load_image format into a row-major buffer.
+ *
+ * The file holds the image column by column; it is read one column at a time
+ * and turned into rows, so no second full-screen buffer is needed. Nothing is
+ * sent to the display.
+ *
+ * @param path The file path to the image.
+ * @param pixels TFT_WIDTH x TFT_HEIGHT RGB565 values, row by row.
+ * @return false if the file cannot be opened or is short.
+ */
+bool read_image(const char *path, uint16_t *pixels) {
+    static uint16_t column[TFT_HEIGHT];
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    bool complete = true;
+    for (uint16_t x = 0; x < TFT_WIDTH && complete; x++) {
+        complete = fread(column, 2, TFT_HEIGHT, file) == TFT_HEIGHT;
+        for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+            pixels[y * TFT_WIDTH + x] = column[y];
+        }
+    }
+    fclose(file);
+    return complete;
+}
+
 
 /**
  * @brief Draws a scaled character on the display.
@@ -480,7 +702,9 @@ void load_image(const char* path) {
  */
 
 void draw_char_scaled(uint16_t x, uint16_t y, char c, uint16_t color, uint8_t scale, uint8_t *font) {
+    RECORD_CALL(RECORD_OP_CHAR, x, y, (uint8_t)c, color, scale);
     if (c < FONT_START || c > FONT_END) return; 
+    RECORD_SUSPEND();
 
     uint8_t *glyph = &font[(c - FONT_START) * FONT_HEIGHT]; 
 
@@ -497,6 +721,7 @@ void draw_char_scaled(uint16_t x, uint16_t y, char c, uint16_t color, uint8_t sc
             }
         }
     }
+    RECORD_RESUME();
 }
 
 
@@ -515,7 +740,8 @@ void draw_char_scaled(uint16_t x, uint16_t y, char c, uint16_t color, uint8_t sc
  * @param font_data Pointer to the font data used for rendering the text.
  */
 void draw_text_scaled(uint16_t x, uint16_t y, const char *text, uint16_t color, uint8_t scale, uint8_t *font_data) {
-    
+    RECORD_TEXT(x, y, text, color, scale);
+    RECORD_SUSPEND();
     uint16_t cursor_x = x;
 
     while (*text) {
@@ -528,4 +754,5 @@ void draw_text_scaled(uint16_t x, uint16_t y, const char *text, uint16_t color,
         }
         text++;
     }
+    RECORD_RESUME();
 }
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "st7789_backing.h"
+#if FRAME_BUFFER_BPP != 16
+#include "st7789_indexed.h"
+#endif
+
+static const char *TAG = "backing";
+
+static region_list_t frame_regions;
+
+
+/**
+ * @brief Locates the frame buffer bytes of pixels x0..x1 of row y.
+ *
+ * @param bytes Set to the number of bytes of the span; at 4 bpp the span is
+ * widened to whole bytes.
+ */
+static uint8_t *row_span(int16_t y, int16_t x0, int16_t x1, uint16_t *bytes) {
+#if FRAME_BUFFER_BPP == 16
+    *bytes = (x1 - x0 + 1) * 2;
+    return (uint8_t *)(get_frame_buffer() + y * TFT_WIDTH + x0);
+#elif FRAME_BUFFER_BPP == 8
+    *bytes = x1 - x0 + 1;
+    return get_index_buffer() + y * TFT_WIDTH + x0;
+#else
+    uint32_t first = ((uint32_t)y * TFT_WIDTH + x0) >> 1;
+    uint32_t last = ((uint32_t)y * TFT_WIDTH + x1) >> 1;
+    *bytes = last - first + 1;
+    return get_index_buffer() + first;
+#endif
+}
+
+/**
+ * @brief The most bytes a saved row of a given width can take.
+ */
+static size_t row_capacity(uint16_t width) {
+#if FRAME_BUFFER_BPP == 16
+    return (size_t)width * 2;
+#elif FRAME_BUFFER_BPP == 8
+    return width;
+#else
+    return width / 2 + 1;
+#endif
+}
+
+/**
+ * @brief Allocates the store of one object.
+ *
+ * @param max_width Widest bounding box the object will save.
+ * @param max_height Tallest bounding box the object will save.
+ * @return false if there is not enough memory.
+ */
+bool backing_init(backing_t *b, uint16_t max_width, uint16_t max_height) {
+    memset(b, 0, sizeof(*b));
+    b->pixels = malloc(row_capacity(max_width) * max_height);
+    if (b->pixels == NULL) return false;
+    b->max_width = max_width;
+    b->max_height = max_height;
+    return true;
+}
+
+/**
+ * @brief Releases the store of one object.
+ */
+void backing_free(backing_t *b) {
+    free(b->pixels);
+    memset(b, 0, sizeof(*b));
+}
+
+/**
+ * @brief Drops the saved background without restoring it, for when the
+ * whole background has been redrawn under the object.
+ */
+void backing_forget(backing_t *b) {
+    b->saved = false;
+}
+
+/**
+ * @brief Starts a frame: empties the list of rectangles to flush.
+ */
+void backing_begin(void) {
+    region_clear(&frame_regions);
+}
+
+/**
+ * @brief Puts back the background under the box the object was last drawn
+ * in and adds that box to the rectangles to flush.
+ *
+ * Does nothing if the object has not been saved since the last restore.
+ */
+void backing_restore(backing_t *b) {
+    if (!b->saved) return;
+    const region_rect_t *r = &b->box;
+    const uint8_t *src = b->pixels;
+    for (int16_t y = r->y0; y <= r->y1; y++) {
+        uint16_t bytes;
+        uint8_t *dst = row_span(y, r->x0, r->x1, &bytes);
+        memcpy(dst, src, bytes);
+        src += bytes;
+    }
+    region_add(&frame_regions, r->x0, r->y0, r->x1, r->y1);
+    b->saved = false;
+}
+
+/**
+ * @brief Saves the background under the box an object is about to be drawn
+ * in and adds that box to the rectangles to flush.
+ *
+ * The box is clipped to the screen. An object that was saved and not
+ * restored keeps its old background, which would otherwise be lost.
+ *
+ * @return false if the box is off screen, larger than the store, or the
+ * object was not restored.
+ */
+bool backing_save(backing_t *b, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    if (b->saved) {
+        ESP_LOGW(TAG, "object saved twice without a restore");
+        return false;
+    }
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= TFT_WIDTH) x1 = TFT_WIDTH - 1;
+    if (y1 >= TFT_HEIGHT) y1 = TFT_HEIGHT - 1;
+    if (x0 > x1 || y0 > y1) return false;
+    if (x1 - x0 + 1 > b->max_width || y1 - y0 + 1 > b->max_height) {
+        ESP_LOGW(TAG, "box of %dx%d does not fit a store of %ux%u", x1 - x0 + 1, y1 - y0 + 1,
+                 b->max_width, b->max_height);
+        return false;
+    }
+
+    uint8_t *dst = b->pixels;
+    for (int16_t y = y0; y <= y1; y++) {
+        uint16_t bytes;
+        const uint8_t *src = row_span(y, x0, x1, &bytes);
+        memcpy(dst, src, bytes);
+        dst += bytes;
+    }
+    b->box = (region_rect_t){x0, y0, x1, y1};
+    b->saved = true;
+    region_add(&frame_regions, x0, y0, x1, y1);
+    return true;
+}
+
+/**
+ * @brief Sends the rectangles restored and saved since backing_begin.
+ *
+ * The old and new boxes of an object that moved by less than its size
+ * overlap and are sent as their union.
+ *
+ * @return The number of rectangles flushed.
+ */
+uint16_t backing_flush(void) {
+    region_merge(&frame_regions);
+    for (uint16_t i = 0; i < frame_regions.count; i++) {
+        const region_rect_t *r = &frame_regions.rects[i];
+        flush_frame_buffer_rect(r->x0, r->y0, r->x1, r->y1);
+    }
+    uint16_t flushed = frame_regions.count;
+    region_clear(&frame_regions);
+    return flushed;
+}
+
+#if FRAME_BUFFER_BPP == 16
+/**
+ * @brief Reads an image in the load_image format into the frame buffer, as
+ * the background for the objects.
+ *
+ * Unlike load_image, nothing is sent to the display.
+ *
+ * @return false if the file cannot be opened or is short.
+ */
+bool backing_load(const char *path) {
+    bool complete = read_image(path, get_frame_buffer());
+    if (!complete) ESP_LOGE(TAG, "cannot read %s", path);
+    return complete;
+}
+#endif
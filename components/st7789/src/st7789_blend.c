@@ -0,0 +1,192 @@
+#include "st7789_blend.h"
+
+//RGB565 only, the indexed frame buffer has no colors to blend
+#if FRAME_BUFFER_BPP == 16
+
+
+/**
+ * @brief Blends a solid color over a run of pixels with constant alpha.
+ *
+ * After an optional leading pixel to reach 4-byte alignment, the run is
+ * processed as packed pixel pairs with blend565x2.
+ *
+ * @param dst Pointer to the first pixel.
+ * @param count Number of pixels.
+ * @param color The color to blend in.
+ * @param alpha Opacity of the color, 0 to 255.
+ */
+void blend_fill(uint16_t *dst, uint32_t count, uint16_t color, uint8_t alpha) {
+    uint32_t a = ALPHA8_TO_5(alpha);
+    if (a == 0 || count == 0) return;
+    if (a == ALPHA5_OPAQUE) {
+        fill_pixels(dst, count, color);
+        return;
+    }
+
+    if ((uintptr_t)dst & 2) {
+        *dst = blend565(color, *dst, a);
+        dst++;
+        count--;
+    }
+
+    uint32_t pair = ((uint32_t)color << 16) | color;
+    pixel_pair_t *dst32 = (pixel_pair_t *)dst;
+    for (uint32_t pairs = count >> 1; pairs; pairs--) {
+        *dst32 = blend565x2(pair, *dst32, a);
+        dst32++;
+    }
+
+    if (count & 1) {
+        uint16_t *last = (uint16_t *)dst32;
+        *last = blend565(color, *last, a);
+    }
+}
+
+/**
+ * @brief Blends a row of source pixels over the destination with constant alpha.
+ *
+ * Pixel pairs are used when source and destination share the same alignment,
+ * which is always the case for even-width sprites at even x positions.
+ *
+ * @param dst Pointer to the first destination pixel.
+ * @param src Pointer to the first source pixel.
+ * @param count Number of pixels.
+ * @param alpha Opacity of the source, 0 to 255.
+ */
+void blend_row(uint16_t *dst, const uint16_t *src, uint32_t count, uint8_t alpha) {
+    uint32_t a = ALPHA8_TO_5(alpha);
+    if (a == 0 || count == 0) return;
+    if (a == ALPHA5_OPAQUE) {
+        memcpy(dst, src, count * sizeof(uint16_t));
+        return;
+    }
+
+    if ((((uintptr_t)dst ^ (uintptr_t)src) & 2) == 0) {
+        if ((uintptr_t)dst & 2) {
+            *dst = blend565(*src++, *dst, a);
+            dst++;
+            count--;
+        }
+        pixel_pair_t *dst32 = (pixel_pair_t *)dst;
+        const pixel_pair_t *src32 = (const pixel_pair_t *)src;
+        for (uint32_t pairs = count >> 1; pairs; pairs--) {
+            *dst32 = blend565x2(*src32++, *dst32, a);
+            dst32++;
+        }
+        dst = (uint16_t *)dst32;
+        src = (const uint16_t *)src32;
+        count &= 1;
+    }
+
+    while (count--) {
+        *dst = blend565(*src++, *dst, a);
+        dst++;
+    }
+}
+
+/**
+ * @brief Blends a row of source pixels using an 8-bit alpha value per pixel.
+ *
+ * Fully opaque runs are copied with memcpy and fully transparent pixels are
+ * skipped, so only edge pixels pay for the multiply.
+ *
+ * @param dst Pointer to the first destination pixel.
+ * @param src Pointer to the first source pixel.
+ * @param alpha Pointer to the alpha value of the first source pixel.
+ * @param count Number of pixels.
+ */
+void blend_row_alpha8(uint16_t *dst, const uint16_t *src, const uint8_t *alpha, uint32_t count) {
+    uint32_t x = 0;
+    while (x < count) {
+        if (alpha[x] == 0xFF) {
+            uint32_t run = x;
+            while (x < count && alpha[x] == 0xFF) x++;
+            memcpy(dst + run, src + run, (x - run) * sizeof(uint16_t));
+        } else {
+            if (alpha[x]) dst[x] = blend565(src[x], dst[x], ALPHA8_TO_5(alpha[x]));
+            x++;
+        }
+    }
+}
+
+/**
+ * @brief Blends a row of source pixels using a 5-bit mask value per pixel.
+ *
+ * Mask values go from 0 (transparent) to 31 (opaque).
+ *
+ * @param dst Pointer to the first destination pixel.
+ * @param src Pointer to the first source pixel.
+ * @param mask Pointer to the mask value of the first source pixel.
+ * @param count Number of pixels.
+ */
+void blend_row_mask5(uint16_t *dst, const uint16_t *src, const uint8_t *mask, uint32_t count) {
+    for (uint32_t x = 0; x < count; x++) {
+        uint8_t m = mask[x];
+        if (m >= 31) {
+            dst[x] = src[x];
+        } else if (m) {
+            dst[x] = blend565(src[x], dst[x], MASK5_TO_ALPHA5(m));
+        }
+    }
+}
+
+/**
+ * @brief Blends a solid color through a 5-bit coverage mask.
+ *
+ * This is the kernel for anti-aliased edges and glyphs: the mask holds the
+ * coverage of each pixel from 0 (none) to 31 (full).
+ *
+ * @param dst Pointer to the first destination pixel.
+ * @param color The color to blend in.
+ * @param mask Pointer to the coverage of the first pixel.
+ * @param count Number of pixels.
+ */
+void blend_color_mask5(uint16_t *dst, uint16_t color, const uint8_t *mask, uint32_t count) {
+    uint32_t f = (color | ((uint32_t)color << 16)) & BLEND_SPREAD_MASK;
+    for (uint32_t x = 0; x < count; x++) {
+        uint8_t m = mask[x];
+        if (m >= 31) {
+            dst[x] = color;
+        } else if (m) {
+            uint32_t b = (dst[x] | ((uint32_t)dst[x] << 16)) & BLEND_SPREAD_MASK;
+            uint32_t r = ((((f - b) * MASK5_TO_ALPHA5(m)) >> 5) + b) & BLEND_SPREAD_MASK;
+            dst[x] = (uint16_t)(r | (r >> 16));
+        }
+    }
+}
+
+/**
+ * @brief Draws a translucent filled rectangle.
+ *
+ * The coordinates are clamped and ordered the same way as draw_rectangle.
+ *
+ * @param x1 The x-coordinate of the top-left corner of the rectangle.
+ * @param y1 The y-coordinate of the top-left corner of the rectangle.
+ * @param x2 The x-coordinate of the bottom-right corner of the rectangle.
+ * @param y2 The y-coordinate of the bottom-right corner of the rectangle.
+ * @param color The color to blend in.
+ * @param alpha Opacity of the color, 0 to 255.
+ */
+void fill_rect_alpha(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha) {
+    x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
+    x2 = (x2 < TFT_WIDTH) ? x2 : TFT_WIDTH - 1;
+    y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
+    y2 = (y2 < TFT_HEIGHT) ? y2 : TFT_HEIGHT - 1;
+
+    if (x1 > x2) { uint16_t t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { uint16_t t = y1; y1 = y2; y2 = t; }
+
+    uint16_t *row = get_frame_buffer() + y1 * TFT_WIDTH + x1;
+    uint16_t width = x2 - x1 + 1;
+
+    if (width == TFT_WIDTH) {
+        blend_fill(row, (uint32_t)width * (y2 - y1 + 1), color, alpha);
+        return;
+    }
+    for (uint16_t y = y1; y <= y2; y++) {
+        blend_fill(row, width, color, alpha);
+        row += TFT_WIDTH;
+    }
+}
+
+#endif
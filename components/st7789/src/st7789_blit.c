@@ -0,0 +1,187 @@
+#include "st7789_blit.h"
+#include "st7789_blend.h"
+
+//RGB565 only, the indexed frame buffer has no colors to copy
+#if FRAME_BUFFER_BPP == 16
+
+typedef struct {
+    const uint16_t *src; //first visible source pixel
+    const uint8_t *alpha; //first visible alpha value, NULL without alpha
+    uint16_t *dst; //first destination pixel in the frame buffer
+    uint16_t src_stride;
+    uint16_t w;
+    uint16_t h;
+} blit_region_t;
+
+
+/**
+ * @brief Clips a blit against the sprite and the screen.
+ *
+ * The source rectangle is first limited to the sprite, then the destination
+ * rectangle is limited to the screen and the source origin is moved by the
+ * same amount. This is the only clipping a blit does; the row loops that
+ * follow never test coordinates.
+ *
+ * @param region Filled with the clipped source and destination pointers.
+ * @return false if nothing is visible.
+ */
+static bool blit_clip(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h,
+                      int16_t dx, int16_t dy, blit_region_t *region) {
+    if (sx >= src->width || sy >= src->height) return false;
+    if (w > src->width - sx) w = src->width - sx;
+    if (h > src->height - sy) h = src->height - sy;
+
+    int32_t x0 = dx, y0 = dy;
+    int32_t x1 = x0 + w, y1 = y0 + h;
+    if (x0 < 0) { sx -= x0; x0 = 0; }
+    if (y0 < 0) { sy -= y0; y0 = 0; }
+    if (x1 > TFT_WIDTH) x1 = TFT_WIDTH;
+    if (y1 > TFT_HEIGHT) y1 = TFT_HEIGHT;
+    if (x0 >= x1 || y0 >= y1) return false;
+
+    uint16_t stride = src->stride ? src->stride : src->width;
+    uint32_t offset = (uint32_t)sy * stride + sx;
+
+    region->src = src->pixels + offset;
+    region->alpha = src->alpha ? src->alpha + offset : NULL;
+    region->dst = get_frame_buffer() + y0 * TFT_WIDTH + x0;
+    region->src_stride = stride;
+    region->w = x1 - x0;
+    region->h = y1 - y0;
+    return true;
+}
+
+/**
+ * @brief Copies a rectangle of a sprite into the frame buffer.
+ *
+ * Every visible row is copied with a single memcpy.
+ *
+ * @param src The sprite to copy from.
+ * @param sx The x-coordinate of the source rectangle inside the sprite.
+ * @param sy The y-coordinate of the source rectangle inside the sprite.
+ * @param w The width of the source rectangle, BLIT_FULL_W for the rest of the sprite.
+ * @param h The height of the source rectangle, BLIT_FULL_H for the rest of the sprite.
+ * @param dx The x-coordinate on screen of the top-left corner.
+ * @param dy The y-coordinate on screen of the top-left corner.
+ */
+void blit(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy) {
+    blit_region_t r;
+    if (!blit_clip(src, sx, sy, w, h, dx, dy, &r)) return;
+
+    size_t row_bytes = r.w * sizeof(uint16_t);
+    for (uint16_t y = 0; y < r.h; y++) {
+        memcpy(r.dst, r.src, row_bytes);
+        r.src += r.src_stride;
+        r.dst += TFT_WIDTH;
+    }
+}
+
+/**
+ * @brief Copies a rectangle of a sprite, skipping pixels of the key color.
+ *
+ * Each row is scanned for runs of opaque pixels and every run is copied with
+ * memcpy, so sprites with large solid areas cost close to an opaque blit.
+ *
+ * @param src The sprite to copy from.
+ * @param sx The x-coordinate of the source rectangle inside the sprite.
+ * @param sy The y-coordinate of the source rectangle inside the sprite.
+ * @param w The width of the source rectangle, BLIT_FULL_W for the rest of the sprite.
+ * @param h The height of the source rectangle, BLIT_FULL_H for the rest of the sprite.
+ * @param dx The x-coordinate on screen of the top-left corner.
+ * @param dy The y-coordinate on screen of the top-left corner.
+ * @param key The transparent color.
+ */
+void blit_keyed(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy, uint16_t key) {
+    blit_region_t r;
+    if (!blit_clip(src, sx, sy, w, h, dx, dy, &r)) return;
+
+    for (uint16_t y = 0; y < r.h; y++) {
+        const uint16_t *s = r.src;
+        uint16_t x = 0;
+        while (x < r.w) {
+            while (x < r.w && s[x] == key) x++;
+            uint16_t run = x;
+            while (x < r.w && s[x] != key) x++;
+            if (x > run) {
+                memcpy(r.dst + run, s + run, (x - run) * sizeof(uint16_t));
+            }
+        }
+        r.src += r.src_stride;
+        r.dst += TFT_WIDTH;
+    }
+}
+
+/**
+ * @brief Blends a rectangle of a sprite using its per-pixel alpha plane.
+ *
+ * Each row goes through blend_row_alpha8, which copies opaque runs, skips
+ * transparent pixels and blends the rest. Sprites without an alpha plane are
+ * copied as opaque.
+ *
+ * @param src The sprite to copy from.
+ * @param sx The x-coordinate of the source rectangle inside the sprite.
+ * @param sy The y-coordinate of the source rectangle inside the sprite.
+ * @param w The width of the source rectangle, BLIT_FULL_W for the rest of the sprite.
+ * @param h The height of the source rectangle, BLIT_FULL_H for the rest of the sprite.
+ * @param dx The x-coordinate on screen of the top-left corner.
+ * @param dy The y-coordinate on screen of the top-left corner.
+ */
+void blit_alpha(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy) {
+    if (!src->alpha) {
+        blit(src, sx, sy, w, h, dx, dy);
+        return;
+    }
+
+    blit_region_t r;
+    if (!blit_clip(src, sx, sy, w, h, dx, dy, &r)) return;
+
+    for (uint16_t y = 0; y < r.h; y++) {
+        blend_row_alpha8(r.dst, r.src, r.alpha, r.w);
+        r.src += r.src_stride;
+        r.alpha += r.src_stride;
+        r.dst += TFT_WIDTH;
+    }
+}
+
+/**
+ * @brief Blends a rectangle of a sprite with one opacity for every pixel.
+ *
+ * Rows are blended two pixels per word where the alignment allows it. This
+ * is the building block for fading sprites in and out.
+ *
+ * @param src The sprite to copy from.
+ * @param sx The x-coordinate of the source rectangle inside the sprite.
+ * @param sy The y-coordinate of the source rectangle inside the sprite.
+ * @param w The width of the source rectangle, BLIT_FULL_W for the rest of the sprite.
+ * @param h The height of the source rectangle, BLIT_FULL_H for the rest of the sprite.
+ * @param dx The x-coordinate on screen of the top-left corner.
+ * @param dy The y-coordinate on screen of the top-left corner.
+ * @param alpha Opacity of the sprite, 0 to 255.
+ */
+void blit_blend(const sprite_t *src, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy, uint8_t alpha) {
+    blit_region_t r;
+    if (!blit_clip(src, sx, sy, w, h, dx, dy, &r)) return;
+
+    for (uint16_t y = 0; y < r.h; y++) {
+        blend_row(r.dst, r.src, r.w, alpha);
+        r.src += r.src_stride;
+        r.dst += TFT_WIDTH;
+    }
+}
+
+/**
+ * @brief Draws a whole sprite, blending it if it has an alpha plane.
+ *
+ * @param src The sprite to draw.
+ * @param dx The x-coordinate on screen of the top-left corner.
+ * @param dy The y-coordinate on screen of the top-left corner.
+ */
+void draw_sprite(const sprite_t *src, int16_t dx, int16_t dy) {
+    if (src->alpha) {
+        blit_alpha(src, 0, 0, BLIT_FULL_W, BLIT_FULL_H, dx, dy);
+    } else {
+        blit(src, 0, 0, BLIT_FULL_W, BLIT_FULL_H, dx, dy);
+    }
+}
+
+#endif
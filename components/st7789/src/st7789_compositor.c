@@ -0,0 +1,338 @@
+#include "st7789_compositor.h"
+#include "st7789_blend.h"
+
+//RGB565 only, like the blits: the layers are composited into the frame buffer
+#if FRAME_BUFFER_BPP == 16
+
+static const char *TAG = "compositor";
+
+typedef struct {
+    uint16_t *pixels; //NULL when nothing is attached
+    const uint8_t *alpha; //COMP_ALPHA, NULL for a constant alpha
+    uint16_t width, height;
+    int16_t x, y;
+    uint8_t mode;
+    bool visible;
+    uint16_t key;
+    uint8_t opacity; //constant alpha of COMP_ALPHA layers
+    region_list_t dirty;
+} comp_layer_t;
+
+static comp_layer_t layers[COMP_LAYERS];
+static uint16_t background;
+static bool full_redraw;
+
+
+static comp_layer_t *layer_get(uint8_t layer) {
+    if (layer >= COMP_LAYERS || layers[layer].pixels == NULL) return NULL;
+    return &layers[layer];
+}
+
+/**
+ * @brief Dirties the screen rectangle a layer covers, shown or not.
+ */
+static void dirty_bounds(comp_layer_t *l) {
+    region_add(&l->dirty, l->x, l->y, l->x + l->width - 1, l->y + l->height - 1);
+}
+
+/**
+ * @brief Detaches every layer and makes the next update recomposite the whole screen.
+ *
+ * @param color The color where no layer is drawn.
+ */
+void comp_init(uint16_t color) {
+    memset(layers, 0, sizeof(layers));
+    background = color;
+    full_redraw = true;
+}
+
+/**
+ * @brief Puts a bitmap in a layer, shown, at the top-left corner of the screen.
+ *
+ * @param layer The layer, 0 is the bottom one.
+ * @param pixels RGB565 pixels, width * height, row by row. They stay owned
+ *               by the caller and are read at every update.
+ * @param alpha 8-bit alpha per pixel for COMP_ALPHA layers, or NULL.
+ * @param width The width of the bitmap.
+ * @param height The height of the bitmap.
+ * @param mode How the layer is drawn over the ones below.
+ */
+void comp_layer_attach(uint8_t layer, uint16_t *pixels, const uint8_t *alpha, uint16_t width, uint16_t height,
+                       comp_mode_t mode) {
+    if (layer >= COMP_LAYERS) return;
+    comp_layer_t *l = &layers[layer];
+    if (l->pixels && l->visible) dirty_bounds(l);
+
+    l->pixels = pixels;
+    l->alpha = alpha;
+    l->width = width;
+    l->height = height;
+    l->x = 0;
+    l->y = 0;
+    l->mode = mode;
+    l->visible = true;
+    l->key = 0;
+    l->opacity = 0xFF;
+    dirty_bounds(l);
+}
+
+/**
+ * @brief Empties a layer.
+ */
+void comp_layer_detach(uint8_t layer) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL) return;
+    if (l->visible) dirty_bounds(l);
+    l->pixels = NULL;
+}
+
+/**
+ * @brief Reads an image in the load_image format into a full-screen layer.
+ *
+ * @return false if the layer is not TFT_WIDTH x TFT_HEIGHT or the file cannot
+ * be read whole.
+ */
+bool comp_layer_load(uint8_t layer, const char *path) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || l->width != TFT_WIDTH || l->height != TFT_HEIGHT) {
+        ESP_LOGE(TAG, "layer %u is not a full-screen layer", layer);
+        return false;
+    }
+    bool complete = read_image(path, l->pixels);
+    if (!complete) ESP_LOGE(TAG, "cannot read %s", path);
+    if (l->visible) dirty_bounds(l);
+    return complete;
+}
+
+/**
+ * @brief Moves a layer, dirtying the rectangles it leaves and enters.
+ *
+ * @param x The screen x-coordinate of the top-left corner.
+ * @param y The screen y-coordinate of the top-left corner.
+ */
+void comp_layer_move(uint8_t layer, int16_t x, int16_t y) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || (l->x == x && l->y == y)) return;
+    if (l->visible) dirty_bounds(l);
+    l->x = x;
+    l->y = y;
+    if (l->visible) dirty_bounds(l);
+}
+
+/**
+ * @brief Shows or hides a layer.
+ */
+void comp_layer_show(uint8_t layer, bool visible) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || l->visible == visible) return;
+    l->visible = visible;
+    dirty_bounds(l);
+}
+
+/**
+ * @brief Sets the transparent color of a COMP_KEYED layer.
+ */
+void comp_layer_set_key(uint8_t layer, uint16_t key) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || l->key == key) return;
+    l->key = key;
+    if (l->visible && l->mode == COMP_KEYED) dirty_bounds(l);
+}
+
+/**
+ * @brief Sets the constant alpha of a COMP_ALPHA layer, 255 by default.
+ */
+void comp_layer_set_alpha(uint8_t layer, uint8_t alpha) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || l->opacity == alpha) return;
+    l->opacity = alpha;
+    if (l->visible && l->mode == COMP_ALPHA) dirty_bounds(l);
+}
+
+/**
+ * @brief Dirties a rectangle of a layer after its pixels were written.
+ *
+ * @param x0 The layer x-coordinate of one corner.
+ * @param y0 The layer y-coordinate of one corner.
+ * @param x1 The layer x-coordinate of the opposite corner.
+ * @param y1 The layer y-coordinate of the opposite corner.
+ */
+void comp_layer_invalidate(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL || !l->visible) return;
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= l->width) x1 = l->width - 1;
+    if (y1 >= l->height) y1 = l->height - 1;
+    if (x0 > x1 || y0 > y1) return;
+    region_add(&l->dirty, l->x + x0, l->y + y0, l->x + x1, l->y + y1);
+}
+
+/**
+ * @brief Fills a rectangle of a layer's pixels and dirties it.
+ *
+ * Coordinates are in the layer and clipped to it.
+ */
+void comp_layer_fill(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL) return;
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= l->width) x1 = l->width - 1;
+    if (y1 >= l->height) y1 = l->height - 1;
+    if (x0 > x1 || y0 > y1) return;
+
+    for (int16_t y = y0; y <= y1; y++) {
+        fill_pixels(&l->pixels[y * l->width + x0], x1 - x0 + 1, color);
+    }
+    comp_layer_invalidate(layer, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Draws text into a layer's pixels, laid out as draw_text_scaled does, and dirties it.
+ *
+ * Only the set pixels of the glyphs are written, so on a COMP_KEYED layer
+ * cleared to the key the text ends up over the layers below.
+ */
+void comp_layer_text(uint8_t layer, int16_t x, int16_t y, const char *text, uint16_t color, uint8_t scale,
+                     const uint8_t *font) {
+    comp_layer_t *l = layer_get(layer);
+    if (l == NULL) return;
+    int16_t top = y, cursor = x, right = x - 1, bottom = y - 1;
+
+    for (; *text; text++) {
+        if (*text == '\n') {
+            y += (FONT_HEIGHT + 2) * scale;
+            cursor = x;
+            continue;
+        }
+        if (*text >= FONT_START && *text <= FONT_END) {
+            const uint8_t *glyph = &font[(*text - FONT_START) * FONT_HEIGHT];
+            for (int row = 0; row < FONT_HEIGHT * scale; row++) {
+                int16_t py = y + row;
+                if (py < 0 || py >= l->height) continue;
+                uint8_t line = glyph[row / scale];
+                for (int col = 0; col < FONT_WIDTH * scale; col++) {
+                    int16_t px = cursor + col;
+                    if (px < 0 || px >= l->width || !(line & (1 << (7 - col / scale)))) continue;
+                    l->pixels[py * l->width + px] = color;
+                }
+            }
+        }
+        cursor += FONT_WIDTH * scale;
+        if (cursor - 1 > right) right = cursor - 1;
+        if (y + FONT_HEIGHT * scale - 1 > bottom) bottom = y + FONT_HEIGHT * scale - 1;
+    }
+    comp_layer_invalidate(layer, x, top, right, bottom);
+}
+
+/**
+ * @brief Tells whether a layer hides every pixel of a row span.
+ */
+static bool covers_span(const comp_layer_t *l, int16_t y, int16_t x0, int16_t x1) {
+    if (l->pixels == NULL || !l->visible) return false;
+    if (l->mode == COMP_KEYED) return false;
+    if (l->mode == COMP_ALPHA && (l->alpha || l->opacity != 0xFF)) return false;
+    return y >= l->y && y < l->y + l->height && x0 >= l->x && x1 < l->x + l->width;
+}
+
+/**
+ * @brief Draws the part of a layer on a row span over what is already there.
+ *
+ * @param dst The frame buffer pixel at x0.
+ */
+static void draw_span(const comp_layer_t *l, int16_t y, int16_t x0, int16_t x1, uint16_t *dst) {
+    if (l->pixels == NULL || !l->visible || y < l->y || y >= l->y + l->height) return;
+    int16_t xa = (x0 > l->x) ? x0 : l->x;
+    int16_t xb = (x1 < l->x + l->width - 1) ? x1 : l->x + l->width - 1;
+    if (xa > xb) return;
+
+    uint32_t offset = (uint32_t)(y - l->y) * l->width + (xa - l->x);
+    const uint16_t *src = &l->pixels[offset];
+    uint16_t *d = dst + (xa - x0);
+    uint32_t n = xb - xa + 1;
+
+    switch (l->mode) {
+        case COMP_OPAQUE:
+            memcpy(d, src, n * sizeof(uint16_t));
+            break;
+        case COMP_KEYED:
+            for (uint32_t i = 0; i < n; i++) {
+                if (src[i] != l->key) d[i] = src[i];
+            }
+            break;
+        case COMP_ALPHA:
+            if (l->alpha == NULL) {
+                blend_row(d, src, n, l->opacity);
+            } else if (l->opacity == 0xFF) {
+                blend_row_alpha8(d, src, &l->alpha[offset], n);
+            } else {
+                const uint8_t *a = &l->alpha[offset];
+                for (uint32_t i = 0; i < n; i++) {
+                    uint32_t weight = ALPHA8_TO_5((a[i] * l->opacity + 127) / 255);
+                    if (weight) d[i] = blend565(src[i], d[i], weight);
+                }
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Recomposites one rectangle of the frame buffer.
+ *
+ * For each row the layers are walked top-down until one covers the whole
+ * span opaquely; that layer and the ones above it are drawn bottom up.
+ */
+static void composite(const region_rect_t *r) {
+    uint16_t *fb = get_frame_buffer();
+    uint32_t n = r->x1 - r->x0 + 1;
+
+    for (int16_t y = r->y0; y <= r->y1; y++) {
+        uint16_t *dst = &fb[y * TFT_WIDTH + r->x0];
+        int8_t base = COMP_LAYERS - 1;
+        while (base >= 0 && !covers_span(&layers[base], y, r->x0, r->x1)) base--;
+        if (base < 0) {
+            fill_pixels(dst, n, background);
+            base = 0;
+        }
+        for (uint8_t i = base; i < COMP_LAYERS; i++) {
+            draw_span(&layers[i], y, r->x0, r->x1, dst);
+        }
+    }
+}
+
+/**
+ * @brief Recomposites and flushes the dirty rectangles of every layer.
+ *
+ * The rectangles of all layers are gathered in one list and merged before
+ * compositing. The first update after comp_init does the whole screen.
+ *
+ * @return The number of rectangles flushed, 0 when nothing changed.
+ */
+uint16_t comp_update(void) {
+    region_list_t regions;
+    region_clear(&regions);
+    if (full_redraw) {
+        region_add(&regions, 0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1);
+        full_redraw = false;
+    }
+    for (uint8_t i = 0; i < COMP_LAYERS; i++) {
+        region_add_list(&regions, &layers[i].dirty);
+        region_clear(&layers[i].dirty);
+    }
+    if (regions.count == 0) return 0;
+
+    region_merge(&regions);
+    for (uint16_t i = 0; i < regions.count; i++) {
+        const region_rect_t *r = &regions.rects[i];
+        composite(r);
+        flush_frame_buffer_rect(r->x0, r->y0, r->x1, r->y1);
+    }
+    return regions.count;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "st7789_dither.h"
+
+static const uint8_t bayer[DITHER_BAYER_SIZE][DITHER_BAYER_SIZE] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+static const uint8_t channel_bits[3] = {5, 6, 5};
+
+
+/**
+ * @brief Prepares a converter for rows of a given width.
+ *
+ * @param mode How the rows are dithered.
+ * @param width Pixels per row.
+ * @return false if there is no memory for the error buffer.
+ */
+bool dither_init(dither_t *d, dither_mode_t mode, uint16_t width) {
+    memset(d, 0, sizeof(*d));
+    d->mode = mode;
+    d->width = width;
+    if (mode == DITHER_DIFFUSION) {
+        d->error = calloc((size_t)width * 3, sizeof(int16_t));
+        if (d->error == NULL) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the error buffer of a converter.
+ */
+void dither_free(dither_t *d) {
+    free(d->error);
+    memset(d, 0, sizeof(*d));
+}
+
+/**
+ * @brief Starts a new image: back to the first Bayer row, no carried error.
+ */
+void dither_reset(dither_t *d) {
+    d->row = 0;
+    if (d->error) memset(d->error, 0, (size_t)d->width * 3 * sizeof(int16_t));
+}
+
+static inline void store(void *out, uint16_t x, uint16_t color, bool panel) {
+    if (panel) {
+        uint8_t *bytes = out;
+        bytes[2 * x] = color >> 8;
+        bytes[2 * x + 1] = color & 0xFF;
+    } else {
+        ((uint16_t *)out)[x] = color;
+    }
+}
+
+static inline uint8_t saturate(int16_t v) {
+    return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/**
+ * @brief Floyd-Steinberg over one row.
+ *
+ * error[] holds, in 1/16, the error the previous row pushed down to every
+ * pixel. While the row is walked left to right, the entries left of x are
+ * overwritten with what this row pushes down to the next one: 3/16 down-left,
+ * 5/16 down and 1/16 down-right, and 7/16 goes right. Each channel is
+ * truncated and its error taken against the 8-bit value the panel shows for
+ * the truncated one, the top bits repeated in the low bits.
+ */
+static inline void diffuse_row(int16_t *error, uint16_t width, const uint8_t *rgb, void *out, bool panel) {
+    int16_t right[3] = {0}, below[3] = {0}, below_right[3] = {0};
+
+    for (uint16_t x = 0; x < width; x++) {
+        uint16_t color = 0;
+        for (uint8_t ch = 0; ch < 3; ch++) {
+            uint8_t bits = channel_bits[ch];
+            int16_t *e = &error[3 * x + ch];
+            uint8_t v = saturate(rgb[3 * x + ch] + ((*e + right[ch] + 8) >> 4));
+            uint8_t q = v >> (8 - bits);
+            int16_t shown = (q << (8 - bits)) | (q >> (2 * bits - 8));
+            int16_t err = v - shown;
+
+            right[ch] = 7 * err;
+            if (x > 0) e[-3] = below[ch] + 3 * err;
+            below[ch] = below_right[ch] + 5 * err;
+            below_right[ch] = err;
+            color = (color << bits) | q;
+        }
+        store(out, x, color, panel);
+    }
+    if (width > 0) {
+        for (uint8_t ch = 0; ch < 3; ch++) error[3 * (width - 1) + ch] = below[ch];
+    }
+}
+
+static inline void convert_row(dither_t *d, const uint8_t *rgb, void *out, bool panel) {
+    switch (d->mode) {
+    case DITHER_NONE:
+        for (uint16_t x = 0; x < d->width; x++, rgb += 3) {
+            store(out, x, ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3), panel);
+        }
+        break;
+    case DITHER_ORDERED: {
+        //the threshold spans one step of the channel around 0, -4..3 for 5 bits
+        //and -2..1 for 6, so on average the panel shows the RGB888 value
+        const uint8_t *threshold = bayer[d->row % DITHER_BAYER_SIZE];
+        for (uint16_t x = 0; x < d->width; x++, rgb += 3) {
+            int8_t t = threshold[x % DITHER_BAYER_SIZE] - 8;
+            uint8_t r = saturate(rgb[0] + (t >> 1));
+            uint8_t g = saturate(rgb[1] + (t >> 2));
+            uint8_t b = saturate(rgb[2] + (t >> 1));
+            store(out, x, ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3), panel);
+        }
+        break;
+    }
+    case DITHER_DIFFUSION:
+        diffuse_row(d->error, d->width, rgb, out, panel);
+        break;
+    }
+    d->row++;
+}
+
+/**
+ * @brief Converts the next row of an image into RGB565 values.
+ *
+ * @param rgb width pixels of 3 bytes, red first.
+ * @param out width RGB565 values.
+ */
+void rgb888_to_rgb565_row(dither_t *d, const uint8_t *rgb, uint16_t *out) {
+    convert_row(d, rgb, out, false);
+}
+
+/**
+ * @brief Converts the next row of an image into panel byte order, ready for
+ * RAMWR.
+ *
+ * @param rgb width pixels of 3 bytes, red first.
+ * @param out 2 x width bytes, high byte first.
+ */
+void rgb888_to_rgb565_row_panel(dither_t *d, const uint8_t *rgb, uint8_t *out) {
+    convert_row(d, rgb, out, true);
+}
+
+/**
+ * @brief Converts a whole RGB888 image into RGB565 values.
+ *
+ * @param rgb width x height pixels of 3 bytes, row by row.
+ * @param out width x height RGB565 values.
+ * @return false if there is no memory for the error buffer.
+ */
+bool rgb888_to_rgb565_buffer(dither_mode_t mode, const uint8_t *rgb, uint16_t *out, uint16_t width, uint16_t height) {
+    dither_t d;
+    if (!dither_init(&d, mode, width)) return false;
+    for (uint16_t y = 0; y < height; y++) {
+        rgb888_to_rgb565_row(&d, rgb + (size_t)y * width * 3, out + (size_t)y * width);
+    }
+    dither_free(&d);
+    return true;
+}
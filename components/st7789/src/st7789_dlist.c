@@ -0,0 +1,502 @@
+#include "st7789_dlist.h"
+#include "st7789_fxmath.h"
+#include "st7789_perf.h"
+#include "st7789_trace.h"
+#include "st7789_transport.h"
+
+static const char *TAG = "dlist";
+
+typedef enum {
+    DL_RECT,
+    DL_CIRCLE,
+    DL_TEXT,
+    DL_SPRITE,
+    DL_SPRITE_KEYED
+} dl_kind_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t visible;
+    uint8_t scale; //text
+    int16_t x, y; //circle center, text or sprite top-left corner
+    int16_t x0, y0, x1, y1; //bounding box, inclusive, may be off screen
+    uint16_t color; //fill color in panel byte order, or the sprite color key
+    uint16_t arg; //circle radius or text offset in the pool
+    uint16_t length; //text
+    const void *data; //font or sprite
+    uint32_t text_sig; //hash of the text, computed once when it is added
+    uint32_t sig; //hash of everything above, updated on every change
+} dl_command_t;
+
+static dl_command_t commands[DL_MAX_COMMANDS];
+static uint16_t command_count;
+static char text_pool[DL_TEXT_POOL];
+static uint16_t text_used;
+static uint16_t background; //panel byte order
+
+static uint32_t tile_sigs[DL_TILES_Y * DL_TILES_X]; //signature each tile was last sent with
+static bool tiles_valid; //tile_sigs match the panel
+static DMA_ATTR uint16_t tile_buffers[2][DL_TILE_WIDTH * DL_TILE_HEIGHT];
+static dl_stats_t stats;
+static bool full_warned;
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+
+static uint32_t fnv_add(uint32_t h, const void *data, size_t size) {
+    const uint8_t *p = data;
+    while (size--) h = (h ^ *p++) * FNV_PRIME;
+    return h;
+}
+
+static inline uint16_t swap_bytes(uint16_t color) {
+    return (color >> 8) | (color << 8);
+}
+
+/**
+ * @brief Recomputes the signature of a command after it changed.
+ */
+static void command_sign(dl_command_t *c) {
+    uint32_t h = FNV_OFFSET;
+    h = fnv_add(h, &c->kind, 1);
+    h = fnv_add(h, &c->visible, 1);
+    h = fnv_add(h, &c->scale, 1);
+    h = fnv_add(h, &c->x, sizeof(c->x));
+    h = fnv_add(h, &c->y, sizeof(c->y));
+    h = fnv_add(h, &c->x0, sizeof(c->x0) * 4);
+    h = fnv_add(h, &c->color, sizeof(c->color));
+    h = fnv_add(h, &c->data, sizeof(c->data));
+    h = fnv_add(h, &c->text_sig, sizeof(c->text_sig));
+    if (c->kind == DL_CIRCLE) h = fnv_add(h, &c->arg, sizeof(c->arg));
+    c->sig = h;
+}
+
+/**
+ * @brief Takes the next free command, NULL when the list is full.
+ */
+static dl_command_t *command_new(dl_kind_t kind) {
+    if (command_count == DL_MAX_COMMANDS) {
+        if (!full_warned) ESP_LOGW(TAG, "display list full, %d commands", DL_MAX_COMMANDS);
+        full_warned = true;
+        return NULL;
+    }
+    dl_command_t *c = &commands[command_count++];
+    memset(c, 0, sizeof(*c));
+    c->kind = kind;
+    c->visible = 1;
+    return c;
+}
+
+static dl_command_t *command_get(dl_handle_t handle) {
+    if (handle < 0 || handle >= command_count) return NULL;
+    return &commands[handle];
+}
+
+/**
+ * @brief Empties the list.
+ *
+ * The signatures of the tiles are kept, so the tiles the new list draws the
+ * same way as the previous one are not sent again.
+ *
+ * @param color The color of the pixels no command covers.
+ */
+void dl_reset(uint16_t color) {
+    command_count = 0;
+    text_used = 0;
+    background = swap_bytes(color);
+    full_warned = false;
+}
+
+/**
+ * @brief Adds a filled rectangle, opaque. Corners as in draw_rectangle.
+ *
+ * @return The handle of the rectangle, -1 if the list is full.
+ */
+dl_handle_t dl_rect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    dl_command_t *c = command_new(DL_RECT);
+    if (c == NULL) return -1;
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    c->x = c->x0 = x0;
+    c->y = c->y0 = y0;
+    c->x1 = x1;
+    c->y1 = y1;
+    c->color = swap_bytes(color);
+    command_sign(c);
+    return c - commands;
+}
+
+/**
+ * @brief Adds a filled circle, drawn with the same pixels as fill_circle.
+ *
+ * @return The handle of the circle, -1 if the list is full.
+ */
+dl_handle_t dl_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+    dl_command_t *c = command_new(DL_CIRCLE);
+    if (c == NULL) return -1;
+    c->x = x0;
+    c->y = y0;
+    c->x0 = x0 - r;
+    c->y0 = y0 - r;
+    c->x1 = x0 + r;
+    c->y1 = y0 + r;
+    c->arg = r;
+    c->color = swap_bytes(color);
+    command_sign(c);
+    return c - commands;
+}
+
+/**
+ * @brief Adds a line or several of text, laid out as draw_text_scaled does.
+ *
+ * The text is copied, the font is not.
+ *
+ * @return The handle of the text, -1 if the list or the text pool is full.
+ */
+dl_handle_t dl_text(int16_t x, int16_t y, const char *text, uint16_t color, uint8_t scale, const uint8_t *font) {
+    size_t length = strlen(text);
+    if (text_used + length > DL_TEXT_POOL) {
+        if (!full_warned) ESP_LOGW(TAG, "display list text pool full, %d bytes", DL_TEXT_POOL);
+        full_warned = true;
+        return -1;
+    }
+    dl_command_t *c = command_new(DL_TEXT);
+    if (c == NULL) return -1;
+
+    uint16_t columns = 0, lines = 1, column = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\n') {
+            lines++;
+            column = 0;
+        } else if (++column > columns) {
+            columns = column;
+        }
+    }
+    memcpy(&text_pool[text_used], text, length);
+    c->arg = text_used;
+    c->length = length;
+    text_used += length;
+
+    c->x = c->x0 = x;
+    c->y = c->y0 = y;
+    c->x1 = x + columns * FONT_WIDTH * scale - 1;
+    c->y1 = y + lines * (FONT_HEIGHT + 2) * scale - 2 * scale - 1;
+    c->scale = scale;
+    c->color = swap_bytes(color);
+    c->data = font;
+    c->text_sig = fnv_add(FNV_OFFSET, text, length);
+    command_sign(c);
+    return c - commands;
+}
+
+static dl_handle_t add_sprite(dl_kind_t kind, const sprite_t *sprite, int16_t x, int16_t y, uint16_t key) {
+    dl_command_t *c = command_new(kind);
+    if (c == NULL) return -1;
+    c->x = c->x0 = x;
+    c->y = c->y0 = y;
+    c->x1 = x + sprite->width - 1;
+    c->y1 = y + sprite->height - 1;
+    c->color = key;
+    c->data = sprite;
+    command_sign(c);
+    return c - commands;
+}
+
+/**
+ * @brief Adds an opaque sprite. Its alpha plane is ignored.
+ *
+ * @return The handle of the sprite, -1 if the list is full.
+ */
+dl_handle_t dl_sprite(const sprite_t *sprite, int16_t x, int16_t y) {
+    return add_sprite(DL_SPRITE, sprite, x, y, 0);
+}
+
+/**
+ * @brief Adds a sprite whose pixels equal to key are transparent, as blit_keyed.
+ *
+ * @return The handle of the sprite, -1 if the list is full.
+ */
+dl_handle_t dl_sprite_keyed(const sprite_t *sprite, int16_t x, int16_t y, uint16_t key) {
+    return add_sprite(DL_SPRITE_KEYED, sprite, x, y, key);
+}
+
+/**
+ * @brief Moves a command by an offset.
+ */
+void dl_move(dl_handle_t handle, int16_t dx, int16_t dy) {
+    dl_command_t *c = command_get(handle);
+    if (c == NULL) return;
+    c->x += dx;
+    c->y += dy;
+    c->x0 += dx;
+    c->y0 += dy;
+    c->x1 += dx;
+    c->y1 += dy;
+    command_sign(c);
+}
+
+/**
+ * @brief Changes the color of a command. For keyed sprites this is the key.
+ */
+void dl_set_color(dl_handle_t handle, uint16_t color) {
+    dl_command_t *c = command_get(handle);
+    if (c == NULL) return;
+    c->color = (c->kind == DL_SPRITE || c->kind == DL_SPRITE_KEYED) ? color : swap_bytes(color);
+    command_sign(c);
+}
+
+/**
+ * @brief Shows or hides a command without removing it from the list.
+ */
+void dl_set_visible(dl_handle_t handle, bool visible) {
+    dl_command_t *c = command_get(handle);
+    if (c == NULL) return;
+    c->visible = visible;
+    command_sign(c);
+}
+
+/**
+ * @brief Makes the next flush draw and send every tile.
+ */
+void dl_invalidate(void) {
+    tiles_valid = false;
+}
+
+
+typedef struct {
+    int16_t x0, y0, x1, y1; //screen rectangle of the tile, inclusive
+    uint16_t width;
+    uint16_t *pixels;
+} tile_t;
+
+/**
+ * @brief Fills a span of one tile row, clipped to the tile.
+ */
+static inline void tile_span(const tile_t *t, int16_t x0, int16_t x1, int16_t y, uint16_t color) {
+    if (x0 < t->x0) x0 = t->x0;
+    if (x1 > t->x1) x1 = t->x1;
+    if (x0 > x1) return;
+    fill_pixels(&t->pixels[(y - t->y0) * t->width + (x0 - t->x0)], x1 - x0 + 1, color);
+}
+
+static void raster_rect(const tile_t *t, const dl_command_t *c, int16_t y0, int16_t y1) {
+    for (int16_t y = y0; y <= y1; y++) tile_span(t, c->x0, c->x1, y, c->color);
+}
+
+/**
+ * @brief Draws the rows of a circle inside the tile.
+ *
+ * The half-width of a row is the largest x with x^2 + dy^2 <= r^2 + r, the
+ * criterion of fill_circle, found with an integer square root.
+ */
+static void raster_circle(const tile_t *t, const dl_command_t *c, int16_t y0, int16_t y1) {
+    int32_t limit = (int32_t)c->arg * c->arg + c->arg;
+    for (int16_t y = y0; y <= y1; y++) {
+        int32_t dy = y - c->y;
+        int32_t rest = limit - dy * dy;
+        if (rest < 0) continue;
+        int16_t hw = fx_isqrt(rest);
+        tile_span(t, c->x - hw, c->x + hw, y, c->color);
+    }
+}
+
+/**
+ * @brief Draws the glyphs of a text that fall inside the tile.
+ */
+static void raster_text(const tile_t *t, const dl_command_t *c, int16_t y0, int16_t y1) {
+    const uint8_t *font = c->data;
+    const char *text = &text_pool[c->arg];
+    uint8_t scale = c->scale;
+    int16_t gx = c->x, gy = c->y;
+
+    for (uint16_t i = 0; i < c->length; i++) {
+        char ch = text[i];
+        if (ch == '\n') {
+            gx = c->x;
+            gy += (FONT_HEIGHT + 2) * scale;
+            continue;
+        }
+        int16_t gx1 = gx + FONT_WIDTH * scale - 1;
+        int16_t gy1 = gy + FONT_HEIGHT * scale - 1;
+        if (ch >= FONT_START && ch <= FONT_END && gx <= t->x1 && gx1 >= t->x0 && gy <= y1 && gy1 >= y0) {
+            const uint8_t *glyph = &font[(ch - FONT_START) * FONT_HEIGHT];
+            int16_t ya = (gy > y0) ? gy : y0;
+            int16_t yb = (gy1 < y1) ? gy1 : y1;
+            for (int16_t y = ya; y <= yb; y++) {
+                uint8_t line = glyph[(y - gy) / scale];
+                for (int col = 0; col < FONT_WIDTH; col++) {
+                    if (line & (1 << (7 - col))) {
+                        int16_t x = gx + col * scale;
+                        tile_span(t, x, x + scale - 1, y, c->color);
+                    }
+                }
+            }
+        }
+        gx += FONT_WIDTH * scale;
+    }
+}
+
+/**
+ * @brief Copies the part of a sprite inside the tile, swapping to panel byte order.
+ */
+static void raster_sprite(const tile_t *t, const dl_command_t *c, int16_t y0, int16_t y1) {
+    const sprite_t *s = c->data;
+    uint16_t stride = s->stride ? s->stride : s->width;
+    int16_t xa = (c->x0 > t->x0) ? c->x0 : t->x0;
+    int16_t xb = (c->x1 < t->x1) ? c->x1 : t->x1;
+    bool keyed = (c->kind == DL_SPRITE_KEYED);
+
+    for (int16_t y = y0; y <= y1; y++) {
+        const uint16_t *src = &s->pixels[(y - c->y0) * stride + (xa - c->x0)];
+        uint16_t *dst = &t->pixels[(y - t->y0) * t->width + (xa - t->x0)];
+        for (int16_t x = xa; x <= xb; x++, src++, dst++) {
+            if (!keyed || *src != c->color) *dst = swap_bytes(*src);
+        }
+    }
+}
+
+/**
+ * @brief Tells whether a command hides every pixel of the tile.
+ *
+ * A circle does when the four tile corners are inside it, since it is convex.
+ */
+static bool covers_tile(const dl_command_t *c, const tile_t *t) {
+    if (c->kind == DL_TEXT || c->kind == DL_SPRITE_KEYED) return false;
+    if (c->x0 > t->x0 || c->x1 < t->x1 || c->y0 > t->y0 || c->y1 < t->y1) return false;
+    if (c->kind != DL_CIRCLE) return true;
+
+    int32_t limit = (int32_t)c->arg * c->arg + c->arg;
+    int32_t dx = (c->x - t->x0 > t->x1 - c->x) ? c->x - t->x0 : t->x1 - c->x;
+    int32_t dy = (c->y - t->y0 > t->y1 - c->y) ? c->y - t->y0 : t->y1 - c->y;
+    return dx * dx + dy * dy <= limit;
+}
+
+static inline bool touches_tile(const dl_command_t *c, const tile_t *t) {
+    return c->visible && c->x0 <= t->x1 && c->x1 >= t->x0 && c->y0 <= t->y1 && c->y1 >= t->y0;
+}
+
+/**
+ * @brief Draws the commands touching a tile into its buffer.
+ *
+ * Commands under the topmost one that covers the whole tile are skipped,
+ * the background only when no command covers it.
+ */
+static void raster_tile(const tile_t *t) {
+    int16_t first = -1;
+    for (int16_t i = command_count - 1; i >= 0; i--) {
+        if (touches_tile(&commands[i], t) && covers_tile(&commands[i], t)) {
+            first = i;
+            break;
+        }
+    }
+    if (first < 0) {
+        fill_pixels(t->pixels, (uint32_t)t->width * (t->y1 - t->y0 + 1), background);
+        first = 0;
+    }
+    for (int16_t i = 0; i < first; i++) {
+        if (touches_tile(&commands[i], t)) stats.commands_culled++;
+    }
+
+    for (int16_t i = first; i < command_count; i++) {
+        const dl_command_t *c = &commands[i];
+        if (!touches_tile(c, t)) continue;
+        int16_t y0 = (c->y0 > t->y0) ? c->y0 : t->y0;
+        int16_t y1 = (c->y1 < t->y1) ? c->y1 : t->y1;
+        switch (c->kind) {
+            case DL_RECT: raster_rect(t, c, y0, y1); break;
+            case DL_CIRCLE: raster_circle(t, c, y0, y1); break;
+            case DL_TEXT: raster_text(t, c, y0, y1); break;
+            case DL_SPRITE:
+            case DL_SPRITE_KEYED: raster_sprite(t, c, y0, y1); break;
+        }
+        stats.commands_drawn++;
+    }
+}
+
+/**
+ * @brief Draws the list on the panel.
+ *
+ * Tiles are visited row by row. The signature of a tile hashes the
+ * background and the signatures of the commands touching it, in list order;
+ * when it matches the one the tile was last sent with the tile is skipped.
+ * Otherwise it is rasterized into one of the two tile buffers while the
+ * previous tile is still being sent, then queued after its window is set.
+ */
+void dl_flush(void) {
+    const st7789_transport_t *transport = st7789_get_transport();
+    uint8_t pending = 0;
+    uint8_t next = 0;
+
+    TRACE_FRAME_MARK();
+    memset(&stats, 0, sizeof(stats));
+    stats.commands = command_count;
+
+    for (uint16_t ty = 0; ty < DL_TILES_Y; ty++) {
+        for (uint16_t tx = 0; tx < DL_TILES_X; tx++) {
+            tile_t t;
+            t.x0 = tx * DL_TILE_WIDTH;
+            t.y0 = ty * DL_TILE_HEIGHT;
+            t.x1 = (t.x0 + DL_TILE_WIDTH < TFT_WIDTH) ? t.x0 + DL_TILE_WIDTH - 1 : TFT_WIDTH - 1;
+            t.y1 = (t.y0 + DL_TILE_HEIGHT < TFT_HEIGHT) ? t.y0 + DL_TILE_HEIGHT - 1 : TFT_HEIGHT - 1;
+            t.width = t.x1 - t.x0 + 1;
+
+            uint32_t sig = fnv_add(FNV_OFFSET, &background, sizeof(background));
+            for (uint16_t i = 0; i < command_count; i++) {
+                if (touches_tile(&commands[i], &t)) sig = fnv_add(sig, &commands[i].sig, sizeof(uint32_t));
+            }
+            uint32_t *tile_sig = &tile_sigs[ty * DL_TILES_X + tx];
+            if (tiles_valid && *tile_sig == sig) {
+                stats.tiles_skipped++;
+                continue;
+            }
+            *tile_sig = sig;
+
+            t.pixels = tile_buffers[next];
+            next ^= 1;
+            raster_tile(&t);
+
+            //the window commands cannot go out while the previous tile is on the bus
+            PERF_PUSH(PERF_STAGE_SPI);
+            while (pending) {
+                TRACE_BEGIN();
+                transport->wait();
+                TRACE_END(TRACE_WAIT, DATA_MODE, NULL, 0);
+                pending--;
+            }
+            PERF_POP();
+
+            set_window(t.x0, t.x1, t.y0, t.y1);
+            send_cmd(RAMWR);
+            transport->set_dc(DATA_MODE);
+
+            uint32_t bytes = (uint32_t)t.width * (t.y1 - t.y0 + 1) * 2;
+            PERF_PUSH(PERF_STAGE_SPI);
+            PERF_TRANSFER(bytes);
+            TRACE_BEGIN();
+            transport->queue(t.pixels, bytes);
+            TRACE_END(TRACE_QUEUE, DATA_MODE, t.pixels, bytes);
+            PERF_POP();
+            pending++;
+            stats.tiles_drawn++;
+            stats.bytes += bytes;
+        }
+    }
+
+    PERF_PUSH(PERF_STAGE_SPI);
+    while (pending) {
+        TRACE_BEGIN();
+        transport->wait();
+        TRACE_END(TRACE_WAIT, DATA_MODE, NULL, 0);
+        pending--;
+    }
+    PERF_POP();
+    tiles_valid = true;
+}
+
+/**
+ * @brief Copies the counters of the last flush.
+ */
+void dl_get_stats(dl_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,165 @@
+#include "st7789_fields.h"
+#include "st7789_fxmath.h"
+#include "st7789_indexed.h"
+
+#define FIELD_NORM_BITS 12 //fixed-point bits of the normalized tunnel coordinates
+
+
+/**
+ * @brief Fills a map with the distance of every pixel to a center point.
+ *
+ * @param map The field map to fill (FIELD_MAP_SIZE bytes).
+ * @param cx The x-coordinate of the center.
+ * @param cy The y-coordinate of the center.
+ * @param period Distance in pixels of one full phase cycle.
+ */
+void field_radius(uint8_t *map, int16_t cx, int16_t cy, uint16_t period) {
+    if (period == 0) period = 1;
+    for (int32_t y = 0; y < TFT_HEIGHT; y++) {
+        int32_t dy = y - cy;
+        for (int32_t x = 0; x < TFT_WIDTH; x++) {
+            int32_t dx = x - cx;
+            uint32_t dist = fx_isqrt((uint32_t)(dx * dx + dy * dy) << 12); //Q6 pixels
+            *map++ = (dist << 2) / period;
+        }
+    }
+}
+
+/**
+ * @brief Fills a map with the angle of every pixel around a center point.
+ *
+ * @param map The field map to fill (FIELD_MAP_SIZE bytes).
+ * @param cx The x-coordinate of the center.
+ * @param cy The y-coordinate of the center.
+ * @param repeats How many phase cycles fit in one turn.
+ */
+void field_angle(uint8_t *map, int16_t cx, int16_t cy, uint8_t repeats) {
+    for (int32_t y = 0; y < TFT_HEIGHT; y++) {
+        for (int32_t x = 0; x < TFT_WIDTH; x++) {
+            *map++ = ((uint32_t)fx_atan2(y - cy, x - cx) * repeats) >> 8;
+        }
+    }
+}
+
+/**
+ * @brief Fills a map with the depth of a tunnel centered on the screen.
+ *
+ * The phase is ln(1 + depth * r) with r the distance to the center in
+ * coordinates normalized to [-1, 1] on both axes, one cycle per unit.
+ *
+ * @param map The field map to fill (FIELD_MAP_SIZE bytes).
+ * @param depth How fast the tunnel recedes towards the edges.
+ */
+void field_tunnel(uint8_t *map, uint16_t depth) {
+    for (int32_t y = 0; y < TFT_HEIGHT; y++) {
+        int32_t ny = ((2 * y - TFT_HEIGHT) << FIELD_NORM_BITS) / TFT_HEIGHT;
+        for (int32_t x = 0; x < TFT_WIDTH; x++) {
+            int32_t nx = ((2 * x - TFT_WIDTH) << FIELD_NORM_BITS) / TFT_WIDTH;
+            uint32_t r = fx_isqrt(nx * nx + ny * ny);
+            fx16_t d = fx_ln(((r * depth) << (FX_SHIFT - FIELD_NORM_BITS)) + FX_ONE);
+            *map++ = d >> (FX_SHIFT - 8);
+        }
+    }
+}
+
+/**
+ * @brief Fills a map with a sum of spatial sine waves.
+ *
+ * The sum goes from -count to count and is shifted to start at 0 before it
+ * is scaled, so the phase is (sum + count) * gain / 256.
+ *
+ * @param map The field map to fill (FIELD_MAP_SIZE bytes).
+ * @param waves The waves to add up.
+ * @param count Number of waves.
+ * @param gain Phase units per unit of the sum, in Q8.
+ */
+void field_sines(uint8_t *map, const field_wave_t *waves, uint8_t count, uint16_t gain) {
+    for (int32_t y = 0; y < TFT_HEIGHT; y++) {
+        for (int32_t x = 0; x < TFT_WIDTH; x++) {
+            int32_t sum = count * FX_TRIG_ONE;
+            for (uint8_t w = 0; w < count; w++) {
+                sum += fx_sin((x * waves[w].step_x + y * waves[w].step_y) >> 8);
+            }
+            *map++ = ((int64_t)sum * gain) >> 23;
+        }
+    }
+}
+
+/**
+ * @brief Builds a color table that cycles through a list of colors once.
+ *
+ * @param lut The table to fill (FIELD_LUT_SIZE entries).
+ * @param colors The colors, RGB565 or palette indices in indexed mode.
+ * @param count Number of colors.
+ */
+void field_lut_cycle(uint16_t *lut, const uint16_t *colors, uint8_t count) {
+    for (uint16_t p = 0; p < FIELD_LUT_SIZE; p++) {
+        lut[p] = colors[(p * count) >> 8];
+    }
+}
+
+/**
+ * @brief Renders a range of rows of a field map into the frame buffer.
+ *
+ * Every pixel becomes lut[(phase + offset) & 255], so animating the field
+ * only costs a load, an add and a table lookup per pixel. Different row
+ * ranges can be rendered from different tasks at the same time; at 4 bpp
+ * the ranges must start on even rows, since odd rows do not start on a byte.
+ *
+ * @param map The field map.
+ * @param offset Phase added to every pixel, usually derived from time.
+ * @param lut The color table (FIELD_LUT_SIZE entries), RGB565 colors or
+ *            palette indices in indexed mode.
+ * @param first The first row to render.
+ * @param last The last row to render (inclusive).
+ */
+void field_render_rows(const uint8_t *map, uint8_t offset, const uint16_t *lut, int16_t first, int16_t last) {
+    if (first < 0) first = 0;
+    if (last >= TFT_HEIGHT) last = TFT_HEIGHT - 1;
+    if (first > last) return;
+
+    uint32_t i = (uint32_t)first * TFT_WIDTH;
+    uint32_t end = (uint32_t)(last + 1) * TFT_WIDTH;
+#if FRAME_BUFFER_BPP == 16
+    uint16_t *dst = get_frame_buffer();
+    for (; i + 4 <= end; i += 4) {
+        dst[i] = lut[(uint8_t)(map[i] + offset)];
+        dst[i + 1] = lut[(uint8_t)(map[i + 1] + offset)];
+        dst[i + 2] = lut[(uint8_t)(map[i + 2] + offset)];
+        dst[i + 3] = lut[(uint8_t)(map[i + 3] + offset)];
+    }
+    for (; i < end; i++) {
+        dst[i] = lut[(uint8_t)(map[i] + offset)];
+    }
+#elif FRAME_BUFFER_BPP == 8
+    uint8_t *dst = get_index_buffer();
+    for (; i < end; i++) {
+        dst[i] = lut[(uint8_t)(map[i] + offset)];
+    }
+#else
+    uint8_t *dst = get_index_buffer();
+    if (i & 1) {
+        dst[i >> 1] = (dst[i >> 1] & 0xF0) | (lut[(uint8_t)(map[i] + offset)] & 0x0F);
+        i++;
+    }
+    for (; i + 2 <= end; i += 2) {
+        dst[i >> 1] = (lut[(uint8_t)(map[i] + offset)] << 4) | (lut[(uint8_t)(map[i + 1] + offset)] & 0x0F);
+    }
+    if (i < end) {
+        dst[i >> 1] = (dst[i >> 1] & 0x0F) | (lut[(uint8_t)(map[i] + offset)] << 4);
+    }
+#endif
+}
+
+/**
+ * @brief Renders a whole field map into the frame buffer.
+ *
+ * The whole frame is written and does not need to be cleared first.
+ *
+ * @param map The field map.
+ * @param offset Phase added to every pixel.
+ * @param lut The color table (FIELD_LUT_SIZE entries).
+ */
+void field_render(const uint8_t *map, uint8_t offset, const uint16_t *lut) {
+    field_render_rows(map, offset, lut, 0, TFT_HEIGHT - 1);
+}
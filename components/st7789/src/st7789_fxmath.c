@@ -0,0 +1,149 @@
+#include "st7789_fxmath.h"
+#include <stdbool.h>
+
+//generated at build time by tools/gen_fxmath_tables.py
+extern const int16_t fx_sin_table[(1 << FX_SIN_BITS) + 1];
+extern const uint16_t fx_atan_table[(1 << FX_ATAN_BITS) + 1];
+extern const uint16_t fx_sqrt_table[193];
+extern const uint32_t fx_log2_table[(1 << FX_LOG_BITS) + 1];
+
+#define SIN_FRAC_BITS (16 - FX_SIN_BITS)
+
+
+/**
+ * @brief Fixed-point sine.
+ *
+ * Looks up the two nearest entries of a 1024-entry table and interpolates
+ * between them with the low angle bits.
+ *
+ * @param angle The angle in binary units (65536 per turn).
+ * @return The sine in Q1.15.
+ */
+int16_t fx_sin(uint16_t angle) {
+    uint16_t idx = angle >> SIN_FRAC_BITS;
+    int32_t frac = angle & ((1 << SIN_FRAC_BITS) - 1);
+    int32_t a = fx_sin_table[idx];
+    int32_t b = fx_sin_table[idx + 1];
+    return a + (((b - a) * frac) >> SIN_FRAC_BITS);
+}
+
+/**
+ * @brief Fixed-point cosine.
+ *
+ * @param angle The angle in binary units (65536 per turn).
+ * @return The cosine in Q1.15.
+ */
+int16_t fx_cos(uint16_t angle) {
+    return fx_sin(angle + FX_ANGLE_TURN / 4);
+}
+
+/**
+ * @brief Fixed-point atan2.
+ *
+ * The point is folded into the first octant, where the ratio of the smaller
+ * to the larger coordinate indexes an arctangent table, and the result is
+ * unfolded back. Same argument order and sign convention as atan2().
+ *
+ * @param y The y-coordinate.
+ * @param x The x-coordinate.
+ * @return The angle of (x, y) in binary units (65536 per turn).
+ */
+uint16_t fx_atan2(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) return 0;
+
+    uint32_t ax = (x < 0) ? -(uint32_t)x : (uint32_t)x;
+    uint32_t ay = (y < 0) ? -(uint32_t)y : (uint32_t)y;
+    bool swap = ay > ax;
+    uint32_t num = swap ? ax : ay;
+    uint32_t den = swap ? ay : ax;
+
+    while (den > 0x7FFF) {
+        num >>= 1;
+        den >>= 1;
+    }
+
+    uint32_t ratio = (num << 16) / den; //Q16, 0 to 1
+    uint32_t idx = ratio >> (16 - FX_ATAN_BITS);
+    uint32_t frac = ratio & ((1 << (16 - FX_ATAN_BITS)) - 1);
+    uint32_t angle = fx_atan_table[idx];
+    if (frac) {
+        angle += ((fx_atan_table[idx + 1] - angle) * frac) >> (16 - FX_ATAN_BITS);
+    }
+
+    if (swap) angle = FX_ANGLE_TURN / 4 - angle;
+    if (x < 0) angle = FX_ANGLE_TURN / 2 - angle;
+    if (y < 0) angle = FX_ANGLE_TURN - angle;
+    return (uint16_t)angle;
+}
+
+/**
+ * @brief Integer square root.
+ *
+ * The input is normalized by an even shift so its top byte indexes a square
+ * root table, the estimate is refined with one Newton step and corrected to
+ * the exact floor.
+ *
+ * @param x The value.
+ * @return floor(sqrt(x)).
+ */
+uint32_t fx_isqrt(uint32_t x) {
+    if (x == 0) return 0;
+
+    uint32_t shift = __builtin_clz(x) & ~1u;
+    uint32_t n = x << shift;
+    uint32_t r = fx_sqrt_table[(n >> 24) - 64] >> (shift / 2);
+    if (r == 0) r = 1;
+
+    r = (r + x / r) >> 1;
+    while ((uint64_t)r * r > x) r--;
+    while ((uint64_t)(r + 1) * (r + 1) <= x) r++;
+    return r;
+}
+
+/**
+ * @brief Fixed-point square root.
+ *
+ * @param x The value in Q16.16.
+ * @return The square root in Q16.16, 0 for negative input.
+ */
+fx16_t fx_sqrt(fx16_t x) {
+    if (x <= 0) return 0;
+    if (x < FX_ONE) return fx_isqrt((uint32_t)x << FX_SHIFT);
+
+    uint32_t r = fx_isqrt(x) << (FX_SHIFT / 2);
+    return (fx16_t)((r + (((uint64_t)x << FX_SHIFT) / r)) >> 1);
+}
+
+/**
+ * @brief Fixed-point base 2 logarithm.
+ *
+ * The integer part comes from the position of the highest set bit and the
+ * fractional part from a table of log2 over the mantissa in [1, 2).
+ *
+ * @param x The value in Q16.16, must be positive.
+ * @return log2(x) in Q16.16, INT32_MIN for non-positive input.
+ */
+fx16_t fx_log2(fx16_t x) {
+    if (x <= 0) return INT32_MIN;
+
+    int32_t msb = 31 - __builtin_clz(x);
+    uint32_t m = (msb >= 24) ? ((uint32_t)x >> (msb - 24)) : ((uint32_t)x << (24 - msb));
+    uint32_t frac = m & 0xFFFFFF; //mantissa bits below the leading one
+    uint32_t idx = frac >> (24 - FX_LOG_BITS);
+    uint32_t lo = frac & ((1 << (24 - FX_LOG_BITS)) - 1);
+    uint32_t a = fx_log2_table[idx];
+    uint32_t b = fx_log2_table[idx + 1];
+
+    return (msb - FX_SHIFT) * FX_ONE + a + (((b - a) * lo) >> (24 - FX_LOG_BITS));
+}
+
+/**
+ * @brief Fixed-point natural logarithm.
+ *
+ * @param x The value in Q16.16, must be positive.
+ * @return ln(x) in Q16.16.
+ */
+fx16_t fx_ln(fx16_t x) {
+    if (x <= 0) return INT32_MIN;
+    return FX_MUL(fx_log2(x), FX_LN2);
+}
@@ -0,0 +1,293 @@
+#include "st7789_indexed.h"
+#include "st7789_perf.h"
+#include "st7789_trace.h"
+#include "st7789_record.h"
+
+#if FRAME_BUFFER_BPP == 8 || FRAME_BUFFER_BPP == 4
+
+#define INDEX_MASK (PALETTE_SIZE - 1)
+#define FLUSH_CHUNK 512 //pixels expanded per SPI transfer
+
+static uint8_t index_buffer[INDEX_BUFFER_SIZE];
+static uint16_t palette[PALETTE_SIZE];
+static uint16_t palette_swapped[PALETTE_SIZE]; //palette in panel byte order
+static DMA_ATTR uint16_t flush_buffer[FLUSH_CHUNK];
+#if FRAME_BUFFER_BPP == 4
+static uint32_t pair_lut[256]; //one index byte to two swapped pixels
+#endif
+
+
+/**
+ * @brief Rebuilds the panel byte order lookup tables from the palette.
+ *
+ * Called after every palette change. At 4 bpp it also rebuilds the table
+ * that turns one index byte straight into two output pixels.
+ */
+static void palette_update_lut(void) {
+    for (uint16_t i = 0; i < PALETTE_SIZE; i++) {
+        palette_swapped[i] = (palette[i] >> 8) | (palette[i] << 8);
+    }
+#if FRAME_BUFFER_BPP == 4
+    for (uint16_t b = 0; b < 256; b++) {
+        pair_lut[b] = palette_swapped[b >> 4] | ((uint32_t)palette_swapped[b & 0x0F] << 16);
+    }
+#endif
+}
+
+/**
+ * @brief Returns the index buffer that all drawing functions write to.
+ *
+ * At 8 bpp there is one byte per pixel. At 4 bpp two consecutive pixels
+ * share a byte, the first one in the high nibble.
+ *
+ * @return Pointer to the first byte of the index buffer.
+ */
+uint8_t *get_index_buffer(void) {
+    return index_buffer;
+}
+
+/**
+ * @brief Sets a range of palette entries.
+ *
+ * @param first The first palette index to set.
+ * @param colors The RGB565 colors to store.
+ * @param count Number of entries to set.
+ */
+void palette_set(uint16_t first, const uint16_t *colors, uint16_t count) {
+    for (uint16_t i = 0; i < count && first + i < PALETTE_SIZE; i++) {
+        palette[first + i] = colors[i];
+    }
+    palette_update_lut();
+}
+
+/**
+ * @brief Returns the RGB565 color of a palette entry.
+ *
+ * @param index The palette index.
+ * @return The color stored at that index.
+ */
+uint16_t palette_get(uint8_t index) {
+    return palette[index & INDEX_MASK];
+}
+
+/**
+ * @brief Rotates a range of palette entries.
+ *
+ * The color at index i moves to first + ((i - first + step) mod count). Since
+ * the frame only stores indices, flushing after a rotation animates every
+ * pixel that uses the range without redrawing anything (color cycling).
+ *
+ * @param first The first palette index of the range.
+ * @param count Number of entries in the range.
+ * @param step How many positions to rotate by, negative to rotate backwards.
+ */
+void palette_rotate(uint8_t first, uint16_t count, int16_t step) {
+    uint16_t tmp[PALETTE_SIZE];
+
+    if (first + count > PALETTE_SIZE) count = PALETTE_SIZE - first;
+    if (count < 2) return;
+
+    int32_t shift = ((step % (int32_t)count) + count) % count;
+    if (shift == 0) return;
+
+    for (uint16_t i = 0; i < count; i++) {
+        tmp[(i + shift) % count] = palette[first + i];
+    }
+    memcpy(&palette[first], tmp, count * sizeof(uint16_t));
+    palette_update_lut();
+}
+
+/**
+ * @brief Fills a run of pixels with one palette index.
+ *
+ * @param start Linear position (y * TFT_WIDTH + x) of the first pixel.
+ * @param count Number of pixels.
+ * @param index The palette index to store.
+ */
+static void index_fill(uint32_t start, uint32_t count, uint8_t index) {
+    index &= INDEX_MASK;
+#if FRAME_BUFFER_BPP == 8
+    memset(&index_buffer[start], index, count);
+#else
+    uint8_t *dst = &index_buffer[start >> 1];
+    if (count && (start & 1)) {
+        *dst = (*dst & 0xF0) | index;
+        dst++;
+        count--;
+    }
+    memset(dst, (index << 4) | index, count >> 1);
+    if (count & 1) {
+        dst += count >> 1;
+        *dst = (*dst & 0x0F) | (index << 4);
+    }
+#endif
+}
+
+/**
+ * @brief Clears the frame buffer by filling it with the specified palette index.
+ *
+ * @param color The palette index to fill the frame buffer with.
+ */
+void clear_frame_buffer(uint16_t color) {
+    RECORD_CALL(RECORD_OP_CLEAR, color);
+    index_fill(0, TFT_WIDTH * TFT_HEIGHT, color);
+}
+
+/**
+ * @brief Draw a single pixel into the index buffer.
+ *
+ * @param x The x-coordinate of the pixel.
+ * @param y The y-coordinate of the pixel.
+ * @param color The palette index of the pixel.
+ */
+void draw_pixel(uint16_t x, uint16_t y, uint16_t color) {
+    RECORD_CALL(RECORD_OP_PIXEL, x, y, color);
+    if (x >= TFT_WIDTH || y >= TFT_HEIGHT) return;
+    uint32_t i = y * TFT_WIDTH + x;
+#if FRAME_BUFFER_BPP == 8
+    index_buffer[i] = color & INDEX_MASK;
+#else
+    uint8_t *dst = &index_buffer[i >> 1];
+    if (i & 1) {
+        *dst = (*dst & 0xF0) | (color & INDEX_MASK);
+    } else {
+        *dst = (*dst & 0x0F) | ((color & INDEX_MASK) << 4);
+    }
+#endif
+}
+
+/**
+ * @brief Fills a horizontal span of pixels with one palette index.
+ *
+ * @param x0 The x-coordinate of the first pixel of the span.
+ * @param x1 The x-coordinate of the last pixel of the span (inclusive).
+ * @param y The row of the span.
+ * @param color The palette index to fill the span with.
+ */
+void draw_hline(int16_t x0, int16_t x1, int16_t y, uint16_t color) {
+    RECORD_CALL(RECORD_OP_HLINE, x0, x1, y, color);
+    if (y < 0 || y >= TFT_HEIGHT) return;
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (x1 < 0 || x0 >= TFT_WIDTH) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= TFT_WIDTH) x1 = TFT_WIDTH - 1;
+
+    index_fill(y * TFT_WIDTH + x0, x1 - x0 + 1, color);
+}
+
+/**
+ * @brief Draws a filled rectangle into the index buffer.
+ *
+ * @param x1 The x-coordinate of the top-left corner of the rectangle.
+ * @param y1 The y-coordinate of the top-left corner of the rectangle.
+ * @param x2 The x-coordinate of the bottom-right corner of the rectangle.
+ * @param y2 The y-coordinate of the bottom-right corner of the rectangle.
+ * @param color The palette index to fill the rectangle with.
+ */
+void draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+    RECORD_CALL(RECORD_OP_RECT, x1, y1, x2, y2, color);
+    x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
+    x2 = (x2 < TFT_WIDTH) ? x2 : TFT_WIDTH - 1;
+    y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
+    y2 = (y2 < TFT_HEIGHT) ? y2 : TFT_HEIGHT - 1;
+
+    if (x1 > x2) { uint16_t t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { uint16_t t = y1; y1 = y2; y2 = t; }
+
+    uint16_t width = x2 - x1 + 1;
+    if (width == TFT_WIDTH) {
+        index_fill(y1 * TFT_WIDTH, (uint32_t)width * (y2 - y1 + 1), color);
+        return;
+    }
+    for (uint16_t y = y1; y <= y2; y++) {
+        index_fill(y * TFT_WIDTH + x1, width, color);
+    }
+}
+
+/**
+ * @brief Flushes the index buffer to the display through the palette.
+ *
+ * The palette lookup replaces the byte swap of the RGB565 flush: every chunk
+ * is expanded straight into panel byte order and sent. At 4 bpp each index
+ * byte expands to two pixels with a single table lookup.
+ */
+void flush_frame_buffer() {
+    RECORD_FLUSH();
+    RECORD_SUSPEND();
+    PERF_FLUSH_BEGIN();
+    TRACE_FRAME_MARK();
+    set_window(0, TFT_WIDTH - 1, 0, TFT_HEIGHT - 1);
+    send_cmd(RAMWR);
+
+    const uint8_t *src = index_buffer;
+    uint32_t remaining = TFT_WIDTH * TFT_HEIGHT;
+
+    while (remaining) {
+        uint32_t pixels = (remaining > FLUSH_CHUNK) ? FLUSH_CHUNK : remaining;
+        PERF_ENTER(PERF_STAGE_CONVERT);
+#if FRAME_BUFFER_BPP == 8
+        for (uint32_t i = 0; i < pixels; i++) {
+            flush_buffer[i] = palette_swapped[src[i]];
+        }
+        src += pixels;
+#else
+        pixel_pair_t *dst = (pixel_pair_t *)flush_buffer;
+        for (uint32_t i = 0; i < pixels / 2; i++) {
+            dst[i] = pair_lut[src[i]];
+        }
+        src += pixels / 2;
+#endif
+        PERF_ENTER(PERF_STAGE_SPI);
+        send_data((const uint8_t *)flush_buffer, pixels * 2);
+        remaining -= pixels;
+    }
+    PERF_FLUSH_END();
+    RECORD_RESUME();
+}
+
+/**
+ * @brief Flushes one rectangle of the index buffer through the palette.
+ *
+ * Same as the RGB565 version: only the window of the rectangle is sent, as
+ * many whole rows per chunk as fit in the flush buffer. A row can start on
+ * the odd pixel of a byte at 4 bpp, so pixels are looked up one at a time.
+ */
+void flush_frame_buffer_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    RECORD_CALL(RECORD_OP_FLUSH_RECT, x0, y0, x1, y1);
+    x0 = (x0 < TFT_WIDTH) ? x0 : TFT_WIDTH - 1;
+    x1 = (x1 < TFT_WIDTH) ? x1 : TFT_WIDTH - 1;
+    y0 = (y0 < TFT_HEIGHT) ? y0 : TFT_HEIGHT - 1;
+    y1 = (y1 < TFT_HEIGHT) ? y1 : TFT_HEIGHT - 1;
+    if (x0 > x1) { uint16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { uint16_t t = y0; y0 = y1; y1 = t; }
+
+    TRACE_FRAME_MARK();
+    set_window(x0, x1, y0, y1);
+    send_cmd(RAMWR);
+
+    uint16_t width = x1 - x0 + 1;
+    uint16_t rows_per_chunk = FLUSH_CHUNK / width;
+    uint16_t y = y0;
+
+    PERF_PUSH(PERF_STAGE_CONVERT);
+    while (y <= y1) {
+        uint32_t n = 0;
+        PERF_ENTER(PERF_STAGE_CONVERT);
+        for (uint16_t r = 0; r < rows_per_chunk && y <= y1; r++, y++) {
+            uint32_t i = y * TFT_WIDTH + x0;
+            for (uint16_t c = 0; c < width; c++, i++) {
+#if FRAME_BUFFER_BPP == 8
+                flush_buffer[n++] = palette_swapped[index_buffer[i]];
+#else
+                uint8_t b = index_buffer[i >> 1];
+                flush_buffer[n++] = palette_swapped[(i & 1) ? b & 0x0F : b >> 4];
+#endif
+            }
+        }
+        PERF_ENTER(PERF_STAGE_SPI);
+        send_data((const uint8_t *)flush_buffer, n * 2);
+    }
+    PERF_POP();
+}
+
+#endif
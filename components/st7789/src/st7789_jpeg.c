@@ -0,0 +1,771 @@
+#include "st7789_jpeg.h"
+#include "st7789_perf.h"
+#include "st7789_trace.h"
+#include "st7789_record.h"
+#include "st7789_transport.h"
+#include "esp_timer.h"
+
+static const char *TAG = "jpeg";
+
+#define M_SOF0 0xC0
+#define M_SOF1 0xC1
+#define M_DHT 0xC4
+#define M_JPG 0xC8
+#define M_DAC 0xCC
+#define M_RST0 0xD0
+#define M_RST7 0xD7
+#define M_SOI 0xD8
+#define M_EOI 0xD9
+#define M_SOS 0xDA
+#define M_DQT 0xDB
+#define M_DRI 0xDD
+
+//Integer inverse DCT (Loeffler, Ligtenberg and Moschytz), 13-bit constants
+#define CONST_BITS 13
+#define PASS1_BITS 2
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+#define DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+//YCbCr to RGB, 16-bit constants
+#define FIX_1_40200 91881
+#define FIX_1_77200 116130
+#define FIX_0_34414 22554
+#define FIX_0_71414 46802
+
+//Natural position of the k-th coefficient in zigzag order
+static const uint8_t natural_order[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+typedef struct {
+    uint8_t lookup_length[256]; //length of the code starting with these 8 bits, 0 when longer
+    uint8_t lookup_value[256];
+    int32_t max_code[17]; //largest code of each length, -1 when there is none
+    int32_t value_offset[17]; //index in values of a code of each length, minus the code
+    uint8_t values[256];
+} huffman_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t h, v; //sampling factors
+    uint8_t h_shift, v_shift; //1 when the component is subsampled in that direction
+    uint8_t quant;
+    uint8_t dc_table, ac_table;
+    int32_t dc; //last DC value, the next one is coded as a difference
+    uint16_t stride; //samples per plane row
+    uint8_t *plane; //the component's samples of the current MCU row, v x 8 rows
+} component_t;
+
+typedef struct {
+    FILE *file;
+    uint8_t input[JPEG_INPUT_BUFFER];
+    uint16_t input_pos, input_len;
+    uint32_t bits; //bit buffer, the next bit_count bits are the low ones
+    uint8_t bit_count;
+    bool marker; //the scan data has reached a marker, zeros are fed from here
+    int marker_code;
+    bool corrupt;
+    uint16_t quant[4][64]; //natural order
+    huffman_t huffman[2][4]; //DC, AC
+    bool huffman_defined[2][4];
+    component_t components[3];
+    uint8_t component_count;
+    uint16_t width, height;
+    uint8_t h_max, v_max;
+    uint16_t mcus_x, mcus_y;
+    uint16_t restart_interval;
+    uint16_t restarts_left; //MCUs until the next restart marker
+} decoder_t;
+
+static DMA_ATTR uint16_t strip_buffers[2][JPEG_MAX_STRIP_ROWS * TFT_HEIGHT];
+static jpeg_stats_t stats;
+
+
+static int read_byte(decoder_t *d) {
+    if (d->input_pos == d->input_len) {
+        d->input_len = fread(d->input, 1, JPEG_INPUT_BUFFER, d->file);
+        d->input_pos = 0;
+        stats.bytes_read += d->input_len;
+        if (d->input_len == 0) return -1;
+    }
+    return d->input[d->input_pos++];
+}
+
+static int read_u16(decoder_t *d) {
+    int hi = read_byte(d);
+    int lo = read_byte(d);
+    return (hi < 0 || lo < 0) ? -1 : (hi << 8) | lo;
+}
+
+static bool skip_bytes(decoder_t *d, int32_t count) {
+    while (count-- > 0) {
+        if (read_byte(d) < 0) return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Builds the decoding tables of a canonical Huffman code.
+ *
+ * Codes of up to 8 bits are resolved with one lookup of the next 8 bits,
+ * longer ones by comparing against the largest code of every length.
+ *
+ * @param counts Number of codes of every length from 1 to 16.
+ * @return false if there are more codes of a length than it can hold.
+ */
+static bool huffman_build(huffman_t *t, const uint8_t counts[16]) {
+    int32_t code = 0;
+    uint16_t k = 0;
+
+    memset(t->lookup_length, 0, sizeof(t->lookup_length));
+    for (uint8_t length = 1; length <= 16; length++) {
+        t->value_offset[length] = k - code;
+        if (code + counts[length - 1] > (1 << length)) return false;
+        for (uint8_t i = 0; i < counts[length - 1]; i++, k++, code++) {
+            if (length <= 8) {
+                uint8_t shift = 8 - length;
+                for (uint16_t j = 0; j < (1u << shift); j++) {
+                    t->lookup_length[(code << shift) | j] = length;
+                    t->lookup_value[(code << shift) | j] = t->values[k];
+                }
+            }
+        }
+        t->max_code[length] = counts[length - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    return true;
+}
+
+static bool read_quant_tables(decoder_t *d) {
+    int32_t length = read_u16(d) - 2;
+    while (length > 0) {
+        int info = read_byte(d);
+        if (info < 0 || (info & 0x0F) > 3) return false;
+        bool wide = info >> 4; //16-bit entries
+        uint16_t *q = d->quant[info & 0x0F];
+        for (uint8_t k = 0; k < 64; k++) {
+            int v = wide ? read_u16(d) : read_byte(d);
+            if (v < 0) return false;
+            q[natural_order[k]] = v;
+        }
+        length -= 1 + (wide ? 128 : 64);
+    }
+    return length == 0;
+}
+
+static bool read_huffman_tables(decoder_t *d) {
+    int32_t length = read_u16(d) - 2;
+    while (length > 0) {
+        int info = read_byte(d);
+        if (info < 0 || (info >> 4) > 1 || (info & 0x0F) > 3) return false;
+        uint8_t counts[16];
+        uint16_t total = 0;
+        for (uint8_t i = 0; i < 16; i++) {
+            int c = read_byte(d);
+            if (c < 0) return false;
+            counts[i] = c;
+            total += c;
+        }
+        if (total > 256) return false;
+        huffman_t *t = &d->huffman[info >> 4][info & 0x0F];
+        for (uint16_t i = 0; i < total; i++) {
+            int v = read_byte(d);
+            if (v < 0) return false;
+            t->values[i] = v;
+        }
+        if (!huffman_build(t, counts)) return false;
+        d->huffman_defined[info >> 4][info & 0x0F] = true;
+        length -= 17 + total;
+    }
+    return length == 0;
+}
+
+static bool read_frame_header(decoder_t *d) {
+    int length = read_u16(d);
+    int precision = read_byte(d);
+    int height = read_u16(d);
+    int width = read_u16(d);
+    int count = read_byte(d);
+    if (precision != 8 || height <= 0 || width <= 0 || (count != 1 && count != 3) || length != 8 + 3 * count) {
+        ESP_LOGE(TAG, "unsupported frame: %d-bit samples, %d components", precision, count);
+        return false;
+    }
+    d->width = width;
+    d->height = height;
+    d->component_count = count;
+    d->h_max = d->v_max = 1;
+    for (uint8_t i = 0; i < count; i++) {
+        component_t *c = &d->components[i];
+        int id = read_byte(d);
+        int sampling = read_byte(d);
+        int quant = read_byte(d);
+        if (id < 0 || sampling < 0 || quant < 0 || (quant & 0x0F) > 3) return false;
+        c->id = id;
+        c->h = sampling >> 4;
+        c->v = sampling & 0x0F;
+        c->quant = quant & 0x0F;
+        if (c->h < 1 || c->h > 2 || c->v < 1 || c->v > 2) {
+            ESP_LOGE(TAG, "unsupported sampling factors %ux%u", c->h, c->v);
+            return false;
+        }
+        if (c->h > d->h_max) d->h_max = c->h;
+        if (c->v > d->v_max) d->v_max = c->v;
+    }
+    //a single component scan is not interleaved: its MCU is one block whatever the factors
+    if (count == 1) {
+        d->components[0].h = d->components[0].v = 1;
+        d->h_max = d->v_max = 1;
+    }
+
+    d->mcus_x = (width + 8 * d->h_max - 1) / (8 * d->h_max);
+    d->mcus_y = (height + 8 * d->v_max - 1) / (8 * d->v_max);
+    for (uint8_t i = 0; i < count; i++) {
+        component_t *c = &d->components[i];
+        c->h_shift = d->h_max / c->h - 1;
+        c->v_shift = d->v_max / c->v - 1;
+        c->stride = d->mcus_x * c->h * 8;
+    }
+    return true;
+}
+
+static bool read_scan_header(decoder_t *d) {
+    int length = read_u16(d);
+    int count = read_byte(d);
+    if (count != d->component_count || length != 6 + 2 * count) {
+        ESP_LOGE(TAG, "only single-scan images are supported");
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        component_t *c = &d->components[i];
+        int id = read_byte(d);
+        int tables = read_byte(d);
+        if (id != c->id || tables < 0 || (tables >> 4) > 3 || (tables & 0x0F) > 3) return false;
+        c->dc_table = tables >> 4;
+        c->ac_table = tables & 0x0F;
+        if (!d->huffman_defined[0][c->dc_table] || !d->huffman_defined[1][c->ac_table]) {
+            ESP_LOGE(TAG, "scan uses an undefined Huffman table");
+            return false;
+        }
+    }
+    return skip_bytes(d, 3); //spectral selection and successive approximation, fixed for sequential
+}
+
+/**
+ * @brief Reads the segments up to the start of the scan.
+ */
+static bool read_headers(decoder_t *d) {
+    if (read_byte(d) != 0xFF || read_byte(d) != M_SOI) {
+        ESP_LOGE(TAG, "not a JPEG file");
+        return false;
+    }
+    bool frame = false;
+    for (;;) {
+        if (read_byte(d) != 0xFF) return false;
+        int marker;
+        do {
+            marker = read_byte(d);
+        } while (marker == 0xFF);
+
+        switch (marker) {
+            case M_SOF0:
+            case M_SOF1:
+                if (!read_frame_header(d)) return false;
+                frame = true;
+                break;
+            case M_DHT:
+                if (!read_huffman_tables(d)) return false;
+                break;
+            case M_DQT:
+                if (!read_quant_tables(d)) return false;
+                break;
+            case M_DRI:
+                if (read_u16(d) != 4) return false;
+                d->restart_interval = read_u16(d);
+                break;
+            case M_SOS:
+                return frame && read_scan_header(d);
+            case M_EOI:
+            case -1:
+                return false;
+            default:
+                if ((marker & 0xF0) == 0xC0 && marker != M_JPG && marker != M_DAC) {
+                    ESP_LOGE(TAG, "progressive, lossless and arithmetic-coded JPEG are not supported");
+                    return false;
+                }
+                //APPn, COM and the other segments are skipped
+                int length = read_u16(d);
+                if (length < 2 || !skip_bytes(d, length - 2)) return false;
+                break;
+        }
+    }
+}
+
+
+/**
+ * @brief Tops up the bit buffer to at least 25 bits.
+ *
+ * Stuffed 0xFF 0x00 pairs stand for 0xFF. At a marker or at the end of the
+ * file the scan data is over and zeros are fed instead.
+ */
+static void fill_bits(decoder_t *d) {
+    while (d->bit_count <= 24) {
+        int b = 0;
+        if (!d->marker) {
+            b = read_byte(d);
+            if (b == 0xFF) {
+                int next;
+                do {
+                    next = read_byte(d);
+                } while (next == 0xFF);
+                if (next != 0) {
+                    d->marker = true;
+                    d->marker_code = next;
+                    b = 0;
+                }
+            } else if (b < 0) {
+                d->marker = true;
+                d->marker_code = -1;
+                b = 0;
+            }
+        }
+        d->bits = (d->bits << 8) | b;
+        d->bit_count += 8;
+    }
+}
+
+static inline int32_t get_bits(decoder_t *d, uint8_t n) {
+    if (n == 0) return 0;
+    fill_bits(d);
+    d->bit_count -= n;
+    return (d->bits >> d->bit_count) & ((1u << n) - 1);
+}
+
+/**
+ * @brief Reads an n-bit coefficient: values below half the range are negative.
+ */
+static inline int32_t receive(decoder_t *d, uint8_t n) {
+    if (n > 16) {
+        d->corrupt = true;
+        return 0;
+    }
+    int32_t v = get_bits(d, n);
+    return (n && v < (1 << (n - 1))) ? v - (1 << n) + 1 : v;
+}
+
+static int decode_huffman(decoder_t *d, const huffman_t *t) {
+    fill_bits(d);
+    uint8_t peek = (d->bits >> (d->bit_count - 8)) & 0xFF;
+    uint8_t length = t->lookup_length[peek];
+    if (length) {
+        d->bit_count -= length;
+        return t->lookup_value[peek];
+    }
+    for (length = 9; length <= 16; length++) {
+        int32_t code = (d->bits >> (d->bit_count - length)) & ((1u << length) - 1);
+        if (code <= t->max_code[length]) {
+            d->bit_count -= length;
+            return t->values[code + t->value_offset[length]];
+        }
+    }
+    d->corrupt = true;
+    return 0;
+}
+
+/**
+ * @brief Skips to the restart marker that follows an interval and resets
+ * the DC predictions.
+ */
+static void restart(decoder_t *d) {
+    d->bit_count = 0;
+    while (!d->marker) {
+        int b = read_byte(d);
+        if (b < 0) break;
+        if (b != 0xFF) continue;
+        do {
+            b = read_byte(d);
+        } while (b == 0xFF);
+        if (b != 0) {
+            d->marker = true;
+            d->marker_code = b;
+        }
+    }
+    if (d->marker_code < M_RST0 || d->marker_code > M_RST7) {
+        d->corrupt = true;
+        return;
+    }
+    d->marker = false;
+    for (uint8_t i = 0; i < d->component_count; i++) d->components[i].dc = 0;
+}
+
+/**
+ * @brief Decodes the coefficients of one block, dequantized, in natural order.
+ */
+static void decode_block(decoder_t *d, component_t *c, int32_t *coef) {
+    const uint16_t *q = d->quant[c->quant];
+    const huffman_t *ac = &d->huffman[1][c->ac_table];
+
+    memset(coef, 0, 64 * sizeof(int32_t));
+    c->dc += receive(d, decode_huffman(d, &d->huffman[0][c->dc_table]));
+    coef[0] = c->dc * q[0];
+    for (uint8_t k = 1; k < 64; k++) {
+        int rs = decode_huffman(d, ac);
+        uint8_t run = rs >> 4;
+        uint8_t size = rs & 0x0F;
+        if (size == 0) {
+            if (run != 15) break; //end of block
+            k += 15; //sixteen zeros
+            continue;
+        }
+        k += run;
+        if (k > 63) {
+            d->corrupt = true;
+            break;
+        }
+        uint8_t n = natural_order[k];
+        coef[n] = receive(d, size) * q[n];
+    }
+}
+
+static inline uint8_t clamp_sample(int32_t v) {
+    return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/**
+ * @brief Inverse DCT of one block into 8 rows of samples.
+ *
+ * Columns first, into a workspace scaled up by PASS1_BITS, then rows. A
+ * column or row whose AC coefficients are all zero is constant, the common
+ * case after quantization, and skips the arithmetic.
+ */
+static void idct_block(const int32_t *coef, uint8_t *out, uint16_t stride) {
+    int32_t ws[64];
+
+    for (uint8_t col = 0; col < 8; col++) {
+        const int32_t *in = &coef[col];
+        int32_t *w = &ws[col];
+        if (!in[8] && !in[16] && !in[24] && !in[32] && !in[40] && !in[48] && !in[56]) {
+            int32_t dc = in[0] * (1 << PASS1_BITS);
+            for (uint8_t r = 0; r < 8; r++) w[8 * r] = dc;
+            continue;
+        }
+
+        int32_t z2 = in[16], z3 = in[48];
+        int32_t z1 = (z2 + z3) * FIX_0_541196100;
+        int32_t tmp2 = z1 - z3 * FIX_1_847759065;
+        int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+        int32_t tmp0 = (in[0] + in[32]) * (1 << CONST_BITS);
+        int32_t tmp1 = (in[0] - in[32]) * (1 << CONST_BITS);
+        int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        tmp0 = in[56];
+        tmp1 = in[40];
+        tmp2 = in[24];
+        tmp3 = in[8];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        int32_t z4 = tmp1 + tmp3;
+        int32_t z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        w[0] = DESCALE(tmp10 + tmp3, CONST_BITS - PASS1_BITS);
+        w[56] = DESCALE(tmp10 - tmp3, CONST_BITS - PASS1_BITS);
+        w[8] = DESCALE(tmp11 + tmp2, CONST_BITS - PASS1_BITS);
+        w[48] = DESCALE(tmp11 - tmp2, CONST_BITS - PASS1_BITS);
+        w[16] = DESCALE(tmp12 + tmp1, CONST_BITS - PASS1_BITS);
+        w[40] = DESCALE(tmp12 - tmp1, CONST_BITS - PASS1_BITS);
+        w[24] = DESCALE(tmp13 + tmp0, CONST_BITS - PASS1_BITS);
+        w[32] = DESCALE(tmp13 - tmp0, CONST_BITS - PASS1_BITS);
+    }
+
+    for (uint8_t row = 0; row < 8; row++, out += stride) {
+        const int32_t *w = &ws[8 * row];
+        if (!w[1] && !w[2] && !w[3] && !w[4] && !w[5] && !w[6] && !w[7]) {
+            memset(out, clamp_sample(DESCALE(w[0], PASS1_BITS + 3) + 128), 8);
+            continue;
+        }
+
+        int32_t z2 = w[2], z3 = w[6];
+        int32_t z1 = (z2 + z3) * FIX_0_541196100;
+        int32_t tmp2 = z1 - z3 * FIX_1_847759065;
+        int32_t tmp3 = z1 + z2 * FIX_0_765366865;
+        int32_t tmp0 = (w[0] + w[4]) * (1 << CONST_BITS);
+        int32_t tmp1 = (w[0] - w[4]) * (1 << CONST_BITS);
+        int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        tmp0 = w[7];
+        tmp1 = w[5];
+        tmp2 = w[3];
+        tmp3 = w[1];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        int32_t z4 = tmp1 + tmp3;
+        int32_t z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        const uint8_t shift = CONST_BITS + PASS1_BITS + 3;
+        out[0] = clamp_sample(DESCALE(tmp10 + tmp3, shift) + 128);
+        out[7] = clamp_sample(DESCALE(tmp10 - tmp3, shift) + 128);
+        out[1] = clamp_sample(DESCALE(tmp11 + tmp2, shift) + 128);
+        out[6] = clamp_sample(DESCALE(tmp11 - tmp2, shift) + 128);
+        out[2] = clamp_sample(DESCALE(tmp12 + tmp1, shift) + 128);
+        out[5] = clamp_sample(DESCALE(tmp12 - tmp1, shift) + 128);
+        out[3] = clamp_sample(DESCALE(tmp13 + tmp0, shift) + 128);
+        out[4] = clamp_sample(DESCALE(tmp13 - tmp0, shift) + 128);
+    }
+}
+
+/**
+ * @brief Decodes one row of MCUs into the component planes.
+ */
+static void decode_mcu_row(decoder_t *d) {
+    int32_t coef[64];
+
+    for (uint16_t mx = 0; mx < d->mcus_x && !d->corrupt; mx++) {
+        if (d->restart_interval) {
+            if (d->restarts_left == 0) {
+                restart(d);
+                d->restarts_left = d->restart_interval;
+            }
+            d->restarts_left--;
+        }
+        for (uint8_t i = 0; i < d->component_count; i++) {
+            component_t *c = &d->components[i];
+            for (uint8_t by = 0; by < c->v; by++) {
+                for (uint8_t bx = 0; bx < c->h; bx++) {
+                    decode_block(d, c, coef);
+                    idct_block(coef, c->plane + by * 8 * c->stride + (mx * c->h + bx) * 8, c->stride);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Turns row ly of the decoded MCU row into RGB888.
+ */
+static void color_row(const decoder_t *d, uint16_t ly, uint8_t *rgb) {
+    const component_t *cy = &d->components[0];
+    const uint8_t *y_row = cy->plane + (ly >> cy->v_shift) * cy->stride;
+
+    if (d->component_count == 1) {
+        for (uint16_t x = 0; x < d->width; x++, rgb += 3) {
+            rgb[0] = rgb[1] = rgb[2] = y_row[x];
+        }
+        return;
+    }
+    const component_t *cb = &d->components[1], *cr = &d->components[2];
+    const uint8_t *cb_row = cb->plane + (ly >> cb->v_shift) * cb->stride;
+    const uint8_t *cr_row = cr->plane + (ly >> cr->v_shift) * cr->stride;
+    for (uint16_t x = 0; x < d->width; x++, rgb += 3) {
+        int32_t luma = y_row[x >> cy->h_shift];
+        int32_t blue = cb_row[x >> cb->h_shift] - 128;
+        int32_t red = cr_row[x >> cr->h_shift] - 128;
+        rgb[0] = clamp_sample(luma + ((FIX_1_40200 * red + 32768) >> 16));
+        rgb[1] = clamp_sample(luma + ((-FIX_0_34414 * blue - FIX_0_71414 * red + 32768) >> 16));
+        rgb[2] = clamp_sample(luma + ((FIX_1_77200 * blue + 32768) >> 16));
+    }
+}
+
+static void wait_strips(const st7789_transport_t *transport, uint8_t *pending) {
+    PERF_PUSH(PERF_STAGE_SPI);
+    while (*pending) {
+        TRACE_BEGIN();
+        transport->wait();
+        TRACE_END(TRACE_WAIT, DATA_MODE, NULL, 0);
+        (*pending)--;
+    }
+    PERF_POP();
+}
+
+/**
+ * @brief Decodes the scan strip by strip and sends every strip on.
+ *
+ * Image row r of a strip lands on screen column x + r and image column c on
+ * screen row y + c, so a panel strip is a window as wide as the strip's
+ * visible rows and as tall as the visible part of a row. Decoding stops at
+ * the first strip that starts right of the screen.
+ */
+static bool decode_scan(decoder_t *d, int16_t x, int16_t y, jpeg_target_t target, dither_t *dither) {
+    size_t plane_bytes = 0;
+    for (uint8_t i = 0; i < d->component_count; i++) plane_bytes += (size_t)d->components[i].stride * d->components[i].v * 8;
+    uint16_t *row565 = malloc((size_t)d->width * 2 + (size_t)d->width * 3 + plane_bytes);
+    if (row565 == NULL) {
+        ESP_LOGE(TAG, "no memory for a %u pixel wide image", d->width);
+        return false;
+    }
+    uint8_t *rgb = (uint8_t *)(row565 + d->width);
+    uint8_t *plane = rgb + (size_t)d->width * 3;
+    for (uint8_t i = 0; i < d->component_count; i++) {
+        d->components[i].plane = plane;
+        plane += (size_t)d->components[i].stride * d->components[i].v * 8;
+    }
+
+    //image columns that fall on screen rows
+    int32_t c0 = (y < 0) ? -y : 0;
+    int32_t c1 = (y + d->width > TFT_HEIGHT) ? TFT_HEIGHT - 1 - y : d->width - 1;
+    const st7789_transport_t *transport = st7789_get_transport();
+    uint8_t pending = 0;
+    uint8_t next = 0;
+    uint16_t strip_height = 8 * d->v_max;
+    d->restarts_left = d->restart_interval;
+
+    for (uint16_t my = 0; my < d->mcus_y && !d->corrupt; my++) {
+        int32_t row0 = my * strip_height;
+        if (x + row0 >= TFT_WIDTH || c1 < c0) break;
+
+        PERF_PUSH(PERF_STAGE_CONVERT);
+        decode_mcu_row(d);
+        stats.strips++;
+
+        uint16_t rows = (row0 + strip_height <= d->height) ? strip_height : d->height - row0;
+        int32_t r0 = (x + row0 < 0) ? -(x + row0) : 0;
+        int32_t r1 = (x + row0 + rows > TFT_WIDTH) ? TFT_WIDTH - 1 - x - row0 : rows - 1;
+        uint16_t visible = (r1 >= r0) ? r1 - r0 + 1 : 0;
+        uint16_t *strip = strip_buffers[next];
+        for (uint16_t r = 0; r < rows; r++) {
+            //every row goes through the dither so its state follows the image
+            color_row(d, r, rgb);
+            rgb888_to_rgb565_row(dither, rgb, row565);
+            if ((int32_t)r < r0 || (int32_t)r > r1) continue;
+
+            if (target == JPEG_TO_PANEL) {
+                uint16_t *dst = &strip[r - r0];
+                for (int32_t c = c0; c <= c1; c++, dst += visible) *dst = (row565[c] >> 8) | (row565[c] << 8);
+            } else {
+#if FRAME_BUFFER_BPP == 16
+                uint16_t *dst = &get_frame_buffer()[(y + c0) * TFT_WIDTH + x + row0 + r];
+                for (int32_t c = c0; c <= c1; c++, dst += TFT_WIDTH) *dst = row565[c];
+#endif
+            }
+            stats.pixels += c1 - c0 + 1;
+        }
+        PERF_POP();
+
+        if (target != JPEG_TO_PANEL || visible == 0) continue;
+        //the window commands cannot go out while the previous strip is on the bus
+        wait_strips(transport, &pending);
+        set_window(x + row0 + r0, x + row0 + r1, y + c0, y + c1);
+        send_cmd(RAMWR);
+        transport->set_dc(DATA_MODE);
+
+        uint32_t bytes = (uint32_t)visible * (c1 - c0 + 1) * 2;
+        PERF_PUSH(PERF_STAGE_SPI);
+        PERF_TRANSFER(bytes);
+        TRACE_BEGIN();
+        transport->queue(strip, bytes);
+        TRACE_END(TRACE_QUEUE, DATA_MODE, strip, bytes);
+        PERF_POP();
+        pending++;
+        next ^= 1;
+    }
+    wait_strips(transport, &pending);
+    free(row565);
+    if (d->corrupt) ESP_LOGE(TAG, "corrupt scan data");
+    return !d->corrupt;
+}
+
+/**
+ * @brief Decodes a JPEG file onto the panel or into the frame buffer.
+ *
+ * @param path The file.
+ * @param x Screen column of the first image row.
+ * @param y Screen row of the first image column.
+ * @param target Where the strips go. JPEG_TO_FRAME_BUFFER needs
+ * FRAME_BUFFER_BPP 16 and sends nothing.
+ * @param dither How colors are reduced to RGB565.
+ * @return false if the file cannot be read, is not a supported JPEG or is
+ * corrupt; the strips decoded before the error stay on screen.
+ */
+bool load_jpeg(const char *path, int16_t x, int16_t y, jpeg_target_t target, dither_mode_t dither) {
+    RECORD_JPEG(path, x, y, target, dither);
+    int64_t start = esp_timer_get_time();
+    memset(&stats, 0, sizeof(stats));
+#if FRAME_BUFFER_BPP != 16
+    if (target == JPEG_TO_FRAME_BUFFER) {
+        ESP_LOGE(TAG, "decoding into the frame buffer needs FRAME_BUFFER_BPP 16");
+        return false;
+    }
+#endif
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "cannot open %s", path);
+        return false;
+    }
+    decoder_t *d = calloc(1, sizeof(decoder_t));
+    if (d == NULL) {
+        fclose(file);
+        return false;
+    }
+    d->file = file;
+
+    bool ok = read_headers(d);
+    if (!ok) {
+        ESP_LOGE(TAG, "%s: unsupported or corrupt JPEG", path);
+    } else {
+        stats.width = d->width;
+        stats.height = d->height;
+        dither_t dt;
+        ok = dither_init(&dt, dither, d->width);
+        if (ok) {
+            ok = decode_scan(d, x, y, target, &dt);
+            dither_free(&dt);
+        }
+    }
+    fclose(file);
+    free(d);
+    stats.total_us = esp_timer_get_time() - start;
+    return ok;
+}
+
+/**
+ * @brief Copies the counters of the last load_jpeg.
+ */
+void jpeg_get_stats(jpeg_stats_t *out) {
+    *out = stats;
+}
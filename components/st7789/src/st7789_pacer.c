@@ -0,0 +1,118 @@
+#include "st7789_pacer.h"
+
+
+/**
+ * @brief One-shot timer callback, wakes the task waiting for the deadline.
+ */
+static void frame_pacer_timer_cb(void *arg) {
+    frame_pacer_t *pacer = arg;
+    xTaskNotifyGive(pacer->task);
+}
+
+/**
+ * @brief Sets up a frame pacer.
+ *
+ * The first frame is due one period after this call.
+ *
+ * @param pacer The pacer to initialize.
+ * @param period_us The frame period, e.g. 33333 for 30 FPS.
+ * @return false if the timer could not be created.
+ */
+bool frame_pacer_init(frame_pacer_t *pacer, uint32_t period_us) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->period_us = period_us ? period_us : 1;
+
+    esp_timer_create_args_t args = {
+        .callback = frame_pacer_timer_cb,
+        .arg = pacer,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "frame_pacer",
+    };
+    if (esp_timer_create(&args, &pacer->timer) != ESP_OK) return false;
+
+    pacer->task = xTaskGetCurrentTaskHandle();
+    pacer->last_frame_us = esp_timer_get_time();
+    pacer->deadline_us = pacer->last_frame_us + pacer->period_us;
+    frame_pacer_reset_stats(pacer);
+    return true;
+}
+
+/**
+ * @brief Releases the timer of a frame pacer.
+ */
+void frame_pacer_deinit(frame_pacer_t *pacer) {
+    if (pacer->timer == NULL) return;
+    esp_timer_stop(pacer->timer);
+    esp_timer_delete(pacer->timer);
+    pacer->timer = NULL;
+}
+
+/**
+ * @brief Clears the frame counters and the jitter statistics.
+ */
+void frame_pacer_reset_stats(frame_pacer_t *pacer) {
+    pacer->frames = 0;
+    pacer->late_frames = 0;
+    pacer->dropped_frames = 0;
+    pacer->interval_min_us = INT32_MAX;
+    pacer->interval_max_us = 0;
+    pacer->jitter_max_us = 0;
+    pacer->jitter_total_us = 0;
+}
+
+/**
+ * @brief Blocks until the next frame is due.
+ *
+ * The task sleeps on a one-shot esp_timer set FRAME_PACER_SPIN_US before the
+ * deadline and spins for the rest, so frames start within a few microseconds
+ * of their deadline whatever the tick rate. When the deadline has already
+ * passed, the task still blocks for one tick, so IDLE and lower priority
+ * tasks run even when every frame is late (the flushes spin on the bus and
+ * never block). The whole periods missed by then, the tick included, are
+ * dropped to stay in phase and the frame starts right away.
+ *
+ * @param pacer The pacer.
+ * @return The number of frames dropped, 0 when the frame is on time.
+ */
+uint32_t frame_pacer_wait(frame_pacer_t *pacer) {
+    uint32_t dropped = 0;
+    int64_t remaining = pacer->deadline_us - esp_timer_get_time();
+
+    if (remaining > FRAME_PACER_SPIN_US) {
+        pacer->task = xTaskGetCurrentTaskHandle();
+        ulTaskNotifyTake(pdTRUE, 0); //clear a notification left by an earlier wait
+        if (esp_timer_start_once(pacer->timer, remaining - FRAME_PACER_SPIN_US) == ESP_OK) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    } else if (remaining < 0) {
+        pacer->late_frames++;
+        vTaskDelay(1);
+        dropped = (esp_timer_get_time() - pacer->deadline_us) / pacer->period_us;
+        pacer->dropped_frames += dropped;
+        pacer->deadline_us += dropped * pacer->period_us;
+    }
+    while (esp_timer_get_time() < pacer->deadline_us) {
+    }
+
+    int64_t now = esp_timer_get_time();
+    int32_t interval = now - pacer->last_frame_us;
+    int32_t expected = (dropped + 1) * pacer->period_us;
+    uint32_t jitter = (interval > expected) ? interval - expected : expected - interval;
+
+    if (interval < pacer->interval_min_us) pacer->interval_min_us = interval;
+    if (interval > pacer->interval_max_us) pacer->interval_max_us = interval;
+    if (jitter > pacer->jitter_max_us) pacer->jitter_max_us = jitter;
+    pacer->jitter_total_us += jitter;
+    pacer->frames++;
+
+    pacer->last_frame_us = now;
+    pacer->deadline_us += pacer->period_us;
+    return dropped;
+}
+
+/**
+ * @brief Returns the average frame time jitter in microseconds.
+ */
+uint32_t frame_pacer_jitter_avg_us(const frame_pacer_t *pacer) {
+    return pacer->frames ? pacer->jitter_total_us / pacer->frames : 0;
+}
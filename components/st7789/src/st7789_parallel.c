@@ -0,0 +1,183 @@
+#include "st7789_parallel.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define RANGE_PACK(lo, hi) (((uint32_t)(hi) << 16) | (uint16_t)(lo))
+#define RANGE_LO(r) ((int32_t)((r) & 0xFFFF))
+#define RANGE_HI(r) ((int32_t)((r) >> 16))
+
+//Rows [lo, hi) still to render by one worker, packed in one word so the
+//owner (taking from the front) and a thief (taking from the back) can both
+//update it with a single compare-and-swap.
+static volatile uint32_t row_ranges[PARALLEL_MAX_WORKERS];
+
+static SemaphoreHandle_t start_sem[PARALLEL_MAX_WORKERS];
+static SemaphoreHandle_t done_sem;
+static uint8_t helper_count = 0;
+static uint8_t worker_count = 1;
+
+static row_shader_t job_shader;
+static void *job_arg;
+
+
+/**
+ * @brief Takes the next chunk of rows from the front of a worker's range.
+ *
+ * Chunk ends are kept on even rows, so two workers never write the same byte
+ * of a 4-bpp frame buffer.
+ *
+ * @return false if the range is empty.
+ */
+static bool take_front(uint8_t worker, int32_t *from, int32_t *to) {
+    uint32_t r = row_ranges[worker];
+    while (1) {
+        int32_t lo = RANGE_LO(r), hi = RANGE_HI(r);
+        if (lo >= hi) return false;
+
+        int32_t next = (lo + PARALLEL_CHUNK_ROWS) & ~1;
+        if (next > hi) next = hi;
+        if (__atomic_compare_exchange_n(&row_ranges[worker], &r, RANGE_PACK(next, hi),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *from = lo;
+            *to = next;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Steals a few rows from the back of another worker's range.
+ *
+ * @return false if the range is empty.
+ */
+static bool take_back(uint8_t worker, int32_t *from, int32_t *to) {
+    uint32_t r = row_ranges[worker];
+    while (1) {
+        int32_t lo = RANGE_LO(r), hi = RANGE_HI(r);
+        if (lo >= hi) return false;
+
+        int32_t prev = (hi - PARALLEL_STEAL_ROWS) & ~1;
+        if (prev < lo) prev = lo;
+        if (__atomic_compare_exchange_n(&row_ranges[worker], &r, RANGE_PACK(lo, prev),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *from = prev;
+            *to = hi;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Renders rows until every worker's range is empty.
+ *
+ * The worker first drains its own range from the front, then steals from the
+ * back of the others, so a worker whose rows turned out cheap ends up helping
+ * with the expensive ones instead of waiting at the barrier.
+ */
+static void run_worker(uint8_t self) {
+    int32_t from, to;
+
+    while (take_front(self, &from, &to)) {
+        for (int32_t y = from; y < to; y++) job_shader(y, job_arg);
+    }
+    for (uint8_t w = 1; w < worker_count; w++) {
+        uint8_t victim = (self + w) % worker_count;
+        while (take_back(victim, &from, &to)) {
+            for (int32_t y = from; y < to; y++) job_shader(y, job_arg);
+        }
+    }
+}
+
+/**
+ * @brief Helper task body, runs one share of every parallel_rows call.
+ */
+static void parallel_task(void *param) {
+    uint8_t self = (uint8_t)(uintptr_t)param;
+    while (1) {
+        xSemaphoreTake(start_sem[self], portMAX_DELAY);
+        run_worker(self);
+        xSemaphoreGive(done_sem);
+    }
+}
+
+/**
+ * @brief Creates the helper tasks, one pinned to every other core.
+ *
+ * The helpers run at the priority of the calling task. Until this is
+ * called, parallel_rows renders everything on the calling task.
+ */
+void parallel_init(void) {
+    if (helper_count) return;
+
+    uint8_t cores = (portNUM_PROCESSORS < PARALLEL_MAX_WORKERS) ? portNUM_PROCESSORS : PARALLEL_MAX_WORKERS;
+    done_sem = xSemaphoreCreateCounting(PARALLEL_MAX_WORKERS, 0);
+    if (done_sem == NULL) return;
+
+    for (uint8_t w = 1; w < cores; w++) {
+        start_sem[w] = xSemaphoreCreateBinary();
+        if (start_sem[w] == NULL) break;
+        BaseType_t core = (xPortGetCoreID() + w) % portNUM_PROCESSORS;
+        if (xTaskCreatePinnedToCore(parallel_task, "parallel", PARALLEL_TASK_STACK, (void *)(uintptr_t)w,
+                                    uxTaskPriorityGet(NULL), NULL, core) != pdPASS) break;
+        helper_count++;
+    }
+    worker_count = helper_count + 1;
+}
+
+/**
+ * @brief Limits how many workers parallel_rows uses.
+ *
+ * @param count Number of workers, 1 renders on the calling task only.
+ */
+void parallel_set_workers(uint8_t count) {
+    if (count < 1) count = 1;
+    if (count > helper_count + 1) count = helper_count + 1;
+    worker_count = count;
+}
+
+/**
+ * @brief Returns how many workers parallel_rows uses.
+ */
+uint8_t parallel_get_workers(void) {
+    return worker_count;
+}
+
+/**
+ * @brief Calls a row shader for every row of a range on all workers.
+ *
+ * The rows are split evenly between the workers, then load-balanced by work
+ * stealing. The function returns only after every row has been rendered, so
+ * the frame buffer can be flushed right after it. Shaders must only write to
+ * their own row. Only one task may call this at a time.
+ *
+ * @param first The first row.
+ * @param last The last row (inclusive).
+ * @param shader The function that renders one row.
+ * @param arg Passed to the shader unchanged.
+ */
+void parallel_rows(int16_t first, int16_t last, row_shader_t shader, void *arg) {
+    if (first < 0) first = 0;
+    if (last >= TFT_HEIGHT) last = TFT_HEIGHT - 1;
+    if (first > last) return;
+
+    job_shader = shader;
+    job_arg = arg;
+
+    int32_t rows = last - first + 1;
+    int32_t start = first;
+    for (uint8_t w = 0; w < worker_count; w++) {
+        int32_t end = (w == worker_count - 1) ? last + 1 : ((first + rows * (w + 1) / worker_count) & ~1);
+        if (end < start) end = start;
+        row_ranges[w] = RANGE_PACK(start, end);
+        start = end;
+    }
+
+    for (uint8_t w = 1; w < worker_count; w++) {
+        xSemaphoreGive(start_sem[w]);
+    }
+    run_worker(0);
+    for (uint8_t w = 1; w < worker_count; w++) {
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+    }
+}
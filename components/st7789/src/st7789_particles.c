@@ -0,0 +1,173 @@
+#include "st7789_particles.h"
+#include "st7789_indexed.h"
+#include <stdlib.h>
+
+#define PARTICLE_ARRAYS 7 //int16_t/uint16_t arrays in one allocation
+
+
+/**
+ * @brief Returns a random value in [0, range) from 16 random bits.
+ */
+static inline uint32_t rand_below(uint32_t bits16, uint32_t range) {
+    return (bits16 * range) >> 16;
+}
+
+/**
+ * @brief Puts every slot back on the free list, lowest index on top.
+ */
+static void particle_reset_free_list(particle_system_t *ps) {
+    for (uint16_t k = 0; k < ps->capacity; k++) {
+        ps->free_list[k] = ps->capacity - 1 - k;
+    }
+    ps->free_count = ps->capacity;
+    ps->span = 0;
+}
+
+/**
+ * @brief Allocates the arrays of a particle system.
+ *
+ * All arrays live in a single allocation of 14 bytes per particle.
+ *
+ * @param ps The particle system to initialize.
+ * @param capacity Maximum number of live particles.
+ * @param seed Seed of the system's random generator, 0 is replaced by 1.
+ * @return false if there is not enough memory.
+ */
+bool particle_system_init(particle_system_t *ps, uint16_t capacity, uint32_t seed) {
+    memset(ps, 0, sizeof(*ps));
+
+    uint16_t *block = calloc((size_t)capacity * PARTICLE_ARRAYS, sizeof(uint16_t));
+    if (block == NULL) return false;
+
+    ps->x = (int16_t *)block;
+    ps->y = (int16_t *)block + capacity;
+    ps->vx = (int16_t *)block + 2 * capacity;
+    ps->vy = (int16_t *)block + 3 * capacity;
+    ps->life = block + 4 * capacity;
+    ps->color = block + 5 * capacity;
+    ps->free_list = block + 6 * capacity;
+    ps->capacity = capacity;
+    ps->rng = seed ? seed : 1;
+    particle_reset_free_list(ps);
+    return true;
+}
+
+/**
+ * @brief Releases the arrays of a particle system.
+ */
+void particle_system_free(particle_system_t *ps) {
+    free(ps->x);
+    memset(ps, 0, sizeof(*ps));
+}
+
+/**
+ * @brief Kills every particle.
+ */
+void particle_clear(particle_system_t *ps) {
+    memset(ps->life, 0, ps->capacity * sizeof(uint16_t));
+    particle_reset_free_list(ps);
+}
+
+/**
+ * @brief Spawns particles from an emitter.
+ *
+ * Slots are taken from the free list, so no search for a dead particle is
+ * needed. Emission stops early when the system is full.
+ *
+ * @param ps The particle system.
+ * @param em Describes where the particles start and how they move.
+ * @param count Number of particles to spawn.
+ * @return The number of particles actually spawned.
+ */
+uint16_t particle_emit(particle_system_t *ps, const particle_emitter_t *em, uint16_t count) {
+    if (count > ps->free_count) count = ps->free_count;
+
+    for (uint16_t n = 0; n < count; n++) {
+        uint16_t i = ps->free_list[--ps->free_count];
+        uint32_t r1 = particle_rand(ps);
+        uint32_t r2 = particle_rand(ps);
+
+        ps->x[i] = em->x;
+        ps->y[i] = em->y;
+        ps->vx[i] = em->vx + (int32_t)rand_below(r1 & 0xFFFF, 2 * em->spread_x + 1) - em->spread_x;
+        ps->vy[i] = em->vy + (int32_t)rand_below(r1 >> 16, 2 * em->spread_y + 1) - em->spread_y;
+        ps->life[i] = em->life + rand_below(r2 & 0xFFFF, em->life_spread + 1);
+        ps->color[i] = em->color_count ? em->colors[rand_below(r2 >> 16, em->color_count)] : 0xFFFF;
+        if (ps->life[i] == 0) ps->life[i] = 1;
+        if (i >= ps->span) ps->span = i + 1;
+    }
+    return count;
+}
+
+/**
+ * @brief Kills one particle and returns its slot to the free list.
+ *
+ * @param ps The particle system.
+ * @param i The slot of the particle, ignored if it is already dead.
+ */
+void particle_kill(particle_system_t *ps, uint16_t i) {
+    if (i >= ps->span || ps->life[i] == 0) return;
+    ps->life[i] = 0;
+    ps->free_list[ps->free_count++] = i;
+}
+
+/**
+ * @brief Advances every particle by one step.
+ *
+ * The integrate pass runs over the used slots without branches, dead slots
+ * included, so the compiler can keep it a tight loop. A second pass ages the
+ * particles and culls the ones that ran out of life or left the screen by
+ * more than PARTICLE_MARGIN pixels.
+ *
+ * @param ps The particle system.
+ */
+void particle_update(particle_system_t *ps) {
+    uint16_t span = ps->span;
+    int16_t ax = ps->ax, ay = ps->ay;
+    int16_t *x = ps->x, *y = ps->y, *vx = ps->vx, *vy = ps->vy;
+
+    for (uint16_t i = 0; i < span; i++) {
+        vx[i] += ax;
+        vy[i] += ay;
+        x[i] += vx[i];
+        y[i] += vy[i];
+    }
+
+    for (uint16_t i = 0; i < span; i++) {
+        if (ps->life[i] == 0) continue;
+        uint32_t px = PARTICLE_TO_INT(x[i]) + PARTICLE_MARGIN;
+        uint32_t py = PARTICLE_TO_INT(y[i]) + PARTICLE_MARGIN;
+        if (--ps->life[i] == 0 || px >= TFT_WIDTH + 2 * PARTICLE_MARGIN || py >= TFT_HEIGHT + 2 * PARTICLE_MARGIN) {
+            ps->life[i] = 0;
+            ps->free_list[ps->free_count++] = i;
+        }
+    }
+
+    if (ps->free_count == ps->capacity) particle_reset_free_list(ps);
+}
+
+/**
+ * @brief Draws every live particle as one pixel.
+ *
+ * Clipping is a single unsigned compare per axis. With the RGB565 frame
+ * buffer the pixels are stored directly, in indexed mode they go through
+ * draw_pixel and the color is a palette index.
+ *
+ * @param ps The particle system.
+ */
+void particle_render(const particle_system_t *ps) {
+#if FRAME_BUFFER_BPP == 16
+    uint16_t *fb = get_frame_buffer();
+#endif
+    for (uint16_t i = 0; i < ps->span; i++) {
+        if (ps->life[i] == 0) continue;
+        uint32_t px = PARTICLE_TO_INT(ps->x[i]);
+        uint32_t py = PARTICLE_TO_INT(ps->y[i]);
+        if (px >= TFT_WIDTH || py >= TFT_HEIGHT) continue;
+#if FRAME_BUFFER_BPP == 16
+        fb[py * TFT_WIDTH + px] = ps->color[i];
+#else
+        draw_pixel(px, py, ps->color[i]);
+#endif
+    }
+}
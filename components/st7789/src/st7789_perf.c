@@ -0,0 +1,268 @@
+#include "st7789_perf.h"
+
+#if ST7789_PERF
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+static const char *TAG = "perf";
+static const char *stage_names[PERF_STAGE_COUNT] = {"render", "overlay", "window", "convert", "spi"};
+
+static perf_stats_t stats;
+static uint32_t cycles_per_us;
+
+static perf_stage_t current = PERF_STAGE_RENDER;
+static uint32_t stage_start; //cycle count when the current stage was entered
+static uint32_t frame_cycles[PERF_STAGE_COUNT];
+static perf_stage_t stack[PERF_STACK_DEPTH];
+static uint8_t depth;
+static uint32_t last_flush_end;
+static uint64_t flush_start_bytes;
+static uint32_t flush_start_transactions;
+
+static uint8_t *overlay_font;
+static uint16_t overlay_x, overlay_y, overlay_color, overlay_background;
+static char overlay_text[PERF_OVERLAY_LINES * (PERF_OVERLAY_COLS + 1) + 1];
+static uint32_t overlay_cycles[PERF_STAGE_COUNT];
+static uint32_t overlay_interval_us;
+static uint8_t overlay_frames;
+
+
+/**
+ * @brief Clears every counter and the histogram.
+ */
+void perf_reset(void) {
+    memset(&stats, 0, sizeof(stats));
+    memset(overlay_cycles, 0, sizeof(overlay_cycles));
+    overlay_interval_us = 0;
+    overlay_frames = 0;
+    cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+    last_flush_end = esp_cpu_get_cycle_count();
+    perf_frame_begin();
+}
+
+/**
+ * @brief Converts a cycle count to microseconds.
+ */
+uint32_t perf_cycles_to_us(uint64_t cycles) {
+    if (cycles_per_us == 0) cycles_per_us = esp_rom_get_cpu_ticks_per_us();
+    return cycles / cycles_per_us;
+}
+
+/**
+ * @brief Marks the start of a frame.
+ *
+ * Everything since the previous flush is discarded, so time spent waiting
+ * for the frame deadline does not count as rendering. Without this call the
+ * render stage runs from the end of one flush to the start of the next.
+ */
+void perf_frame_begin(void) {
+    memset(frame_cycles, 0, sizeof(frame_cycles));
+    current = PERF_STAGE_RENDER;
+    depth = 0;
+    stage_start = esp_cpu_get_cycle_count();
+}
+
+/**
+ * @brief Switches the stage that the elapsed cycles are charged to.
+ *
+ * @param stage The stage that starts now.
+ */
+void perf_enter(perf_stage_t stage) {
+    uint32_t now = esp_cpu_get_cycle_count();
+    frame_cycles[current] += now - stage_start;
+    stage_start = now;
+    current = stage;
+}
+
+/**
+ * @brief Enters a stage and remembers the current one for perf_pop.
+ */
+void perf_push(perf_stage_t stage) {
+    if (depth < PERF_STACK_DEPTH) stack[depth] = current;
+    depth++;
+    perf_enter(stage);
+}
+
+/**
+ * @brief Returns to the stage that was current before the matching perf_push.
+ */
+void perf_pop(void) {
+    if (depth == 0) return;
+    depth--;
+    perf_enter(depth < PERF_STACK_DEPTH ? stack[depth] : PERF_STAGE_RENDER);
+}
+
+/**
+ * @brief Counts one SPI transaction.
+ *
+ * @param bytes Number of bytes in the transaction.
+ */
+void perf_transfer(uint32_t bytes) {
+    stats.total_bytes += bytes;
+    stats.total_transactions++;
+}
+
+/**
+ * @brief Appends a microsecond value as milliseconds with one decimal.
+ */
+static int format_ms(char *dst, size_t size, const char *label, uint32_t us) {
+    return snprintf(dst, size, "%s%2lu.%lu", label, (unsigned long)(us / 1000), (unsigned long)(us / 100 % 10));
+}
+
+/**
+ * @brief Rebuilds the overlay text from the frames averaged since the last update.
+ */
+static void perf_overlay_update(void) {
+    uint32_t n = overlay_frames;
+    uint32_t interval = overlay_interval_us / n;
+    uint32_t fps10 = interval ? 10000000 / interval : 0;
+    uint32_t frame = 0;
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) frame += overlay_cycles[s];
+
+    char *p = overlay_text;
+    char *end = overlay_text + sizeof(overlay_text);
+    p += snprintf(p, end - p, "%3lu.%lu FPS ", (unsigned long)(fps10 / 10), (unsigned long)(fps10 % 10));
+    p += format_ms(p, end - p, "", perf_cycles_to_us(frame / n));
+    p += format_ms(p, end - p, "\nR", perf_cycles_to_us(overlay_cycles[PERF_STAGE_RENDER] / n));
+    p += format_ms(p, end - p, " C", perf_cycles_to_us(overlay_cycles[PERF_STAGE_CONVERT] / n));
+    p += format_ms(p, end - p, "\nW", perf_cycles_to_us(overlay_cycles[PERF_STAGE_WINDOW] / n));
+    format_ms(p, end - p, " S", perf_cycles_to_us(overlay_cycles[PERF_STAGE_SPI] / n));
+
+    memset(overlay_cycles, 0, sizeof(overlay_cycles));
+    overlay_interval_us = 0;
+    overlay_frames = 0;
+}
+
+/**
+ * @brief Draws the overlay into the frame buffer over a solid background box.
+ */
+static void perf_overlay_draw(void) {
+    draw_rectangle(overlay_x, overlay_y,
+                   overlay_x + PERF_OVERLAY_COLS * FONT_WIDTH - 1,
+                   overlay_y + PERF_OVERLAY_LINES * (FONT_HEIGHT + 2) - 1, overlay_background);
+    draw_text_scaled(overlay_x, overlay_y, overlay_text, overlay_color, 1, overlay_font);
+}
+
+/**
+ * @brief Called by flush_frame_buffer before anything is sent.
+ *
+ * Closes the render stage, draws the overlay if enabled and starts counting
+ * the bytes and transactions of the flush.
+ */
+void perf_flush_begin(void) {
+    if (overlay_font) {
+        perf_enter(PERF_STAGE_OVERLAY);
+        perf_overlay_draw();
+    }
+    perf_enter(PERF_STAGE_WINDOW);
+    flush_start_bytes = stats.total_bytes;
+    flush_start_transactions = stats.total_transactions;
+}
+
+/**
+ * @brief Called by flush_frame_buffer once the last pixel is sent.
+ *
+ * Folds the stage times of the frame into the statistics and the histogram
+ * and starts the next frame.
+ */
+void perf_flush_end(void) {
+    perf_enter(current);
+    uint32_t now = stage_start;
+
+    uint32_t frame = 0;
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        uint32_t c = frame_cycles[s];
+        frame += c;
+        stats.stage_last[s] = c;
+        stats.stage_total[s] += c;
+        if (c > stats.stage_max[s]) stats.stage_max[s] = c;
+        overlay_cycles[s] += c;
+    }
+
+    uint32_t frame_us = perf_cycles_to_us(frame);
+    stats.frame_us_last = frame_us;
+    if (stats.frames == 0 || frame_us < stats.frame_us_min) stats.frame_us_min = frame_us;
+    if (frame_us > stats.frame_us_max) stats.frame_us_max = frame_us;
+    uint32_t bin = frame_us / PERF_HIST_BIN_US;
+    stats.histogram[bin < PERF_HIST_BINS ? bin : PERF_HIST_BINS - 1]++;
+
+    stats.interval_us_last = perf_cycles_to_us(now - last_flush_end);
+    stats.flush_bytes = stats.total_bytes - flush_start_bytes;
+    stats.flush_transactions = stats.total_transactions - flush_start_transactions;
+    stats.frames++;
+    last_flush_end = now;
+
+    overlay_interval_us += stats.interval_us_last;
+    if (++overlay_frames >= PERF_OVERLAY_REFRESH) perf_overlay_update();
+
+    perf_frame_begin();
+}
+
+/**
+ * @brief Copies the current statistics.
+ *
+ * @param out Where to store the copy.
+ */
+void perf_get_stats(perf_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+}
+
+/**
+ * @brief Logs the average and worst time of every stage, the flush traffic
+ *        and the frame time histogram.
+ */
+void perf_log_stats(void) {
+    if (stats.frames == 0) return;
+
+    uint64_t all = 0;
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) all += stats.stage_total[s];
+
+    ESP_LOGI(TAG, "%-8s %8s %8s %6s", "stage", "avg us", "max us", "share");
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        ESP_LOGI(TAG, "%-8s %8lu %8lu %5lu%%", stage_names[s],
+                 (unsigned long)perf_cycles_to_us(stats.stage_total[s] / stats.frames),
+                 (unsigned long)perf_cycles_to_us(stats.stage_max[s]),
+                 (unsigned long)(all ? stats.stage_total[s] * 100 / all : 0));
+    }
+    ESP_LOGI(TAG, "frames %lu, frame us min %lu avg %lu max %lu, flush %lu bytes in %lu transactions",
+             (unsigned long)stats.frames, (unsigned long)stats.frame_us_min,
+             (unsigned long)perf_cycles_to_us(all / stats.frames), (unsigned long)stats.frame_us_max,
+             (unsigned long)stats.flush_bytes, (unsigned long)stats.flush_transactions);
+    for (int b = 0; b < PERF_HIST_BINS; b++) {
+        if (stats.histogram[b] == 0) continue;
+        ESP_LOGI(TAG, "%3d-%3d ms%s %lu", b * PERF_HIST_BIN_US / 1000, (b + 1) * PERF_HIST_BIN_US / 1000,
+                 (b == PERF_HIST_BINS - 1) ? "+" : " ", (unsigned long)stats.histogram[b]);
+    }
+}
+
+/**
+ * @brief Draws the FPS and stage timings into the frame buffer before every flush.
+ *
+ * The text is refreshed every PERF_OVERLAY_REFRESH frames with the averages
+ * of those frames: frame rate and frame time, then render (R), convert (C),
+ * window (W) and SPI (S) time in milliseconds. In indexed mode the colors
+ * are palette indices.
+ *
+ * @param font The font used by draw_text_scaled.
+ * @param x The x-coordinate of the top-left corner.
+ * @param y The y-coordinate of the top-left corner.
+ * @param color The text color.
+ * @param background The color of the box behind the text.
+ */
+void perf_overlay_enable(uint8_t *font, uint16_t x, uint16_t y, uint16_t color, uint16_t background) {
+    overlay_x = x;
+    overlay_y = y;
+    overlay_color = color;
+    overlay_background = background;
+    overlay_text[0] = '\0';
+    overlay_font = font;
+}
+
+/**
+ * @brief Stops drawing the overlay.
+ */
+void perf_overlay_disable(void) {
+    overlay_font = NULL;
+}
+
+#endif
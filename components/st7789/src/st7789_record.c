@@ -0,0 +1,278 @@
+#include "st7789_record.h"
+#include "st7789_jpeg.h"
+#include "esp_timer.h"
+
+static const char *TAG = "record";
+
+//uint16 arguments of each op, the text and image data come after them
+static const uint8_t arg_counts[RECORD_OP_COUNT] = {1, 3, 4, 5, 5, 4, 5, 0, 0, 4, 4};
+static const char *op_names[RECORD_OP_COUNT] = {
+    "clear", "pixel", "hline", "rect", "char", "text", "direct fill", "image", "flush", "flush rect", "jpeg"
+};
+
+#define RECORD_HEADER_SIZE 10
+
+
+#if ST7789_RECORD
+static FILE *log_file;
+static uint8_t suspended;
+static bool truncated;
+
+
+/**
+ * @brief Opens a new log and starts recording.
+ *
+ * @param path The file to write, replaced if it exists.
+ * @return false if the file could not be created.
+ */
+bool record_start(const char *path) {
+    record_stop();
+    log_file = fopen(path, "wb");
+    if (log_file == NULL) {
+        ESP_LOGE(TAG, "cannot create %s", path);
+        return false;
+    }
+    uint8_t header[RECORD_HEADER_SIZE] = {
+        'S', 'T', '7', 'R', RECORD_VERSION, FRAME_BUFFER_BPP,
+        TFT_WIDTH & 0xFF, TFT_WIDTH >> 8, TFT_HEIGHT & 0xFF, TFT_HEIGHT >> 8
+    };
+    fwrite(header, 1, sizeof(header), log_file);
+    suspended = 0;
+    truncated = false;
+    return true;
+}
+
+/**
+ * @brief Stops recording and closes the log.
+ */
+void record_stop(void) {
+    if (log_file == NULL) return;
+    fclose(log_file);
+    log_file = NULL;
+}
+
+/**
+ * @brief Appends one call to the log.
+ *
+ * Ignored while no log is open or while a recorded call is running, so only
+ * the calls made by the application end up in the log. Text and paths longer
+ * than RECORD_MAX_DATA are cut.
+ *
+ * @param op The call.
+ * @param args Its arguments, arg_counts[op] of them.
+ * @param count Number of arguments.
+ * @param data Text or path, NULL for the other calls.
+ * @param size Length of data in bytes.
+ */
+void record_call(record_op_t op, const uint16_t *args, uint8_t count, const void *data, size_t size) {
+    if (log_file == NULL || suspended) return;
+
+    uint8_t record[1 + 2 * 5 + 2];
+    uint8_t n = 0;
+    record[n++] = op;
+    for (uint8_t i = 0; i < count; i++) {
+        record[n++] = args[i] & 0xFF;
+        record[n++] = args[i] >> 8;
+    }
+    if (op == RECORD_OP_TEXT || op == RECORD_OP_IMAGE || op == RECORD_OP_JPEG) {
+        if (size > RECORD_MAX_DATA) {
+            if (!truncated) ESP_LOGW(TAG, "text longer than %d bytes cut", RECORD_MAX_DATA);
+            truncated = true;
+            size = RECORD_MAX_DATA;
+        }
+        record[n++] = size & 0xFF;
+        record[n++] = size >> 8;
+    }
+    fwrite(record, 1, n, log_file);
+    if (size) fwrite(data, 1, size, log_file);
+}
+
+/**
+ * @brief Stops recording the calls made by a recorded call. Nests.
+ */
+void record_suspend(void) {
+    suspended++;
+}
+
+/**
+ * @brief Ends the matching record_suspend.
+ */
+void record_resume(void) {
+    if (suspended) suspended--;
+}
+#endif
+
+
+typedef struct {
+    FILE *file;
+    uint8_t buffer[REPLAY_CHUNK];
+    uint32_t pos, fill;
+    int64_t read_us; //time spent reading, taken out of the replay time
+} replay_reader_t;
+
+/**
+ * @brief Makes sure the next size bytes of the log are in the buffer.
+ *
+ * @return false at the end of the log.
+ */
+static bool reader_need(replay_reader_t *r, uint32_t size) {
+    if (r->fill - r->pos >= size) return true;
+
+    int64_t start = esp_timer_get_time();
+    memmove(r->buffer, &r->buffer[r->pos], r->fill - r->pos);
+    r->fill -= r->pos;
+    r->pos = 0;
+    r->fill += fread(&r->buffer[r->fill], 1, REPLAY_CHUNK - r->fill, r->file);
+    r->read_us += esp_timer_get_time() - start;
+    return r->fill >= size;
+}
+
+static uint16_t reader_u16(replay_reader_t *r) {
+    uint16_t v = r->buffer[r->pos] | (r->buffer[r->pos + 1] << 8);
+    r->pos += 2;
+    return v;
+}
+
+/**
+ * @brief Builds the path of a recorded image load.
+ *
+ * With an image directory the recorded directory is replaced by it, so a log
+ * captured with /spiffs paths can be replayed from anywhere.
+ */
+static void image_path(char *dst, size_t size, const char *recorded, const char *image_dir) {
+    if (image_dir == NULL) {
+        snprintf(dst, size, "%s", recorded);
+        return;
+    }
+    const char *name = strrchr(recorded, '/');
+    snprintf(dst, size, "%s/%s", image_dir, name ? name + 1 : recorded);
+}
+
+/**
+ * @brief Re-issues every call of a log as fast as possible.
+ *
+ * The log is read in REPLAY_CHUNK pieces and the reading time is left out of
+ * the measurements. A frame ends with every flush, partial or not, and
+ * every image load straight to the panel, and runs from the end of the
+ * previous one. The frame buffer format and size must match the build that
+ * recorded the log.
+ *
+ * @param path The log to replay.
+ * @param font The font for text calls, the log does not contain it.
+ * @param image_dir Directory to load images from, NULL for the recorded paths.
+ * @param result Filled with the counts and timings, may be NULL.
+ * @return false if the log cannot be read or does not match this build.
+ */
+bool record_replay(const char *path, uint8_t *font, const char *image_dir, replay_result_t *result) {
+    static replay_reader_t r;
+    static char data[RECORD_MAX_DATA + 1];
+    static char image[RECORD_MAX_DATA + 64];
+
+    r.file = fopen(path, "rb");
+    if (r.file == NULL) {
+        ESP_LOGE(TAG, "cannot open %s", path);
+        return false;
+    }
+    r.pos = r.fill = 0;
+    r.read_us = 0;
+
+    const uint8_t *h = r.buffer;
+    if (!reader_need(&r, RECORD_HEADER_SIZE) || memcmp(h, "ST7R", 4) != 0 || h[4] != RECORD_VERSION) {
+        ESP_LOGE(TAG, "%s is not a version %d draw call log", path, RECORD_VERSION);
+        fclose(r.file);
+        return false;
+    }
+    if (h[5] != FRAME_BUFFER_BPP || (h[6] | (h[7] << 8)) != TFT_WIDTH || (h[8] | (h[9] << 8)) != TFT_HEIGHT) {
+        ESP_LOGE(TAG, "%s was recorded at %u bpp %ux%u", path, h[5], h[6] | (h[7] << 8), h[8] | (h[9] << 8));
+        fclose(r.file);
+        return false;
+    }
+    r.pos = RECORD_HEADER_SIZE;
+
+#if ST7789_RECORD
+    record_suspend(); //a replay is not recorded
+#endif
+    replay_result_t res = {0};
+    res.frame_min_us = UINT32_MAX;
+    int64_t start = esp_timer_get_time();
+    int64_t frame_start = start;
+    int64_t frame_read_us = 0;
+
+    while (reader_need(&r, 1)) {
+        uint8_t op = r.buffer[r.pos];
+        if (op >= RECORD_OP_COUNT) {
+            ESP_LOGE(TAG, "%s: unknown op %u", path, op);
+            break;
+        }
+        bool has_data = (op == RECORD_OP_TEXT || op == RECORD_OP_IMAGE || op == RECORD_OP_JPEG);
+        if (!reader_need(&r, 1 + 2 * arg_counts[op] + (has_data ? 2 : 0))) break;
+        r.pos++;
+
+        uint16_t a[5];
+        for (uint8_t i = 0; i < arg_counts[op]; i++) a[i] = reader_u16(&r);
+        if (has_data) {
+            uint16_t size = reader_u16(&r);
+            if (size > RECORD_MAX_DATA || !reader_need(&r, size)) break;
+            memcpy(data, &r.buffer[r.pos], size);
+            data[size] = '\0';
+            r.pos += size;
+        }
+
+        switch (op) {
+            case RECORD_OP_CLEAR: clear_frame_buffer(a[0]); break;
+            case RECORD_OP_PIXEL: draw_pixel(a[0], a[1], a[2]); break;
+            case RECORD_OP_HLINE: draw_hline(a[0], a[1], a[2], a[3]); break;
+            case RECORD_OP_RECT: draw_rectangle(a[0], a[1], a[2], a[3], a[4]); break;
+            case RECORD_OP_CHAR: draw_char_scaled(a[0], a[1], a[2], a[3], a[4], font); break;
+            case RECORD_OP_TEXT: draw_text_scaled(a[0], a[1], data, a[2], a[3], font); break;
+            case RECORD_OP_DIRECT_FILL: fill_rect_direct(a[0], a[1], a[2], a[3], a[4]); break;
+            case RECORD_OP_IMAGE:
+                image_path(image, sizeof(image), data, image_dir);
+                load_image(image);
+                break;
+            case RECORD_OP_FLUSH: flush_frame_buffer(); break;
+            case RECORD_OP_FLUSH_RECT: flush_frame_buffer_rect(a[0], a[1], a[2], a[3]); break;
+            case RECORD_OP_JPEG:
+                image_path(image, sizeof(image), data, image_dir);
+                load_jpeg(image, a[0], a[1], a[2], a[3]);
+                break;
+        }
+        res.calls++;
+        res.op_count[op]++;
+
+        if (op == RECORD_OP_FLUSH || op == RECORD_OP_FLUSH_RECT || op == RECORD_OP_IMAGE ||
+            (op == RECORD_OP_JPEG && a[2] == JPEG_TO_PANEL)) {
+            int64_t now = esp_timer_get_time();
+            uint32_t used = now - frame_start - (r.read_us - frame_read_us);
+            if (used < res.frame_min_us) res.frame_min_us = used;
+            if (used > res.frame_max_us) res.frame_max_us = used;
+            res.frames_us += used;
+            res.frames++;
+            frame_start = now;
+            frame_read_us = r.read_us;
+        }
+    }
+
+    res.total_us = esp_timer_get_time() - start - r.read_us;
+    if (res.frames == 0) res.frame_min_us = 0;
+#if ST7789_RECORD
+    record_resume();
+#endif
+    fclose(r.file);
+    if (result) *result = res;
+    return true;
+}
+
+/**
+ * @brief Logs the timings and call counts of a replay.
+ */
+void record_log_result(const replay_result_t *result) {
+    uint32_t avg = result->frames ? result->frames_us / result->frames : 0;
+    ESP_LOGI(TAG, "%lu calls, %lu frames in %lu us: %.1f FPS, frame min %lu avg %lu max %lu us",
+             (unsigned long)result->calls, (unsigned long)result->frames, (unsigned long)result->total_us,
+             result->total_us ? result->frames * 1000000.0 / result->total_us : 0.0,
+             (unsigned long)result->frame_min_us, (unsigned long)avg, (unsigned long)result->frame_max_us);
+    for (int op = 0; op < RECORD_OP_COUNT; op++) {
+        if (result->op_count[op]) ESP_LOGI(TAG, "%-12s %8lu", op_names[op], (unsigned long)result->op_count[op]);
+    }
+}
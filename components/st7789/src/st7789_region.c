@@ -0,0 +1,105 @@
+#include "st7789_region.h"
+
+
+static inline uint32_t rect_area(const region_rect_t *r) {
+    return (uint32_t)(r->x1 - r->x0 + 1) * (r->y1 - r->y0 + 1);
+}
+
+/**
+ * @brief Tells whether two rectangles share at least one pixel.
+ */
+bool region_overlap(const region_rect_t *a, const region_rect_t *b) {
+    return a->x0 <= b->x1 && a->x1 >= b->x0 && a->y0 <= b->y1 && a->y1 >= b->y0;
+}
+
+/**
+ * @brief Returns the smallest rectangle holding both.
+ */
+region_rect_t region_union(const region_rect_t *a, const region_rect_t *b) {
+    region_rect_t u = *a;
+    if (b->x0 < u.x0) u.x0 = b->x0;
+    if (b->y0 < u.y0) u.y0 = b->y0;
+    if (b->x1 > u.x1) u.x1 = b->x1;
+    if (b->y1 > u.y1) u.y1 = b->y1;
+    return u;
+}
+
+/**
+ * @brief Empties a list.
+ */
+void region_clear(region_list_t *list) {
+    list->count = 0;
+}
+
+/**
+ * @brief Finds the pair of rectangles whose union adds the fewest pixels.
+ *
+ * @return The pixels the union adds over the two rectangles, 0 if they overlap.
+ */
+static uint32_t cheapest_pair(const region_list_t *list, uint16_t *a_out, uint16_t *b_out) {
+    uint32_t best = UINT32_MAX;
+    for (uint16_t a = 0; a < list->count; a++) {
+        for (uint16_t b = a + 1; b < list->count; b++) {
+            const region_rect_t *ra = &list->rects[a], *rb = &list->rects[b];
+            region_rect_t u = region_union(ra, rb);
+            uint32_t parts = rect_area(ra) + rect_area(rb);
+            uint32_t cost = (region_overlap(ra, rb) || rect_area(&u) <= parts) ? 0 : rect_area(&u) - parts;
+            if (cost < best) {
+                best = cost;
+                *a_out = a;
+                *b_out = b;
+            }
+        }
+    }
+    return best;
+}
+
+static void join(region_list_t *list, uint16_t a, uint16_t b) {
+    list->rects[a] = region_union(&list->rects[a], &list->rects[b]);
+    list->rects[b] = list->rects[--list->count];
+}
+
+/**
+ * @brief Adds a rectangle, clipped to the screen.
+ *
+ * Corners may come in any order. Nothing is added when the rectangle is off
+ * screen.
+ */
+void region_add(region_list_t *list, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= TFT_WIDTH) x1 = TFT_WIDTH - 1;
+    if (y1 >= TFT_HEIGHT) y1 = TFT_HEIGHT - 1;
+    if (x0 > x1 || y0 > y1) return;
+
+    if (list->count == REGION_MAX) {
+        uint16_t a = 0, b = 0;
+        cheapest_pair(list, &a, &b);
+        join(list, a, b);
+    }
+    list->rects[list->count++] = (region_rect_t){x0, y0, x1, y1};
+}
+
+/**
+ * @brief Adds every rectangle of another list.
+ */
+void region_add_list(region_list_t *list, const region_list_t *other) {
+    for (uint16_t i = 0; i < other->count; i++) {
+        const region_rect_t *r = &other->rects[i];
+        region_add(list, r->x0, r->y0, r->x1, r->y1);
+    }
+}
+
+/**
+ * @brief Joins rectangles that overlap or whose union holds at most
+ * REGION_MERGE_SLACK pixels more than the two of them.
+ */
+void region_merge(region_list_t *list) {
+    while (list->count > 1) {
+        uint16_t a = 0, b = 0;
+        if (cheapest_pair(list, &a, &b) > REGION_MERGE_SLACK) break;
+        join(list, a, b);
+    }
+}
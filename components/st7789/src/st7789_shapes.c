@@ -0,0 +1,532 @@
+#include "st7789_shapes.h"
+#include "st7789_fxmath.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct {
+    int32_t sx, sy; //direction of the start ray
+    int32_t ex, ey; //direction of the end ray
+} arc_cone_t;
+
+
+/**
+ * @brief Steps a circle half-width down to the next row.
+ *
+ * Half-widths shrink monotonically as the row offset grows, so walking the
+ * rows outwards lets every primitive find its span ends with a few compares
+ * instead of a square root. A pixel is inside when x^2 + dy^2 <= limit, where
+ * limit is r^2 + r (the midpoint criterion used by Bresenham's circle).
+ *
+ * @param x The half-width found for the previous row.
+ * @param dy The row offset from the center.
+ * @param limit The squared radius threshold.
+ * @return The half-width of row dy, or -1 if the row is outside the circle.
+ */
+static inline int16_t circle_step(int16_t x, int32_t dy, int32_t limit) {
+    while (x >= 0 && (int32_t)x * x + dy * dy > limit) x--;
+    return x;
+}
+
+/**
+ * @brief Same as circle_step but for an axis-aligned ellipse.
+ *
+ * @param x The half-width found for the previous row.
+ * @param dy The row offset from the center.
+ * @param rx2 The squared horizontal radius.
+ * @param ry2 The squared vertical radius.
+ * @param limit The threshold for x^2 * ry^2 + dy^2 * rx^2.
+ * @return The half-width of row dy, or -1 if the row is outside the ellipse.
+ */
+static inline int16_t ellipse_step(int16_t x, int64_t dy, int64_t rx2, int64_t ry2, int64_t limit) {
+    while (x >= 0 && (int64_t)x * x * ry2 + dy * dy * rx2 > limit) x--;
+    return x;
+}
+
+/**
+ * @brief Draws the outline pixels of one row pair of a symmetric shape.
+ *
+ * Pixels with |x| in [lo, hi] are drawn on rows y0 + dy and y0 - dy. When the
+ * two sides touch they are merged into a single span.
+ */
+static void ring_rows(int16_t x0, int16_t y0, int16_t dy, int16_t lo, int16_t hi, uint16_t color) {
+    if (hi < 0) return;
+    if (lo <= 0) {
+        draw_hline(x0 - hi, x0 + hi, y0 + dy, color);
+        if (dy) draw_hline(x0 - hi, x0 + hi, y0 - dy, color);
+        return;
+    }
+    draw_hline(x0 - hi, x0 - lo, y0 + dy, color);
+    draw_hline(x0 + lo, x0 + hi, y0 + dy, color);
+    if (dy) {
+        draw_hline(x0 - hi, x0 - lo, y0 - dy, color);
+        draw_hline(x0 + lo, x0 + hi, y0 - dy, color);
+    }
+}
+
+/**
+ * @brief Draws a straight line between two points.
+ *
+ * Uses Bresenham's algorithm, but instead of plotting pixels one by one it
+ * collects each horizontal run and writes it as a single span, so shallow
+ * lines cost one span per row.
+ *
+ * @param x0 The x-coordinate of the start point.
+ * @param y0 The y-coordinate of the start point.
+ * @param x1 The x-coordinate of the end point.
+ * @param y1 The y-coordinate of the end point.
+ * @param color The color of the line.
+ */
+void draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    if (y0 == y1) {
+        draw_hline(x0, x1, y0, color);
+        return;
+    }
+
+    int32_t dx = abs(x1 - x0);
+    int32_t dy = -abs(y1 - y0);
+    int16_t sx = (x0 < x1) ? 1 : -1;
+    int16_t sy = (y0 < y1) ? 1 : -1;
+    int32_t err = dx + dy;
+    int16_t run_start = x0;
+
+    while (x0 != x1 || y0 != y1) {
+        int32_t e2 = 2 * err;
+        int16_t nx = x0, ny = y0;
+        if (e2 >= dy) { err += dy; nx += sx; }
+        if (e2 <= dx) { err += dx; ny += sy; }
+        if (ny != y0) {
+            draw_hline(run_start, x0, y0, color);
+            run_start = nx;
+        }
+        x0 = nx;
+        y0 = ny;
+    }
+    draw_hline(run_start, x0, y0, color);
+}
+
+//Outline runs are a few pixels long, so with the RGB565 frame buffer they
+//are clipped and stored inline; with an indexed buffer, or while draw calls
+//are recorded, they go through draw_pixel and draw_hline
+#define OUTLINE_DIRECT (FRAME_BUFFER_BPP == 16 && !ST7789_RECORD)
+
+/**
+ * @brief Draws one run of an outline, pixels xa to xb of row y (xa <= xb).
+ */
+static inline void outline_run(uint16_t *fb, int16_t xa, int16_t xb, int16_t y, uint16_t color) {
+#if OUTLINE_DIRECT
+    if ((uint16_t)y >= TFT_HEIGHT) return;
+    if (xa < 0) xa = 0;
+    if (xb >= TFT_WIDTH) xb = TFT_WIDTH - 1;
+    uint16_t *row = &fb[y * TFT_WIDTH];
+    for (int16_t x = xa; x <= xb; x++) row[x] = color;
+#else
+    if (xa == xb) {
+        draw_pixel(xa, y, color);
+    } else {
+        draw_hline(xa, xb, y, color);
+    }
+#endif
+}
+
+/**
+ * @brief Draws the outline of a circle.
+ *
+ * Walks one octant with the midpoint algorithm and mirrors it eight ways.
+ * In the steep octants every row holds a single pixel, which is stored
+ * directly; in the shallow ones the pixels of a row are collected while the
+ * walk stays on it and written as one span when it moves on, so no row is
+ * visited twice and no span is clipped for a single pixel. The pixels are
+ * the same as the per-pixel Bresenham outline.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param r The radius of the circle.
+ * @param color The color of the outline.
+ */
+void draw_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+    int16_t x = r, y = 0;
+    int16_t run = 0; //first y of the shallow run on row offset x
+    int32_t err = 0;
+#if OUTLINE_DIRECT
+    uint16_t *fb = get_frame_buffer();
+#else
+    uint16_t *fb = NULL;
+#endif
+
+    while (x >= y) {
+        outline_run(fb, x0 + x, x0 + x, y0 + y, color);
+        outline_run(fb, x0 - x, x0 - x, y0 + y, color);
+        outline_run(fb, x0 + x, x0 + x, y0 - y, color);
+        outline_run(fb, x0 - x, x0 - x, y0 - y, color);
+
+        int16_t px = x, py = y;
+        if (err <= 0) {
+            y++;
+            err += 2 * y + 1;
+        }
+        if (err > 0) {
+            x--;
+            err -= 2 * x + 1;
+        }
+        if (x != px || x < y) {
+            outline_run(fb, x0 + run, x0 + py, y0 + px, color);
+            outline_run(fb, x0 - py, x0 - run, y0 + px, color);
+            outline_run(fb, x0 + run, x0 + py, y0 - px, color);
+            outline_run(fb, x0 - py, x0 - run, y0 - px, color);
+            run = y;
+        }
+    }
+}
+
+/**
+ * @brief Draws a filled circle.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param r The radius of the circle.
+ * @param color The fill color.
+ */
+void fill_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+    int32_t limit = (int32_t)r * r + r;
+    int16_t x = r;
+
+    for (int32_t dy = 0; dy <= r; dy++) {
+        x = circle_step(x, dy, limit);
+        ring_rows(x0, y0, dy, 0, x, color);
+    }
+}
+
+/**
+ * @brief Draws the outline of an axis-aligned ellipse.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param rx The horizontal radius.
+ * @param ry The vertical radius.
+ * @param color The color of the outline.
+ */
+void draw_ellipse(int16_t x0, int16_t y0, uint16_t rx, uint16_t ry, uint16_t color) {
+    int64_t rx2 = (int64_t)rx * rx;
+    int64_t ry2 = (int64_t)ry * ry;
+    int64_t limit = rx2 * ry2 + (int64_t)rx * ry * (rx + ry) / 2;
+    int16_t x = ellipse_step(rx, 0, rx2, ry2, limit);
+
+    for (int32_t dy = 0; dy <= ry; dy++) {
+        int16_t next = (dy < ry) ? ellipse_step(x, dy + 1, rx2, ry2, limit) : -1;
+        int16_t lo = (next + 1 < x) ? next + 1 : x;
+        ring_rows(x0, y0, dy, lo, x, color);
+        x = next;
+    }
+}
+
+/**
+ * @brief Draws a filled axis-aligned ellipse.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param rx The horizontal radius.
+ * @param ry The vertical radius.
+ * @param color The fill color.
+ */
+void fill_ellipse(int16_t x0, int16_t y0, uint16_t rx, uint16_t ry, uint16_t color) {
+    int64_t rx2 = (int64_t)rx * rx;
+    int64_t ry2 = (int64_t)ry * ry;
+    int64_t limit = rx2 * ry2 + (int64_t)rx * ry * (rx + ry) / 2;
+    int16_t x = rx;
+
+    for (int32_t dy = 0; dy <= ry; dy++) {
+        x = ellipse_step(x, dy, rx2, ry2, limit);
+        ring_rows(x0, y0, dy, 0, x, color);
+    }
+}
+
+/**
+ * @brief Draws the outline of a triangle.
+ *
+ * @param x0 The x-coordinate of the first vertex.
+ * @param y0 The y-coordinate of the first vertex.
+ * @param x1 The x-coordinate of the second vertex.
+ * @param y1 The y-coordinate of the second vertex.
+ * @param x2 The x-coordinate of the third vertex.
+ * @param y2 The y-coordinate of the third vertex.
+ * @param color The color of the outline.
+ */
+void draw_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+    draw_line(x0, y0, x1, y1, color);
+    draw_line(x1, y1, x2, y2, color);
+    draw_line(x2, y2, x0, y0, color);
+}
+
+/**
+ * @brief Draws a filled triangle.
+ *
+ * The vertices are sorted by y and every row between the top and bottom
+ * vertex is filled between the long edge and the current short edge. Rows
+ * outside the screen are skipped before the scan starts.
+ *
+ * @param x0 The x-coordinate of the first vertex.
+ * @param y0 The y-coordinate of the first vertex.
+ * @param x1 The x-coordinate of the second vertex.
+ * @param y1 The y-coordinate of the second vertex.
+ * @param x2 The x-coordinate of the third vertex.
+ * @param y2 The y-coordinate of the third vertex.
+ * @param color The fill color.
+ */
+void fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+    int16_t t;
+    if (y0 > y1) { t = y0; y0 = y1; y1 = t; t = x0; x0 = x1; x1 = t; }
+    if (y1 > y2) { t = y1; y1 = y2; y2 = t; t = x1; x1 = x2; x2 = t; }
+    if (y0 > y1) { t = y0; y0 = y1; y1 = t; t = x0; x0 = x1; x1 = t; }
+
+    if (y0 == y2) {
+        int16_t a = x0, b = x0;
+        if (x1 < a) a = x1; else if (x1 > b) b = x1;
+        if (x2 < a) a = x2; else if (x2 > b) b = x2;
+        draw_hline(a, b, y0, color);
+        return;
+    }
+
+    int32_t dx01 = x1 - x0, dy01 = y1 - y0;
+    int32_t dx02 = x2 - x0, dy02 = y2 - y0;
+    int32_t dx12 = x2 - x1, dy12 = y2 - y1;
+    int32_t y_start = (y0 < 0) ? 0 : y0;
+    int32_t y_end = (y2 >= TFT_HEIGHT) ? TFT_HEIGHT - 1 : y2;
+
+    for (int32_t y = y_start; y <= y_end; y++) {
+        int32_t a = x0 + dx02 * (y - y0) / dy02;
+        int32_t b;
+        if (y < y1) {
+            b = x0 + dx01 * (y - y0) / dy01;
+        } else if (dy12) {
+            b = x1 + dx12 * (y - y1) / dy12;
+        } else {
+            b = x1;
+        }
+        draw_hline(a, b, y, color);
+    }
+}
+
+/**
+ * @brief Draws the outline of a rectangle with rounded corners.
+ *
+ * @param x The x-coordinate of the top-left corner.
+ * @param y The y-coordinate of the top-left corner.
+ * @param w The width of the rectangle.
+ * @param h The height of the rectangle.
+ * @param r The corner radius. It is limited to half of the shorter side.
+ * @param color The color of the outline.
+ */
+void draw_round_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color) {
+    if (w == 0 || h == 0) return;
+    if (r > w / 2) r = w / 2;
+    if (r > h / 2) r = h / 2;
+
+    int16_t x1 = x + w - 1;
+    int16_t y1 = y + h - 1;
+
+    draw_hline(x + r, x1 - r, y, color);
+    draw_hline(x + r, x1 - r, y1, color);
+
+    int32_t side_start = (y + r < 0) ? 0 : y + r;
+    int32_t side_end = (y1 - r >= TFT_HEIGHT) ? TFT_HEIGHT - 1 : y1 - r;
+    for (int32_t row = side_start; row <= side_end; row++) {
+        draw_hline(x, x, row, color);
+        draw_hline(x1, x1, row, color);
+    }
+
+    int32_t limit = (int32_t)r * r + r;
+    int16_t cx = circle_step(r, 1, limit);
+    for (int32_t dy = 1; dy <= r; dy++) {
+        int16_t next = (dy < r) ? circle_step(cx, dy + 1, limit) : -1;
+        int16_t lo = (next + 1 < cx) ? next + 1 : cx;
+        draw_hline(x + r - cx, x + r - lo, y + r - dy, color);
+        draw_hline(x1 - r + lo, x1 - r + cx, y + r - dy, color);
+        draw_hline(x + r - cx, x + r - lo, y1 - r + dy, color);
+        draw_hline(x1 - r + lo, x1 - r + cx, y1 - r + dy, color);
+        cx = next;
+    }
+}
+
+/**
+ * @brief Draws a filled rectangle with rounded corners.
+ *
+ * @param x The x-coordinate of the top-left corner.
+ * @param y The y-coordinate of the top-left corner.
+ * @param w The width of the rectangle.
+ * @param h The height of the rectangle.
+ * @param r The corner radius. It is limited to half of the shorter side.
+ * @param color The fill color.
+ */
+void fill_round_rect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, uint16_t color) {
+    if (w == 0 || h == 0) return;
+    if (r > w / 2) r = w / 2;
+    if (r > h / 2) r = h / 2;
+
+    int16_t x1 = x + w - 1;
+    int16_t y1 = y + h - 1;
+
+    int32_t band_start = (y + r < 0) ? 0 : y + r;
+    int32_t band_end = (y1 - r >= TFT_HEIGHT) ? TFT_HEIGHT - 1 : y1 - r;
+    for (int32_t row = band_start; row <= band_end; row++) {
+        draw_hline(x, x1, row, color);
+    }
+
+    int32_t limit = (int32_t)r * r + r;
+    int16_t cx = r;
+    for (int32_t dy = 1; dy <= r; dy++) {
+        cx = circle_step(cx, dy, limit);
+        draw_hline(x + r - cx, x1 - r + cx, y + r - dy, color);
+        draw_hline(x + r - cx, x1 - r + cx, y1 - r + dy, color);
+    }
+}
+
+
+static inline int32_t floor_div(int32_t a, int32_t b) {
+    int32_t q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+    return q;
+}
+
+static inline int32_t ceil_div(int32_t a, int32_t b) {
+    int32_t q = a / b;
+    if ((a % b != 0) && ((a < 0) == (b < 0))) q++;
+    return q;
+}
+
+/**
+ * @brief Builds the cone of an arc piece of at most 180 degrees.
+ */
+static void arc_cone(arc_cone_t *cone, int32_t start_deg, int32_t end_deg) {
+    cone->sx = fx_cos(FX_ANGLE_FROM_DEG(start_deg));
+    cone->sy = fx_sin(FX_ANGLE_FROM_DEG(start_deg));
+    cone->ex = fx_cos(FX_ANGLE_FROM_DEG(end_deg));
+    cone->ey = fx_sin(FX_ANGLE_FROM_DEG(end_deg));
+}
+
+/**
+ * @brief Narrows [lo, hi] to the x offsets of row py that lie inside a cone.
+ *
+ * A point p is inside the cone when cross(start, p) >= 0 and
+ * cross(p, end) >= 0. For a fixed row both conditions are linear in x, so
+ * each one turns into a single bound on the span.
+ *
+ * @return false if the row does not intersect the cone at all.
+ */
+static bool arc_cone_bounds(const arc_cone_t *c, int32_t py, int32_t *lo, int32_t *hi) {
+    if (c->sy > 0) {
+        int32_t b = floor_div(c->sx * py, c->sy);
+        if (b < *hi) *hi = b;
+    } else if (c->sy < 0) {
+        int32_t b = ceil_div(c->sx * py, c->sy);
+        if (b > *lo) *lo = b;
+    } else if (c->sx * py < 0) {
+        return false;
+    }
+
+    if (c->ey > 0) {
+        int32_t b = ceil_div(c->ex * py, c->ey);
+        if (b > *lo) *lo = b;
+    } else if (c->ey < 0) {
+        int32_t b = floor_div(c->ex * py, c->ey);
+        if (b < *hi) *hi = b;
+    } else if (c->ex * py > 0) {
+        return false;
+    }
+    return *lo <= *hi;
+}
+
+/**
+ * @brief Draws one row of an annular sector.
+ *
+ * The ring contributes up to two spans ([-wo, -wi-1] and [wi+1, wo]) and each
+ * cone clips them to a single x range, so a row never costs more than a few
+ * spans regardless of the radius.
+ */
+static void arc_row(int16_t x0, int16_t y0, int32_t py, int16_t wo, int16_t wi,
+                    const arc_cone_t *cones, uint8_t cone_count, uint16_t color) {
+    int32_t seg_lo[2], seg_hi[2];
+    uint8_t segs;
+
+    if (wo < 0) return;
+    if (wi < 0) {
+        seg_lo[0] = -wo; seg_hi[0] = wo;
+        segs = 1;
+    } else {
+        seg_lo[0] = -wo; seg_hi[0] = -wi - 1;
+        seg_lo[1] = wi + 1; seg_hi[1] = wo;
+        segs = 2;
+    }
+
+    for (uint8_t c = 0; c < (cone_count ? cone_count : 1); c++) {
+        int32_t lo = -wo, hi = wo;
+        if (cone_count && !arc_cone_bounds(&cones[c], py, &lo, &hi)) continue;
+
+        for (uint8_t s = 0; s < segs; s++) {
+            int32_t a = (seg_lo[s] > lo) ? seg_lo[s] : lo;
+            int32_t b = (seg_hi[s] < hi) ? seg_hi[s] : hi;
+            if (a <= b) draw_hline(x0 + a, x0 + b, y0 + py, color);
+        }
+    }
+}
+
+/**
+ * @brief Draws a filled arc (annular sector).
+ *
+ * The arc is split into pieces of at most 180 degrees so every piece is a
+ * convex cone, and each row of the ring is clipped against those cones as
+ * whole spans. Angles are in degrees, 0 points right and angles grow
+ * clockwise on screen. A sweep of ARC_FULL_CIRCLE or more draws the full ring.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param r_outer The outer radius.
+ * @param r_inner The inner radius. 0 draws a pie slice.
+ * @param start_deg The start angle.
+ * @param end_deg The end angle.
+ * @param color The fill color.
+ */
+void fill_arc(int16_t x0, int16_t y0, uint16_t r_outer, uint16_t r_inner, int16_t start_deg, int16_t end_deg, uint16_t color) {
+    arc_cone_t cones[2];
+    uint8_t cone_count = 0;
+    int32_t sweep = (int32_t)end_deg - start_deg;
+
+    if (r_inner > r_outer) return;
+    if (sweep > -ARC_FULL_CIRCLE && sweep < ARC_FULL_CIRCLE) {
+        sweep = ((sweep % ARC_FULL_CIRCLE) + ARC_FULL_CIRCLE) % ARC_FULL_CIRCLE;
+        if (sweep == 0) return;
+
+        int32_t angle = start_deg;
+        while (sweep > 0) {
+            int32_t piece = (sweep > 180) ? 180 : sweep;
+            arc_cone(&cones[cone_count++], angle, angle + piece);
+            angle += piece;
+            sweep -= piece;
+        }
+    }
+
+    int32_t outer_limit = (int32_t)r_outer * r_outer + r_outer;
+    int32_t inner_limit = (int32_t)r_inner * r_inner + r_inner;
+    int16_t wo = r_outer;
+    int16_t wi = r_inner ? r_inner : -1;
+
+    for (int32_t dy = 0; dy <= r_outer; dy++) {
+        wo = circle_step(wo, dy, outer_limit);
+        if (wi >= 0) wi = circle_step(wi, dy, inner_limit);
+        arc_row(x0, y0, dy, wo, wi, cones, cone_count, color);
+        if (dy) arc_row(x0, y0, -dy, wo, wi, cones, cone_count, color);
+    }
+}
+
+/**
+ * @brief Draws a one pixel wide arc.
+ *
+ * @param x0 The x-coordinate of the center.
+ * @param y0 The y-coordinate of the center.
+ * @param r The radius of the arc.
+ * @param start_deg The start angle.
+ * @param end_deg The end angle.
+ * @param color The color of the arc.
+ */
+void draw_arc(int16_t x0, int16_t y0, uint16_t r, int16_t start_deg, int16_t end_deg, uint16_t color) {
+    fill_arc(x0, y0, r, r ? r - 1 : 0, start_deg, end_deg, color);
+}
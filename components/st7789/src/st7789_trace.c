@@ -0,0 +1,125 @@
+#include "st7789_trace.h"
+
+#if ST7789_TRACE
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+static trace_record_t ring[TRACE_RECORDS];
+static uint32_t head; //next slot to write
+static uint32_t stored; //valid records, at most TRACE_RECORDS
+static uint32_t overwritten; //records lost to wraparound since trace_clear
+static bool recording;
+static uint32_t begin_cycles; //set by trace_begin, one transaction is traced at a time
+
+
+/**
+ * @brief Clears the ring and starts recording.
+ */
+void trace_start(void) {
+    trace_clear();
+    recording = true;
+}
+
+/**
+ * @brief Stops recording, the ring keeps its records until the next start or clear.
+ */
+void trace_stop(void) {
+    recording = false;
+}
+
+/**
+ * @brief Drops every record.
+ */
+void trace_clear(void) {
+    head = 0;
+    stored = 0;
+    overwritten = 0;
+}
+
+/**
+ * @brief Marks the start of the transaction that the next trace_end records.
+ */
+void trace_begin(void) {
+    begin_cycles = esp_cpu_get_cycle_count();
+}
+
+/**
+ * @brief Records a transaction that started at the last trace_begin.
+ *
+ * Frame markers do not need a trace_begin, their duration is 0. Once the
+ * ring is full the oldest record is overwritten.
+ *
+ * @param kind What the transport was asked to do.
+ * @param dc D/C level of the transaction.
+ * @param data The bytes sent, NULL for waits and markers.
+ * @param size Number of bytes sent.
+ */
+void trace_end(trace_kind_t kind, uint8_t dc, const void *data, size_t size) {
+    if (!recording) return;
+
+    uint32_t now = esp_cpu_get_cycle_count();
+    trace_record_t *r = &ring[head];
+    r->start = (kind == TRACE_FRAME) ? now : begin_cycles;
+    r->cycles = (kind == TRACE_FRAME) ? 0 : now - begin_cycles;
+    r->length = (size > 0xFFFF) ? 0xFFFF : size;
+    r->kind = kind;
+    r->dc = dc;
+    size_t n = data ? ((size < TRACE_HEAD_BYTES) ? size : TRACE_HEAD_BYTES) : 0;
+    memset(r->head, 0, TRACE_HEAD_BYTES);
+    if (n) memcpy(r->head, data, n);
+
+    head = (head + 1) % TRACE_RECORDS;
+    if (stored < TRACE_RECORDS) stored++;
+    else overwritten++;
+}
+
+/**
+ * @brief Returns the number of records in the ring.
+ */
+uint32_t trace_count(void) {
+    return stored;
+}
+
+/**
+ * @brief Returns the number of records lost because the ring wrapped.
+ */
+uint32_t trace_overwritten(void) {
+    return overwritten;
+}
+
+/**
+ * @brief Returns a record, 0 being the oldest, NULL if the index is out of range.
+ */
+const trace_record_t *trace_get(uint32_t index) {
+    if (index >= stored) return NULL;
+    return &ring[(head + TRACE_RECORDS - stored + index) % TRACE_RECORDS];
+}
+
+/**
+ * @brief Prints the ring on the console, oldest record first.
+ *
+ * Recording is paused while printing so the dump does not trace itself. The
+ * format is one header line, one line per record and an end line:
+ *   #TRACE cycles_per_us=240 records=N overwritten=M
+ *   T <start> <cycles> <kind> <dc> <length> <head bytes in hex>
+ *   #END
+ * Lines from the log in between are ignored by tools/trace.py.
+ */
+void trace_dump(void) {
+    bool was_recording = recording;
+    recording = false;
+
+    printf("#TRACE cycles_per_us=%lu records=%lu overwritten=%lu\n", (unsigned long)esp_rom_get_cpu_ticks_per_us(),
+           (unsigned long)stored, (unsigned long)overwritten);
+    for (uint32_t i = 0; i < stored; i++) {
+        const trace_record_t *r = trace_get(i);
+        printf("T %lu %lu %u %u %u %02x%02x%02x%02x\n", (unsigned long)r->start, (unsigned long)r->cycles,
+               r->kind, r->dc, r->length, r->head[0], r->head[1], r->head[2], r->head[3]);
+        if (i % 64 == 63) vTaskDelay(1); //let the UART drain and the watchdog run
+    }
+    printf("#END\n");
+
+    recording = was_recording;
+}
+
+#endif
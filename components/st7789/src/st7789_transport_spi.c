@@ -0,0 +1,207 @@
+#include "st7789.h"
+#include "st7789_transport.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "driver/ledc.h"
+
+#define SPI_QUEUE_SIZE 9 //device queue_size, also the writes spi_queue keeps in flight
+
+spi_device_handle_t spi;
+static spi_transaction_t queue_trans[SPI_QUEUE_SIZE];
+static uint8_t queue_next = 0;
+static uint8_t queue_pending = 0;
+
+
+/**
+ * @brief Initialize GPIO pins for the TFT display.
+ *
+ * This function configures the GPIO pins used for the TFT display's
+ * Data/Command (TFT_DC), Reset (TFT_RST), and Backlight (TFT_BL) signals.
+ * The pins are set to output mode with no pull-up or pull-down resistors,
+ * and interrupts are disabled.
+ *
+ * The specific pins used are defined by the macros TFT_DC, TFT_RST, and TFT_BL.
+ */
+static void gpio_init(void) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << TFT_DC) | (1ULL << TFT_RST) | (1ULL << TFT_BL),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_config(&io_conf);
+}
+
+/**
+ * @brief Initializes the SPI bus and adds the SPI device.
+ *
+ * This function configures the SPI bus with the specified settings and adds the SPI device to the bus.
+ * It sets up the MOSI, SCLK, and other necessary pins, as well as the maximum transfer size.
+ * The SPI device is configured with a clock speed of 80 MHz, mode 0, and other relevant settings.
+ *
+ * @note This function uses the ESP-IDF SPI driver and checks for errors during initialization.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void spi_init(void) {
+    spi_bus_config_t buscfg = {
+        .mosi_io_num = TFT_MOSI,
+        .sclk_io_num = TFT_SCLK,
+        .miso_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = TFT_HEIGHT * TFT_WIDTH * 2 
+    };
+
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = 80 * 1000 * 1000, 
+        .mode = 0,
+        .spics_io_num = TFT_CS,
+        .queue_size = SPI_QUEUE_SIZE,
+        .flags = SPI_DEVICE_NO_DUMMY
+    };
+
+    ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_CH_AUTO));
+    ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &devcfg, &spi));
+}
+
+/**
+ * @brief Sets up the SPI bus and the control pins.
+ */
+static void spi_transport_init(void) {
+    spi_init();
+    gpio_init();
+}
+
+/**
+ * @brief Drives the data/command pin.
+ */
+static void spi_set_dc(uint32_t level) {
+    gpio_set_level(TFT_DC, level);
+}
+
+/**
+ * @brief Drives the reset pin.
+ */
+static void spi_set_reset(uint32_t level) {
+    gpio_set_level(TFT_RST, level);
+}
+
+/**
+ * @brief Waits for the oldest queued write.
+ */
+static void spi_wait(void) {
+    spi_transaction_t *done;
+    if (queue_pending == 0) return;
+    ESP_ERROR_CHECK(spi_device_get_trans_result(spi, &done, portMAX_DELAY));
+    queue_pending--;
+}
+
+/**
+ * @brief Sends a buffer with a polling transaction.
+ *
+ * Queued writes are finished first, since a polling transaction cannot
+ * start while interrupt transactions are pending.
+ *
+ * @param data The bytes to send.
+ * @param size Number of bytes.
+ */
+static void spi_write(const void *data, size_t size) {
+    while (queue_pending) spi_wait();
+
+    spi_transaction_t SPIT;
+    memset(&SPIT, 0, sizeof(spi_transaction_t));
+    SPIT.length = size * 8;
+    SPIT.tx_buffer = data;
+    ESP_ERROR_CHECK(spi_device_polling_transmit(spi, &SPIT));
+}
+
+/**
+ * @brief Queues a DMA transaction and returns without waiting for it.
+ *
+ * When SPI_QUEUE_SIZE writes are already in flight the oldest one is waited
+ * for first.
+ *
+ * @param data The bytes to send, in DMA capable memory, valid until waited for.
+ * @param size Number of bytes.
+ */
+static void spi_queue(const void *data, size_t size) {
+    if (queue_pending == SPI_QUEUE_SIZE) spi_wait();
+
+    spi_transaction_t *t = &queue_trans[queue_next];
+    queue_next = (queue_next + 1) % SPI_QUEUE_SIZE;
+    memset(t, 0, sizeof(spi_transaction_t));
+    t->length = size * 8;
+    t->tx_buffer = data;
+    ESP_ERROR_CHECK(spi_device_queue_trans(spi, t, portMAX_DELAY));
+    queue_pending++;
+}
+
+/**
+ * @brief Configures and sets the backlight duty cycle.
+ *
+ * This function initializes the LEDC timer and channel configurations 
+ * and sets the duty cycle for the backlight. It uses the LEDC (LED 
+ * Controller) peripheral to control the brightness of the backlight.
+ *
+ * @param duty The duty cycle to set for the backlight. This value 
+ *             determines the brightness of the backlight.
+ *
+ * @note The function assumes that the following macros are defined:
+ *       - SPEED_MODE: The speed mode of the LEDC timer.
+ *       - TIMER_NUM: The timer number to use for the LEDC timer.
+ *       - DUTY_RESOLUTION: The resolution of the duty cycle.
+ *       - FREQUENCY_TIMER: The frequency of the LEDC timer.
+ *       - CLK_CFG: The clock configuration for the LEDC timer.
+ *       - LEDC_CHANNEL: The LEDC channel to configure.
+ *       - GPIO_NUM: The GPIO number to use for the LEDC channel.
+ *       - LEDC_HIGH_SPEED_MODE: The high-speed mode for the LEDC.
+ */
+
+static void spi_backlight(uint8_t duty) {
+
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode = SPEED_MODE,
+        .timer_num = TIMER_NUM,
+        .duty_resolution = DUTY_RESOLUTION,
+        .freq_hz = FREQUENCY_TIMER,
+        .clk_cfg = CLK_CFG,
+    };
+
+    ledc_timer_config(&ledc_timer);
+
+    ledc_channel_config_t ledc_channel = {
+        .speed_mode = SPEED_MODE,
+        .channel = LEDC_CHANNEL,
+        .gpio_num = GPIO_NUM,
+        .timer_sel = TIMER_NUM,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    ledc_channel_config(&ledc_channel);
+
+    ledc_set_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL, duty);
+    ledc_update_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL);
+
+}
+
+static const st7789_transport_t spi_transport = {
+    .init = spi_transport_init,
+    .set_dc = spi_set_dc,
+    .set_reset = spi_set_reset,
+    .write = spi_write,
+    .queue = spi_queue,
+    .wait = spi_wait,
+    .backlight = spi_backlight,
+};
+
+/**
+ * @brief Returns the transport the driver uses unless another one is set:
+ *        the ESP32 SPI master and GPIO pins.
+ */
+const st7789_transport_t *st7789_default_transport(void) {
+    return &spi_transport;
+}
@@ -0,0 +1,413 @@
+#include "st7789_ui.h"
+#include "st7789_shapes.h"
+#include "st7789_region.h"
+
+static const char *TAG = "ui";
+
+typedef enum {
+    UI_LABEL,
+    UI_NUMBER,
+    UI_BAR,
+    UI_GAUGE,
+    UI_ICON
+} ui_kind_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t scale; //text
+    uint8_t columns; //text
+    uint8_t decimals; //readouts
+    region_rect_t bounds;
+    region_rect_t dirty;
+    bool is_dirty;
+    uint16_t color;
+    uint16_t background;
+    uint16_t track; //gauges, the unfilled part of the arc
+    int16_t cx, cy; //gauges, the bounds are clipped to the screen but the center is not
+    uint16_t r, thickness; //gauges
+    int32_t min, max;
+    int32_t value;
+    uint16_t shown; //what the value looks like on screen: bar fill in pixels, gauge angle in degrees
+    char text[UI_TEXT_MAX + 1]; //padded with spaces to columns
+    const void *sprite; //icons
+} ui_widget_t;
+
+static ui_widget_t widgets[UI_MAX_WIDGETS];
+static uint16_t widget_count;
+static uint16_t screen_background;
+static uint8_t *ui_font;
+static bool full_redraw;
+
+
+/**
+ * @brief Adds a rectangle, in screen coordinates, to the part of a widget to flush.
+ */
+static void widget_invalidate(ui_widget_t *w, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    region_rect_t r = {x0, y0, x1, y1};
+    w->dirty = w->is_dirty ? region_union(&w->dirty, &r) : r;
+    w->is_dirty = true;
+}
+
+static ui_widget_t *widget_new(ui_kind_t kind, int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    if (widget_count == UI_MAX_WIDGETS) {
+        ESP_LOGW(TAG, "no room for more than %d widgets", UI_MAX_WIDGETS);
+        return NULL;
+    }
+    ui_widget_t *w = &widgets[widget_count++];
+    memset(w, 0, sizeof(*w));
+    w->kind = kind;
+    w->bounds = (region_rect_t){(x0 > 0) ? x0 : 0, (y0 > 0) ? y0 : 0, x1, y1};
+    widget_invalidate(w, w->bounds.x0, w->bounds.y0, x1, y1);
+    return w;
+}
+
+static ui_widget_t *widget_get(ui_handle_t handle) {
+    if (handle < 0 || handle >= widget_count) return NULL;
+    return &widgets[handle];
+}
+
+/**
+ * @brief Removes every widget and makes the next update redraw the whole screen.
+ *
+ * @param background The color of the screen outside the widgets.
+ * @param font The font of the labels and readouts.
+ */
+void ui_init(uint16_t background, uint8_t *font) {
+    widget_count = 0;
+    screen_background = background;
+    ui_font = font;
+    full_redraw = true;
+}
+
+/**
+ * @brief Replaces the text of a label or readout, invalidating the cells that differ.
+ *
+ * The text is cut or padded with spaces to the widget columns.
+ */
+static void widget_text(ui_widget_t *w, const char *text) {
+    char padded[UI_TEXT_MAX + 1];
+    uint8_t n = 0;
+    while (n < w->columns && text[n]) {
+        padded[n] = text[n];
+        n++;
+    }
+    memset(&padded[n], ' ', w->columns - n);
+    padded[w->columns] = '\0';
+
+    int16_t first = -1, last = -1;
+    for (uint8_t i = 0; i < w->columns; i++) {
+        if (padded[i] != w->text[i]) {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first < 0) return;
+
+    memcpy(w->text, padded, sizeof(padded));
+    uint16_t cell = FONT_WIDTH * w->scale;
+    widget_invalidate(w, w->bounds.x0 + first * cell, w->bounds.y0,
+                      w->bounds.x0 + (last + 1) * cell - 1, w->bounds.y1);
+}
+
+static ui_widget_t *text_widget_new(ui_kind_t kind, uint16_t x, uint16_t y, uint8_t columns, uint8_t scale,
+                                    uint16_t color, uint16_t background) {
+    if (columns > UI_TEXT_MAX) columns = UI_TEXT_MAX;
+    if (scale == 0) scale = 1;
+    ui_widget_t *w = widget_new(kind, x, y, x + columns * FONT_WIDTH * scale - 1, y + FONT_HEIGHT * scale - 1);
+    if (w == NULL) return NULL;
+    w->columns = columns;
+    w->scale = scale;
+    w->color = color;
+    w->background = background;
+    memset(w->text, ' ', columns);
+    w->text[columns] = '\0';
+    return w;
+}
+
+/**
+ * @brief Creates a single line text label.
+ *
+ * @param x The x-coordinate of the top-left corner.
+ * @param y The y-coordinate of the top-left corner.
+ * @param columns Width in characters, at most UI_TEXT_MAX.
+ * @param scale The text scale.
+ * @param color The text color.
+ * @param background The color behind the text.
+ * @param text The initial text.
+ * @return The handle of the label, -1 if there is no room left.
+ */
+ui_handle_t ui_label(uint16_t x, uint16_t y, uint8_t columns, uint8_t scale, uint16_t color, uint16_t background,
+                     const char *text) {
+    ui_widget_t *w = text_widget_new(UI_LABEL, x, y, columns, scale, color, background);
+    if (w == NULL) return -1;
+    widget_text(w, text);
+    return w - widgets;
+}
+
+/**
+ * @brief Creates a right-aligned numeric readout showing 0.
+ *
+ * Values are fixed point with the given number of decimals: 1234 with two
+ * decimals reads 12.34. A value that does not fit is shown as #.
+ *
+ * @param columns Width in characters, sign and point included.
+ * @return The handle of the readout, -1 if there is no room left.
+ */
+ui_handle_t ui_number(uint16_t x, uint16_t y, uint8_t columns, uint8_t decimals, uint8_t scale, uint16_t color,
+                      uint16_t background) {
+    ui_widget_t *w = text_widget_new(UI_NUMBER, x, y, columns, scale, color, background);
+    if (w == NULL) return -1;
+    w->decimals = decimals;
+    w->value = 1; //anything but the value set below, so the readout gets its text
+    ui_set_value(w - widgets, 0);
+    return w - widgets;
+}
+
+/**
+ * @brief Creates a horizontal progress bar filling from the left.
+ *
+ * @param min The value of an empty bar.
+ * @param max The value of a full bar.
+ * @param color The filled part.
+ * @param background The empty part.
+ * @return The handle of the bar, -1 if there is no room left.
+ */
+ui_handle_t ui_bar(uint16_t x, uint16_t y, uint16_t width, uint16_t height, int32_t min, int32_t max, uint16_t color,
+                   uint16_t background) {
+    ui_widget_t *w = widget_new(UI_BAR, x, y, x + width - 1, y + height - 1);
+    if (w == NULL) return -1;
+    w->min = min;
+    w->max = (max > min) ? max : min + 1;
+    w->value = min;
+    w->color = color;
+    w->background = background;
+    return w - widgets;
+}
+
+/**
+ * @brief Creates an arc gauge sweeping UI_GAUGE_SWEEP degrees clockwise from UI_GAUGE_START.
+ *
+ * @param cx The x-coordinate of the center.
+ * @param cy The y-coordinate of the center.
+ * @param r The outer radius.
+ * @param thickness Width of the arc.
+ * @param color The part of the arc up to the value.
+ * @param track The rest of the arc.
+ * @param background The square around the arc.
+ * @return The handle of the gauge, -1 if there is no room left.
+ */
+ui_handle_t ui_gauge(uint16_t cx, uint16_t cy, uint16_t r, uint16_t thickness, int32_t min, int32_t max,
+                     uint16_t color, uint16_t track, uint16_t background) {
+    ui_widget_t *w = widget_new(UI_GAUGE, cx - r, cy - r, cx + r, cy + r);
+    if (w == NULL) return -1;
+    w->cx = cx;
+    w->cy = cy;
+    w->r = r;
+    w->thickness = (thickness < r) ? thickness : r;
+    w->min = min;
+    w->max = (max > min) ? max : min + 1;
+    w->value = min;
+    w->color = color;
+    w->track = track;
+    w->background = background;
+    return w - widgets;
+}
+
+#if FRAME_BUFFER_BPP == 16
+/**
+ * @brief Creates an icon from a sprite, drawn with draw_sprite.
+ *
+ * @param background The color behind transparent pixels.
+ * @return The handle of the icon, -1 if there is no room left.
+ */
+ui_handle_t ui_icon(uint16_t x, uint16_t y, const sprite_t *sprite, uint16_t background) {
+    ui_widget_t *w = widget_new(UI_ICON, x, y, x + sprite->width - 1, y + sprite->height - 1);
+    if (w == NULL) return -1;
+    w->sprite = sprite;
+    w->background = background;
+    return w - widgets;
+}
+
+/**
+ * @brief Replaces the sprite of an icon, which must have the same size.
+ */
+void ui_set_icon(ui_handle_t handle, const sprite_t *sprite) {
+    ui_widget_t *w = widget_get(handle);
+    if (w == NULL || w->kind != UI_ICON || w->sprite == sprite) return;
+    w->sprite = sprite;
+    ui_invalidate(handle);
+}
+#endif
+
+/**
+ * @brief Sets the text of a label.
+ */
+void ui_set_text(ui_handle_t handle, const char *text) {
+    ui_widget_t *w = widget_get(handle);
+    if (w == NULL || w->kind != UI_LABEL) return;
+    widget_text(w, text);
+}
+
+/**
+ * @brief Formats a fixed point value right-aligned in the readout columns.
+ */
+static void format_number(const ui_widget_t *w, int32_t value, char *out) {
+    char digits[32];
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    int places = (w->decimals < 9) ? w->decimals : 9;
+    if (places) {
+        uint32_t unit = 1;
+        for (int i = 0; i < places; i++) unit *= 10;
+        snprintf(digits, sizeof(digits), "%s%lu.%0*lu", (value < 0) ? "-" : "", (unsigned long)(magnitude / unit),
+                 places, (unsigned long)(magnitude % unit));
+    } else {
+        snprintf(digits, sizeof(digits), "%ld", (long)value);
+    }
+
+    size_t length = strlen(digits);
+    if (length > w->columns) {
+        memset(out, '#', w->columns);
+    } else {
+        memset(out, ' ', w->columns - length);
+        memcpy(&out[w->columns - length], digits, length);
+    }
+    out[w->columns] = '\0';
+}
+
+/**
+ * @brief Returns how far a value fills a range, scaled to 0..size.
+ */
+static uint16_t value_scaled(const ui_widget_t *w, int32_t value, uint16_t size) {
+    if (value <= w->min) return 0;
+    if (value >= w->max) return size;
+    return (uint16_t)(((int64_t)(value - w->min) * size) / (w->max - w->min));
+}
+
+/**
+ * @brief Sets the value of a readout, bar or gauge.
+ *
+ * Nothing is invalidated unless the widget would look different.
+ */
+void ui_set_value(ui_handle_t handle, int32_t value) {
+    ui_widget_t *w = widget_get(handle);
+    if (w == NULL || w->value == value) return;
+    w->value = value;
+
+    if (w->kind == UI_NUMBER) {
+        char text[UI_TEXT_MAX + 1];
+        format_number(w, value, text);
+        widget_text(w, text);
+    } else if (w->kind == UI_BAR) {
+        uint16_t fill = value_scaled(w, value, w->bounds.x1 - w->bounds.x0 + 1);
+        if (fill == w->shown) return;
+        uint16_t lo = (fill < w->shown) ? fill : w->shown;
+        uint16_t hi = (fill < w->shown) ? w->shown : fill;
+        widget_invalidate(w, w->bounds.x0 + lo, w->bounds.y0, w->bounds.x0 + hi - 1, w->bounds.y1);
+        w->shown = fill;
+    } else if (w->kind == UI_GAUGE) {
+        uint16_t angle = value_scaled(w, value, UI_GAUGE_SWEEP);
+        if (angle == w->shown) return;
+        w->shown = angle;
+        ui_invalidate(handle);
+    }
+}
+
+/**
+ * @brief Sets the main color of a widget: text, bar or gauge fill.
+ */
+void ui_set_color(ui_handle_t handle, uint16_t color) {
+    ui_widget_t *w = widget_get(handle);
+    if (w == NULL || w->color == color) return;
+    w->color = color;
+    ui_invalidate(handle);
+}
+
+/**
+ * @brief Makes the next update redraw and flush the whole widget.
+ */
+void ui_invalidate(ui_handle_t handle) {
+    ui_widget_t *w = widget_get(handle);
+    if (w == NULL) return;
+    widget_invalidate(w, w->bounds.x0, w->bounds.y0, w->bounds.x1, w->bounds.y1);
+}
+
+/**
+ * @brief Draws a widget over its whole bounds in the frame buffer.
+ */
+static void widget_draw(const ui_widget_t *w) {
+    const region_rect_t *b = &w->bounds;
+    switch (w->kind) {
+        case UI_LABEL:
+        case UI_NUMBER:
+            draw_rectangle(b->x0, b->y0, b->x1, b->y1, w->background);
+            if (ui_font) draw_text_scaled(b->x0, b->y0, w->text, w->color, w->scale, ui_font);
+            break;
+        case UI_BAR:
+            if (w->shown) draw_rectangle(b->x0, b->y0, b->x0 + w->shown - 1, b->y1, w->color);
+            if (b->x0 + w->shown <= b->x1) draw_rectangle(b->x0 + w->shown, b->y0, b->x1, b->y1, w->background);
+            break;
+        case UI_GAUGE: {
+            uint16_t inner = w->r - w->thickness;
+            draw_rectangle(b->x0, b->y0, b->x1, b->y1, w->background);
+            fill_arc(w->cx, w->cy, w->r, inner, UI_GAUGE_START + w->shown, UI_GAUGE_START + UI_GAUGE_SWEEP, w->track);
+            fill_arc(w->cx, w->cy, w->r, inner, UI_GAUGE_START, UI_GAUGE_START + w->shown, w->color);
+            break;
+        }
+        case UI_ICON:
+#if FRAME_BUFFER_BPP == 16
+            draw_rectangle(b->x0, b->y0, b->x1, b->y1, w->background);
+            draw_sprite(w->sprite, b->x0, b->y0);
+#endif
+            break;
+    }
+}
+
+/**
+ * @brief Redraws the invalidated widgets and flushes the rectangles that changed.
+ *
+ * A widget drawn again covers whatever was under it, so every widget created
+ * after a redrawn one and overlapping it is redrawn too. The first update
+ * after ui_init draws everything and flushes the whole frame buffer.
+ *
+ * @return The number of rectangles flushed, 0 when nothing changed.
+ */
+uint16_t ui_update(void) {
+    if (full_redraw) {
+        clear_frame_buffer(screen_background);
+        for (uint16_t i = 0; i < widget_count; i++) {
+            widget_draw(&widgets[i]);
+            widgets[i].is_dirty = false;
+        }
+        flush_frame_buffer();
+        full_redraw = false;
+        return 1;
+    }
+
+    region_list_t regions;
+    bool redraw[UI_MAX_WIDGETS] = {false};
+
+    region_clear(&regions);
+    for (uint16_t i = 0; i < widget_count; i++) {
+        ui_widget_t *w = &widgets[i];
+        if (w->is_dirty) {
+            region_add(&regions, w->dirty.x0, w->dirty.y0, w->dirty.x1, w->dirty.y1);
+            redraw[i] = true;
+            w->is_dirty = false;
+        }
+        if (!redraw[i]) continue;
+        for (uint16_t j = i + 1; j < widget_count; j++) {
+            if (region_overlap(&w->bounds, &widgets[j].bounds)) redraw[j] = true;
+        }
+    }
+    if (regions.count == 0) return 0;
+
+    for (uint16_t i = 0; i < widget_count; i++) {
+        if (redraw[i]) widget_draw(&widgets[i]);
+    }
+    region_merge(&regions);
+    for (uint16_t i = 0; i < regions.count; i++) {
+        const region_rect_t *r = &regions.rects[i];
+        flush_frame_buffer_rect(r->x0, r->y0, r->x1, r->y1);
+    }
+    return regions.count;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+#define DMA_ATTR
+#define IRAM_ATTR
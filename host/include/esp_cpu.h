@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+//The host "cycle counter" counts nanoseconds, see esp_rom_get_cpu_ticks_per_us.
+uint32_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,2 @@
+#pragma once
+//Files are read straight from the host file system, there is no SPIFFS to mount.
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+//Host stand-in for the FreeRTOS types and macros the st7789 component uses.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdTRUE 1
+#define pdFALSE 0
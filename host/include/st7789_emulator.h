@@ -0,0 +1,41 @@
+#pragma once
+#include "st7789.h"
+#include "st7789_transport.h"
+
+//Host ST7789 panel emulator. It is the default transport of the host build:
+//the command stream is decoded into a virtual GRAM that can be read back or
+//dumped as PPM, and every command, transaction and byte is counted.
+
+#define EMU_GRAM_WIDTH 240
+#define EMU_GRAM_HEIGHT 320
+#define EMU_PANEL_INVERTED 1 //the TTGO IPS panel shows true colors with INVON
+#define EMU_SPI_HZ (80 * 1000 * 1000) //clock_speed_hz of the SPI transport
+
+#define RAMWRC 0x3C
+#define VSCRDEF 0x33
+#define VSCSAD 0x37
+
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+#define MADCTL_BGR 0x08
+
+typedef struct {
+    uint32_t commands;
+    uint32_t transactions;
+    uint32_t bytes; //command and parameter/pixel bytes
+    uint32_t pixels; //pixels stored in GRAM
+    uint32_t windows; //CASET and RASET commands
+    uint32_t ram_writes; //RAMWR and RAMWRC commands
+    uint32_t unknown; //commands the emulator does not decode
+} emu_counters_t;
+
+void emu_power_on(void);
+void emu_set_viewport(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+void emu_take_counters(emu_counters_t *out);
+void emu_get_totals(emu_counters_t *out);
+uint32_t emu_wire_us(const emu_counters_t *counters);
+uint16_t emu_get_pixel(uint16_t x, uint16_t y);
+uint16_t emu_get_gram(uint16_t x, uint16_t y);
+uint8_t emu_get_backlight(void);
+bool emu_write_ppm(const char *path, bool full_gram);
@@ -0,0 +1,601 @@
+#include "st7789.h"
+#include "st7789_indexed.h"
+#include "st7789_fxmath.h"
+#include "st7789_transport.h"
+#include "bench_cases.h"
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+//Host microbenchmarks of the drawing and flush kernels. Every case is timed
+//over BENCH_SAMPLES samples of a calibrated number of calls and reported as
+//ns/op (median, mean, min, standard deviation) and pixels per second, in CSV
+//or JSON; the particle cases count particles instead, and cases that write
+//no pixels leave the column empty. The SPI transport is replaced by a sink that only counts bytes, so
+//the flush cases measure the CPU side (byte swap, palette expansion).
+//Before timing, the fixed-point math is checked against libm over its input
+//range; a function off by more than its FX_BOUND_* fails the run.
+//Usage: st7789_bench [--json] [--output file] [--filter text] [--samples n]
+//                    [--baseline file] [--threshold percent] [--list]
+
+#define BENCH_SAMPLES 15
+#define BENCH_SAMPLE_NS 2000000 //calls per sample are doubled until a sample takes this long
+#define BENCH_THRESHOLD 10 //percent slower than the baseline that counts as a regression
+#define BENCH_MAX_CASES 128
+
+//largest accepted error against libm, in units of the result's last bit
+#define FX_BOUND_SIN 2 //Q1.15, fx_sin and fx_cos over every angle
+#define FX_BOUND_ATAN2 3 //binary angle units (0.016 degrees)
+#define FX_BOUND_ISQRT 0 //exact floor(sqrt(x))
+#define FX_BOUND_LOG2 2 //Q16.16
+#define FX_BOUND_LN 4 //Q16.16, log2 error times ln(2) plus the rounding of the product
+
+typedef struct bench_case bench_case_t;
+struct bench_case {
+    const char *group;
+    const char *name;
+    const char *params;
+    void (*setup)(bench_case_t *c); //optional, runs once before timing, may fill in pixels
+    void (*run)(const bench_case_t *c, uint32_t i);
+    uint32_t pixels; //pixels written per call, particles for the particle cases, 0 when it does not apply
+    int32_t a, b; //case parameters
+};
+
+typedef struct {
+    uint64_t iterations;
+    double median, mean, min, stddev; //ns per call
+} bench_result_t;
+
+static uint8_t font[(FONT_END - FONT_START) * FONT_HEIGHT];
+static uint64_t sink_bytes;
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+//Wrappers of the cases shared with the device (bench_cases.h), by argument list
+#define RUN_CASE(name) \
+    static void run_##name(const bench_case_t *c, uint32_t i) { case_##name(i); }
+#define RUN_CASE_AB(name) \
+    static void run_##name(const bench_case_t *c, uint32_t i) { case_##name(i, c->a, c->b); }
+#define RUN_CASE_ALPHA(name) \
+    static void run_##name(const bench_case_t *c, uint32_t i) { case_##name(i, c->b); }
+
+
+//Transport that drops everything, the SPI layer of the benchmarks
+
+static void sink_init(void) {}
+static void sink_level(uint32_t level) {}
+static void sink_write(const void *data, size_t size) { sink_bytes += size; }
+static void sink_wait(void) {}
+static void sink_backlight(uint8_t duty) {}
+
+static const st7789_transport_t sink_transport = {
+    .init = sink_init,
+    .set_dc = sink_level,
+    .set_reset = sink_level,
+    .write = sink_write,
+    .queue = sink_write,
+    .wait = sink_wait,
+    .backlight = sink_backlight,
+};
+
+
+//Fills
+
+RUN_CASE(clear)
+RUN_CASE(columns)
+RUN_CASE_AB(rect)
+
+static void run_checker(const bench_case_t *c, uint32_t i) {
+    for (uint16_t y = 0; y < TFT_HEIGHT; y += c->a) {
+        for (uint16_t x = 0; x < TFT_WIDTH; x += c->a) {
+            draw_rectangle(x, y, x + c->a - 1, y + c->a - 1, BENCH_COLOR(i + ((x + y) / c->a)));
+        }
+    }
+}
+
+#if FRAME_BUFFER_BPP == 16
+RUN_CASE(ref_clear)
+RUN_CASE(ref_columns)
+RUN_CASE_AB(ref_rect)
+#endif
+
+
+//Text
+
+static void setup_font(bench_case_t *c) {
+    for (uint32_t i = 0; i < sizeof(font); i++) font[i] = (i * 0x9E) ^ (i >> 3);
+}
+
+static void run_char(const bench_case_t *c, uint32_t i) {
+    uint16_t size = FONT_WIDTH * c->a;
+    draw_char_scaled(bench_x(i) % (TFT_WIDTH - size), bench_y(i) % (TFT_HEIGHT - size),
+                     FONT_START + i % (FONT_END - FONT_START), BENCH_COLOR(i), c->a, font);
+}
+
+static char text_wall[512];
+
+static void setup_text_wall(bench_case_t *c) {
+    setup_font(c);
+    uint16_t cols = TFT_WIDTH / (FONT_WIDTH * c->a);
+    uint16_t rows = TFT_HEIGHT / ((FONT_HEIGHT + 2) * c->a);
+    uint32_t n = 0;
+    for (uint16_t r = 0; r < rows; r++) {
+        for (uint16_t k = 0; k < cols; k++) text_wall[n++] = FONT_START + 1 + (r * cols + k) % 94;
+        text_wall[n++] = '\n';
+    }
+    text_wall[n] = '\0';
+}
+
+static void run_text_wall(const bench_case_t *c, uint32_t i) {
+    draw_text_scaled(0, 0, text_wall, BENCH_COLOR(i), c->a, font);
+}
+
+
+//Flush and send_color with the sink transport
+
+static uint16_t color_buffer[TFT_WIDTH * TFT_HEIGHT];
+
+static void run_flush(const bench_case_t *c, uint32_t i) { flush_frame_buffer(); }
+static void run_send_color(const bench_case_t *c, uint32_t i) { send_color(color_buffer, c->a); }
+
+
+//Shapes
+
+static uint16_t pixel_at(uint32_t p) {
+#if FRAME_BUFFER_BPP == 16
+    return get_frame_buffer()[p];
+#elif FRAME_BUFFER_BPP == 8
+    return get_index_buffer()[p];
+#else
+    return (get_index_buffer()[p >> 1] >> ((p & 1) ? 0 : 4)) & 0x0F;
+#endif
+}
+
+//Pixels one call writes where nothing is clipped, counted on a cleared
+//frame buffer. Calls near the edges are clipped and write fewer.
+static void setup_shape(bench_case_t *c) {
+    int32_t m = (c->a > c->b) ? c->a : c->b;
+    uint32_t i = 0;
+    while (bench_x(i) < m || bench_x(i) + m >= TFT_WIDTH || bench_y(i) < m || bench_y(i) + m >= TFT_HEIGHT ||
+           BENCH_COLOR(i) == 0) {
+        if (++i == 65536) return;
+    }
+    clear_frame_buffer(0);
+    c->run(c, i);
+    c->pixels = 0;
+    for (uint32_t p = 0; p < TFT_WIDTH * TFT_HEIGHT; p++) c->pixels += pixel_at(p) != 0;
+}
+
+RUN_CASE_AB(circle)
+RUN_CASE_AB(ref_circle)
+RUN_CASE_AB(fill_circle)
+RUN_CASE_AB(ref_fill_circle)
+RUN_CASE_AB(fill_triangle)
+RUN_CASE_AB(ref_fill_triangle)
+RUN_CASE_AB(fill_ellipse)
+RUN_CASE_AB(fill_round_rect)
+RUN_CASE_AB(fill_arc)
+
+
+//Sprites and blending, RGB565 only
+
+#if FRAME_BUFFER_BPP == 16
+//Sprites of a x a pixels; the blend cases leave a at 0 for the largest
+//sprite and pass their alpha in b
+static void setup_sprite(bench_case_t *c) { bench_make_sprite(c->a); }
+
+RUN_CASE(blit)
+RUN_CASE(blit_keyed)
+RUN_CASE(blit_alpha)
+RUN_CASE(ref_blit)
+RUN_CASE_ALPHA(blend_fill)
+RUN_CASE_ALPHA(ref_blend_fill)
+RUN_CASE_ALPHA(blend_rows)
+RUN_CASE_ALPHA(ref_blend_rows)
+RUN_CASE(blend_alpha8)
+RUN_CASE(ref_blend_alpha8)
+#endif
+
+
+//Fixed-point math next to libm
+
+RUN_CASE(sinf)
+RUN_CASE(fx_sin)
+RUN_CASE(atan2f)
+RUN_CASE(fx_atan2)
+RUN_CASE(sqrtf)
+RUN_CASE(fx_isqrt)
+RUN_CASE(logf)
+RUN_CASE(fx_ln)
+
+static bool fx_report(const char *name, double error, double bound) {
+    bool ok = error <= bound;
+    fprintf(stderr, "%-44s max error %6.2f  bound %d  %s\n", name, error, (int)bound, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static double fx_angle_error(uint16_t got, double rad) {
+    double d = fmod(got - rad * (FX_ANGLE_TURN / (2 * M_PI)) + 1.5 * FX_ANGLE_TURN, FX_ANGLE_TURN);
+    return fabs(d - FX_ANGLE_TURN / 2);
+}
+
+/**
+ * @brief Checks the fixed-point math against libm in double precision.
+ *
+ * fx_sin and fx_cos are checked at every angle, fx_atan2 on a grid around
+ * the origin and at scattered large coordinates, fx_isqrt at every value
+ * below 2^20 and spaced out to 2^32, fx_log2 and fx_ln at every Q16 value
+ * below one and spaced out to the largest positive one.
+ *
+ * @return The number of functions over their bound.
+ */
+static int check_fxmath(void) {
+    double e_sin = 0, e_atan2 = 0, e_isqrt = 0, e_log2 = 0, e_ln = 0;
+
+    for (uint32_t a = 0; a < FX_ANGLE_TURN; a++) {
+        double rad = a * (2 * M_PI / FX_ANGLE_TURN);
+        e_sin = fmax(e_sin, fabs(fx_sin(a) - FX_TRIG_ONE * sin(rad)));
+        e_sin = fmax(e_sin, fabs(fx_cos(a) - FX_TRIG_ONE * cos(rad)));
+    }
+    for (int32_t y = -2000; y <= 2000; y += 7) {
+        for (int32_t x = -2000; x <= 2000; x += 5) {
+            if (x || y) e_atan2 = fmax(e_atan2, fx_angle_error(fx_atan2(y, x), atan2(y, x)));
+        }
+    }
+    for (uint32_t k = 1; k < 200000; k++) {
+        int32_t y = (int32_t)(k * 2654435761u) >> 8, x = (int32_t)(k * 39569411u) >> 8;
+        if (x || y) e_atan2 = fmax(e_atan2, fx_angle_error(fx_atan2(y, x), atan2(y, x)));
+    }
+    for (uint64_t x = 0; x <= UINT32_MAX; x += (x < (1u << 20)) ? 1 : 65521) {
+        e_isqrt = fmax(e_isqrt, fabs((double)fx_isqrt(x) - floor(sqrt((double)x))));
+    }
+    for (int64_t x = 1; x <= INT32_MAX; x += (x < FX_ONE) ? 1 : 4099) {
+        e_log2 = fmax(e_log2, fabs(fx_log2(x) - log2((double)x / FX_ONE) * FX_ONE));
+        e_ln = fmax(e_ln, fabs(fx_ln(x) - log((double)x / FX_ONE) * FX_ONE));
+    }
+
+    int failed = 0;
+    failed += !fx_report("fxmath/accuracy/fx_sin fx_cos", e_sin, FX_BOUND_SIN);
+    failed += !fx_report("fxmath/accuracy/fx_atan2", e_atan2, FX_BOUND_ATAN2);
+    failed += !fx_report("fxmath/accuracy/fx_isqrt", e_isqrt, FX_BOUND_ISQRT);
+    failed += !fx_report("fxmath/accuracy/fx_log2", e_log2, FX_BOUND_LOG2);
+    failed += !fx_report("fxmath/accuracy/fx_ln", e_ln, FX_BOUND_LN);
+    return failed;
+}
+
+
+//TOHA effect frames: float and fixed point per pixel, field maps, particles
+
+static void setup_field(bench_case_t *c) {
+    if (!bench_field_init()) {
+        fprintf(stderr, "no memory for the field map\n");
+        exit(2);
+    }
+}
+static void setup_tunnel_map(bench_case_t *c) { setup_field(c); case_tunnel_map(0); }
+static void setup_plasma_map(bench_case_t *c) { setup_field(c); case_plasma_map(0); }
+
+static void run_ref_frame(const bench_case_t *c, uint32_t i) {
+    static void (*const frames[])(uint32_t) = {ref_tunnel_float, ref_tunnel_fixed, ref_plasma_float, ref_plasma_fixed};
+    frames[c->a](i);
+}
+RUN_CASE(field_frame)
+RUN_CASE(tunnel_map)
+
+static void setup_particles(bench_case_t *c) {
+    if (!bench_particles_init(c->a)) {
+        fprintf(stderr, "no memory for %d particles\n", (int)c->a);
+        exit(2);
+    }
+}
+
+RUN_CASE(soa_update)
+RUN_CASE(soa_render)
+RUN_CASE(aos_update)
+RUN_CASE(aos_render)
+
+
+#define FRAME (TFT_WIDTH * TFT_HEIGHT)
+
+static bench_case_t cases[] = {
+    {"fill", "clear_frame_buffer", "solid", NULL, run_clear, FRAME},
+    {"fill", "draw_rectangle", "135x240", NULL, run_rect, FRAME, TFT_WIDTH, TFT_HEIGHT},
+    {"fill", "draw_rectangle", "135x80", NULL, run_rect, TFT_WIDTH * 80, TFT_WIDTH, 80},
+    {"fill", "draw_rectangle", "64x64", NULL, run_rect, 64 * 64, 64, 64},
+    {"fill", "draw_rectangle", "16x16", NULL, run_rect, 16 * 16, 16, 16},
+    {"fill", "draw_rectangle", "3x40", NULL, run_rect, 3 * 40, 3, 40},
+    {"fill", "draw_rectangle", "1x240", NULL, run_rect, TFT_HEIGHT, 1, TFT_HEIGHT},
+    {"fill", "draw_rectangle", "135x1", NULL, run_rect, TFT_WIDTH, TFT_WIDTH, 1},
+    {"fill", "pattern", "columns", NULL, run_columns, FRAME},
+    {"fill", "pattern", "checker 8", NULL, run_checker, 136 * 240, 8},
+    {"fill", "pattern", "checker 2", NULL, run_checker, 136 * 240, 2},
+#if FRAME_BUFFER_BPP == 16
+    {"fill", "ref_rectangle", "135x240", NULL, run_ref_clear, FRAME},
+    {"fill", "ref_rectangle", "columns", NULL, run_ref_columns, FRAME},
+    {"fill", "ref_rectangle", "64x64", NULL, run_ref_rect, 64 * 64, 64, 64},
+    {"fill", "ref_rectangle", "16x16", NULL, run_ref_rect, 16 * 16, 16, 16},
+    {"fill", "ref_rectangle", "3x40", NULL, run_ref_rect, 3 * 40, 3, 40},
+#endif
+
+    {"text", "draw_char_scaled", "scale 1", setup_font, run_char, FONT_WIDTH * FONT_HEIGHT, 1},
+    {"text", "draw_char_scaled", "scale 2", setup_font, run_char, FONT_WIDTH * FONT_HEIGHT * 4, 2},
+    {"text", "draw_char_scaled", "scale 3", setup_font, run_char, FONT_WIDTH * FONT_HEIGHT * 9, 3},
+    {"text", "draw_char_scaled", "scale 4", setup_font, run_char, FONT_WIDTH * FONT_HEIGHT * 16, 4},
+    {"text", "draw_text_scaled", "wall scale 1", setup_text_wall, run_text_wall, 16 * 17 * FONT_WIDTH * FONT_HEIGHT, 1},
+    {"text", "draw_text_scaled", "wall scale 2", setup_text_wall, run_text_wall, 8 * 8 * FONT_WIDTH * FONT_HEIGHT * 4, 2},
+
+    {"flush", "flush_frame_buffer", "full", NULL, run_flush, FRAME},
+    {"flush", "send_color", "135 px", NULL, run_send_color, TFT_WIDTH, TFT_WIDTH},
+    {"flush", "send_color", "1024 px", NULL, run_send_color, 1024, 1024},
+    {"flush", "send_color", "32400 px", NULL, run_send_color, FRAME, FRAME},
+
+    {"shapes", "draw_circle", "r20", setup_shape, run_circle, 0, 20},
+    {"shapes", "ref_circle", "r20", setup_shape, run_ref_circle, 0, 20},
+    {"shapes", "fill_circle", "r20", setup_shape, run_fill_circle, 0, 20},
+    {"shapes", "ref_fill_circle", "r20", setup_shape, run_ref_fill_circle, 0, 20},
+    {"shapes", "fill_circle", "r60", setup_shape, run_fill_circle, 0, 60},
+    {"shapes", "fill_triangle", "40", setup_shape, run_fill_triangle, 0, 40},
+    {"shapes", "ref_fill_triangle", "40", setup_shape, run_ref_fill_triangle, 0, 40},
+    {"shapes", "fill_ellipse", "30x15", setup_shape, run_fill_ellipse, 0, 30, 15},
+    {"shapes", "fill_round_rect", "40x30 r8", setup_shape, run_fill_round_rect, 0, 40, 30},
+    {"shapes", "fill_arc", "r20-12", setup_shape, run_fill_arc, 0, 20, 12},
+
+#if FRAME_BUFFER_BPP == 16
+    {"blit", "blit", "16", setup_sprite, run_blit, 16 * 16, 16},
+    {"blit", "blit", "64", setup_sprite, run_blit, 64 * 64, 64},
+    {"blit", "blit_keyed", "16", setup_sprite, run_blit_keyed, 16 * 16, 16},
+    {"blit", "blit_keyed", "64", setup_sprite, run_blit_keyed, 64 * 64, 64},
+    {"blit", "blit_alpha", "16", setup_sprite, run_blit_alpha, 16 * 16, 16},
+    {"blit", "blit_alpha", "64", setup_sprite, run_blit_alpha, 64 * 64, 64},
+    {"blit", "ref_blit", "64", setup_sprite, run_ref_blit, 64 * 64, 64},
+
+    {"blend", "fill_rect_alpha", "a96", setup_sprite, run_blend_fill, FRAME, 0, 96},
+    {"blend", "ref_blend_fill", "a96", setup_sprite, run_ref_blend_fill, FRAME, 0, 96},
+    {"blend", "blend_row", "64x240 a160", setup_sprite, run_blend_rows, 64 * TFT_HEIGHT, 0, 160},
+    {"blend", "ref_blend_row", "64x240 a160", setup_sprite, run_ref_blend_rows, 64 * TFT_HEIGHT, 0, 160},
+    {"blend", "blend_row_alpha8", "64x240", setup_sprite, run_blend_alpha8, 64 * TFT_HEIGHT},
+    {"blend", "ref_blend_alpha8", "64x240", setup_sprite, run_ref_blend_alpha8, 64 * TFT_HEIGHT},
+#endif
+
+    {"fxmath", "sinf", "", NULL, run_sinf},
+    {"fxmath", "fx_sin", "", NULL, run_fx_sin},
+    {"fxmath", "atan2f", "", NULL, run_atan2f},
+    {"fxmath", "fx_atan2", "", NULL, run_fx_atan2},
+    {"fxmath", "sqrtf", "", NULL, run_sqrtf},
+    {"fxmath", "fx_isqrt", "", NULL, run_fx_isqrt},
+    {"fxmath", "logf", "", NULL, run_logf},
+    {"fxmath", "fx_ln", "", NULL, run_fx_ln},
+
+    {"effects", "tunnel", "float", NULL, run_ref_frame, FRAME, 0},
+    {"effects", "tunnel", "fixed", NULL, run_ref_frame, FRAME, 1},
+    {"effects", "tunnel", "field map", setup_tunnel_map, run_field_frame, FRAME},
+    {"effects", "tunnel", "build map", setup_field, run_tunnel_map, FRAME},
+    {"effects", "plasma", "float", NULL, run_ref_frame, FRAME, 2},
+    {"effects", "plasma", "fixed", NULL, run_ref_frame, FRAME, 3},
+    {"effects", "plasma", "field map", setup_plasma_map, run_field_frame, FRAME},
+    {"effects", "particles update", "500 SoA", setup_particles, run_soa_update, 500, 500},
+    {"effects", "particles update", "500 AoS", setup_particles, run_aos_update, 500, 500},
+    {"effects", "particles update", "4000 SoA", setup_particles, run_soa_update, 4000, 4000},
+    {"effects", "particles update", "4000 AoS", setup_particles, run_aos_update, 4000, 4000},
+    {"effects", "particles render", "4000 SoA", setup_particles, run_soa_render, 4000, 4000},
+    {"effects", "particles render", "4000 AoS", setup_particles, run_aos_render, 4000, 4000},
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Times one case.
+ *
+ * The number of calls per sample is doubled until a sample takes at least
+ * BENCH_SAMPLE_NS, then every sample is timed separately so the spread
+ * between samples can be reported.
+ */
+static bench_result_t bench_case(bench_case_t *c, uint32_t samples) {
+    bench_result_t r = {0};
+    double ns[64];
+    uint32_t i = 0;
+    uint64_t calls = 1;
+
+    if (c->setup) c->setup(c);
+    for (;;) {
+        uint64_t start = now_ns();
+        for (uint64_t k = 0; k < calls; k++) c->run(c, i++);
+        if (now_ns() - start >= BENCH_SAMPLE_NS || calls >= (1u << 30)) break;
+        calls *= 2;
+    }
+
+    if (samples > 64) samples = 64;
+    for (uint32_t s = 0; s < samples; s++) {
+        uint64_t start = now_ns();
+        for (uint64_t k = 0; k < calls; k++) c->run(c, i++);
+        ns[s] = (double)(now_ns() - start) / calls;
+        r.mean += ns[s];
+    }
+    r.iterations = calls * samples;
+    r.mean /= samples;
+    for (uint32_t s = 0; s < samples; s++) r.stddev += (ns[s] - r.mean) * (ns[s] - r.mean);
+    r.stddev = sqrt(r.stddev / samples);
+    qsort(ns, samples, sizeof(double), compare_double);
+    r.min = ns[0];
+    r.median = (samples & 1) ? ns[samples / 2] : (ns[samples / 2 - 1] + ns[samples / 2]) / 2;
+    return r;
+}
+
+static void case_key(const bench_case_t *c, char *key, size_t size) {
+    snprintf(key, size, "%s/%s%s%s", c->group, c->name, c->params[0] ? "/" : "", c->params);
+}
+
+/**
+ * @brief Writes one result as a CSV row or a JSON object (one per line).
+ */
+static void write_result(FILE *out, bool json, bool first, const bench_case_t *c, const bench_result_t *r) {
+    char key[96];
+    case_key(c, key, sizeof(key));
+    char mpix[24] = ""; //left empty, or null in JSON, for cases that write no pixels
+    if (c->pixels && r->median > 0) snprintf(mpix, sizeof(mpix), "%.2f", c->pixels * 1000.0 / r->median);
+    double cv = (r->mean > 0) ? 100.0 * r->stddev / r->mean : 0;
+
+    if (json) {
+        fprintf(out, "%s  {\"case\": \"%s\", \"bpp\": %d, \"iterations\": %llu, \"ns_op_median\": %.2f, "
+                "\"ns_op_mean\": %.2f, \"ns_op_min\": %.2f, \"ns_op_stddev\": %.2f, \"cv_percent\": %.2f, "
+                "\"mpixels_s\": %s}", first ? "" : ",\n", key, FRAME_BUFFER_BPP, (unsigned long long)r->iterations,
+                r->median, r->mean, r->min, r->stddev, cv, mpix[0] ? mpix : "null");
+    } else {
+        fprintf(out, "%s,%d,%llu,%.2f,%.2f,%.2f,%.2f,%.2f,%s\n", key, FRAME_BUFFER_BPP,
+                (unsigned long long)r->iterations, r->median, r->mean, r->min, r->stddev, cv, mpix);
+    }
+}
+
+typedef struct {
+    char key[96];
+    double median;
+} baseline_t;
+
+/**
+ * @brief Reads the case names and median ns/op from an earlier CSV or JSON output.
+ *
+ * @return Number of entries read, -1 if the file cannot be opened.
+ */
+static int read_baseline(const char *path, baseline_t *base, int max) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    char line[512];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), file)) {
+        char *k = strstr(line, "\"case\": \"");
+        if (k) {
+            char *m = strstr(line, "\"ns_op_median\": ");
+            char *end = strchr(k + 9, '"');
+            if (m == NULL || end == NULL) continue;
+            snprintf(base[n].key, sizeof(base[n].key), "%.*s", (int)(end - k - 9), k + 9);
+            base[n].median = atof(m + 16);
+            n++;
+        } else if (strncmp(line, "case,", 5) != 0 && strchr(line, ',')) {
+            char *comma = strchr(line, ',');
+            snprintf(base[n].key, sizeof(base[n].key), "%.*s", (int)(comma - line), line);
+            //case,bpp,iterations,ns_op_median,...
+            char *field = comma;
+            for (int f = 0; f < 2 && field; f++) field = strchr(field + 1, ',');
+            if (field == NULL) continue;
+            base[n].median = atof(field + 1);
+            n++;
+        }
+    }
+    fclose(file);
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: st7789_bench [--json] [--output file] [--filter text] [--samples n]\n"
+                    "                    [--baseline file] [--threshold percent] [--list]\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false, list = false;
+    const char *output = NULL, *filter = NULL, *baseline_path = NULL;
+    uint32_t samples = BENCH_SAMPLES;
+    double threshold = BENCH_THRESHOLD;
+
+    for (int a = 1; a < argc; a++) {
+        bool more = a + 1 < argc;
+        if (!strcmp(argv[a], "--json")) json = true;
+        else if (!strcmp(argv[a], "--list")) list = true;
+        else if (!strcmp(argv[a], "--output") && more) output = argv[++a];
+        else if (!strcmp(argv[a], "--filter") && more) filter = argv[++a];
+        else if (!strcmp(argv[a], "--samples") && more) samples = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--baseline") && more) baseline_path = argv[++a];
+        else if (!strcmp(argv[a], "--threshold") && more) threshold = atof(argv[++a]);
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (samples < 2) samples = 2;
+
+    static baseline_t base[BENCH_MAX_CASES];
+    int base_count = 0;
+    if (baseline_path) {
+        base_count = read_baseline(baseline_path, base, BENCH_MAX_CASES);
+        if (base_count < 0) {
+            fprintf(stderr, "cannot read baseline %s\n", baseline_path);
+            return 2;
+        }
+    }
+
+    FILE *out = stdout;
+    if (output && !list) {
+        out = fopen(output, "w");
+        if (out == NULL) {
+            fprintf(stderr, "cannot write %s\n", output);
+            return 2;
+        }
+    }
+
+    st7789_set_transport(&sink_transport);
+    INIT();
+#if FRAME_BUFFER_BPP != 16
+    static const uint16_t palette[] = {0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F, 0xFFE0, 0xF81F, 0x07FF};
+    palette_set(0, palette, sizeof(palette) / sizeof(palette[0]));
+#endif
+    for (uint32_t p = 0; p < TFT_WIDTH * TFT_HEIGHT; p++) color_buffer[p] = p * 2654435761u >> 16;
+
+    if (json) fprintf(out, "[\n");
+    else if (!list) fprintf(out, "case,bpp,iterations,ns_op_median,ns_op_mean,ns_op_min,ns_op_stddev,cv_percent,mpixels_s\n");
+
+    int inaccurate = list ? 0 : check_fxmath();
+    int regressions = 0;
+    bool first = true;
+    for (uint32_t n = 0; n < CASE_COUNT; n++) {
+        bench_case_t *c = &cases[n];
+        char key[96];
+        case_key(c, key, sizeof(key));
+        if (filter && !strstr(key, filter)) continue;
+        if (list) {
+            printf("%s\n", key);
+            continue;
+        }
+
+        bench_result_t r = bench_case(c, samples);
+        write_result(out, json, first, c, &r);
+        first = false;
+        fflush(out);
+
+        const char *verdict = "";
+        for (int b = 0; b < base_count; b++) {
+            if (strcmp(base[b].key, key) != 0) continue;
+            double change = 100.0 * (r.median - base[b].median) / base[b].median;
+            if (change > threshold) {
+                verdict = "REGRESSION";
+                regressions++;
+            } else if (change < -threshold) {
+                verdict = "faster";
+            }
+            fprintf(stderr, "%-44s %12.1f ns %+7.1f%% %s\n", key, r.median, change, verdict);
+            break;
+        }
+        if (base_count == 0) fprintf(stderr, "%-44s %12.1f ns  cv %5.1f%%\n", key, r.median, 100.0 * r.stddev / r.mean);
+    }
+
+    if (json) fprintf(out, "\n]\n");
+    if (out != stdout) fclose(out);
+    bench_particles_free();
+    bench_field_free();
+
+    if (baseline_path) {
+        fprintf(stderr, "%d regression%s over %.0f%% against %s\n", regressions, (regressions == 1) ? "" : "s",
+                threshold, baseline_path);
+    }
+    if (inaccurate) fprintf(stderr, "%d fixed-point function%s over the error bound\n", inaccurate, (inaccurate == 1) ? "" : "s");
+    return (regressions || inaccurate) ? 1 : 0;
+}
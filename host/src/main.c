@@ -0,0 +1,475 @@
+#include "st7789.h"
+#include "st7789_shapes.h"
+#include "st7789_indexed.h"
+#include "st7789_emulator.h"
+#include "st7789_trace.h"
+#include "st7789_record.h"
+#include "st7789_dlist.h"
+#include "st7789_blit.h"
+#include "st7789_ui.h"
+#include "st7789_compositor.h"
+#include "st7789_blend.h"
+#include "st7789_backing.h"
+#include "st7789_dither.h"
+#include "st7789_jpeg.h"
+#include <stdlib.h>
+
+//Host demo of the driver running on the panel emulator. Every scene is drawn
+//with the normal driver calls, the panel contents are checked against what
+//was drawn and dumped as PPM, and the wire cost of the scene is printed.
+//With ST7789_TRACE the bus trace of all scenes is dumped at the end, for
+//tools/trace.py. With ST7789_RECORD the draw calls of the scenes are saved
+//to session.rec in the output directory, for st7789_replay. The display
+//list scenes (RGB565 builds only) check the tiled renderer against the same
+//frame drawn in the frame buffer, then move one object and flush unchanged.
+//The widget scenes change a few values and check that the partial flushes
+//leave the panel equal to the frame buffer. The compositor scenes check the
+//layers against a plain bottom-up reference after moving a sprite and
+//rewriting part of the overlay. The backing store scenes move dots over a
+//checkerboard, then remove them and check that the background is back.
+//The dither scene converts a gradient row by row into the frame buffer and
+//checks that truncation matches rgb888_to_rgb565.
+//The JPEG scene streams 1.jpg to the panel, checks it against the same file
+//decoded into the frame buffer (RGB565 builds) and logs the bytes it read
+//against the raw image.
+//Usage: st7789_host [assets dir] [output dir]
+
+static const char *TAG = "host";
+
+static uint8_t font[(FONT_END - FONT_START) * FONT_HEIGHT];
+static uint16_t colors[] = {
+    0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F,
+    0xFFE0, 0xF81F, 0x07FF, 0xAAAA, 0x5555
+};
+#define NUM_COLORS (sizeof(colors) / sizeof(colors[0]))
+
+#if FRAME_BUFFER_BPP == 16
+#define COLOR(i) colors[i]
+#else
+#define COLOR(i) (i)
+#endif
+
+static const char *out_dir = ".";
+static int failures = 0;
+
+
+/**
+ * @brief Returns the RGB565 color the frame buffer holds at a pixel.
+ */
+static uint16_t frame_pixel(uint16_t x, uint16_t y) {
+    uint32_t i = y * TFT_WIDTH + x;
+#if FRAME_BUFFER_BPP == 16
+    return get_frame_buffer()[i];
+#elif FRAME_BUFFER_BPP == 8
+    return palette_get(get_index_buffer()[i]);
+#else
+    uint8_t b = get_index_buffer()[i >> 1];
+    return palette_get((i & 1) ? b & 0x0F : b >> 4);
+#endif
+}
+
+/**
+ * @brief Counts the pixels of a rectangle where the panel differs from the expected colors.
+ */
+static uint32_t compare(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1,
+                        uint16_t (*expected)(uint16_t x, uint16_t y)) {
+    uint32_t wrong = 0;
+    for (uint16_t y = y0; y <= y1; y++) {
+        for (uint16_t x = x0; x <= x1; x++) {
+            if (emu_get_pixel(x, y) != expected(x, y)) wrong++;
+        }
+    }
+    return wrong;
+}
+
+/**
+ * @brief Prints the wire cost of a scene and dumps the panel.
+ *
+ * @param name Scene name, also the PPM file name.
+ * @param wrong Number of pixels that did not match.
+ */
+static void scene_done(const char *name, uint32_t wrong) {
+    emu_counters_t c;
+    emu_take_counters(&c);
+    printf("%-12s %8lu %8lu %9lu %8lu %6lu %8lu  %s\n", name,
+           (unsigned long)c.commands, (unsigned long)c.transactions, (unsigned long)c.bytes,
+           (unsigned long)c.pixels, (unsigned long)c.windows, (unsigned long)emu_wire_us(&c),
+           wrong ? "MISMATCH" : "ok");
+    if (wrong) {
+        ESP_LOGE(TAG, "%s: %lu pixels differ", name, (unsigned long)wrong);
+        failures++;
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.ppm", out_dir, name);
+    emu_write_ppm(path, false);
+}
+
+static void scene_shapes(void) {
+    clear_frame_buffer(COLOR(0));
+    draw_rectangle(5, 5, 60, 40, COLOR(2));
+    fill_circle(100, 30, 25, COLOR(3));
+    draw_circle(67, 120, 50, COLOR(5));
+    fill_triangle(10, 230, 67, 150, 125, 230, COLOR(4));
+    fill_round_rect(20, 60, 110, 90, 8, COLOR(6));
+    draw_text_scaled(10, 100, "ST7789", COLOR(1), 2, font);
+    flush_frame_buffer();
+    scene_done("shapes", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+}
+
+static void scene_text(void) {
+    clear_frame_buffer(COLOR(8));
+    uint16_t y = 0;
+    for (uint8_t scale = 1; scale <= 3; scale++) {
+        draw_text_scaled(0, y, "Hello 123\nabc XYZ", COLOR(1 + scale), scale, font);
+        y += 2 * (FONT_HEIGHT + 2) * scale + 4;
+    }
+    flush_frame_buffer();
+    scene_done("text", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+}
+
+static uint16_t *image;
+
+static uint16_t image_pixel(uint16_t x, uint16_t y) {
+    return image[x * TFT_HEIGHT + y];
+}
+
+static void scene_image(const char *assets) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/1.bin", assets);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "no %s, image scene skipped", path);
+        return;
+    }
+    image = malloc(TFT_WIDTH * TFT_HEIGHT * 2);
+    size_t read = fread(image, 2, TFT_WIDTH * TFT_HEIGHT, file);
+    fclose(file);
+    if (read != TFT_WIDTH * TFT_HEIGHT) {
+        ESP_LOGW(TAG, "%s is too short, image scene skipped", path);
+        free(image);
+        return;
+    }
+
+    load_image(path);
+    scene_done("image", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, image_pixel));
+    free(image);
+}
+
+static void scene_jpeg(const char *assets) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/1.jpg", assets);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "no %s, jpeg scene skipped", path);
+        return;
+    }
+    fclose(file);
+
+    uint32_t wrong = 0;
+    jpeg_stats_t st;
+    if (!load_jpeg(path, 0, 0, JPEG_TO_PANEL, DITHER_NONE)) wrong++;
+    jpeg_get_stats(&st);
+#if FRAME_BUFFER_BPP == 16
+    //decoding into the frame buffer sends nothing, the wire cost stays the panel load's
+    if (!load_jpeg(path, 0, 0, JPEG_TO_FRAME_BUFFER, DITHER_NONE)) wrong++;
+    wrong += compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel);
+#endif
+    ESP_LOGI(TAG, "jpeg: %ux%u in %u strips, %lu bytes read, raw image %u bytes, %lu us", st.width, st.height,
+             st.strips, (unsigned long)st.bytes_read, TFT_WIDTH * TFT_HEIGHT * 2, (unsigned long)st.total_us);
+    scene_done("jpeg", wrong);
+}
+
+static uint16_t direct_color;
+
+static uint16_t direct_pixel(uint16_t x, uint16_t y) {
+    return direct_color;
+}
+
+static void scene_direct_fill(void) {
+    direct_color = 0xF81F;
+    fill_rect_direct(20, 40, 100, 200, direct_color);
+    scene_done("direct_fill", compare(20, 40, 100, 200, direct_pixel));
+}
+
+#if FRAME_BUFFER_BPP == 16
+#define DL_BALL_SIZE 8
+static uint16_t ball_pixels[DL_BALL_SIZE * DL_BALL_SIZE];
+static const sprite_t ball = {ball_pixels, NULL, DL_BALL_SIZE, DL_BALL_SIZE, 0};
+
+/**
+ * @brief Draws the display list scene in the frame buffer, the expected result.
+ */
+static void dlist_reference(int16_t box_x) {
+    clear_frame_buffer(COLOR(8));
+    draw_rectangle(0, 150, TFT_WIDTH - 1, TFT_HEIGHT - 1, COLOR(4));
+    draw_rectangle(5, 5, 60, 40, COLOR(2));
+    fill_circle(100, 30, 25, COLOR(3));
+    draw_rectangle(box_x, 60, box_x + 30, 90, COLOR(6));
+    draw_text_scaled(10, 100, "ST7789\ntiles", COLOR(1), 2, font);
+    blit_keyed(&ball, 0, 0, BLIT_FULL_W, BLIT_FULL_H, 120, 200, 0x0000);
+    fill_circle(67, 195, 60, COLOR(5));
+}
+
+static void scene_dlist(void) {
+    for (int i = 0; i < DL_BALL_SIZE * DL_BALL_SIZE; i++) {
+        int x = i % DL_BALL_SIZE - 4, y = i / DL_BALL_SIZE - 4;
+        ball_pixels[i] = (x * x + y * y < 14) ? COLOR(7) : 0x0000;
+    }
+
+    dl_reset(COLOR(8));
+    dl_rect(0, 150, TFT_WIDTH - 1, TFT_HEIGHT - 1, COLOR(4));
+    dl_rect(5, 5, 60, 40, COLOR(2));
+    dl_circle(100, 30, 25, COLOR(3));
+    dl_handle_t box = dl_rect(10, 60, 40, 90, COLOR(6));
+    dl_text(10, 100, "ST7789\ntiles", COLOR(1), 2, font);
+    dl_sprite_keyed(&ball, 120, 200, 0x0000);
+    dl_circle(67, 195, 60, COLOR(5));
+    dl_flush();
+    dlist_reference(10);
+    scene_done("dlist", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    dl_move(box, 60, 0);
+    dl_flush();
+    dlist_reference(70);
+    scene_done("dlist_move", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    dl_flush();
+    scene_done("dlist_same", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+}
+#endif
+
+static void scene_ui(void) {
+    ui_init(COLOR(0), font);
+    ui_label(4, 4, 15, 1, COLOR(1), COLOR(0), "Battery");
+    ui_handle_t volts = ui_number(4, 20, 6, 2, 2, COLOR(5), COLOR(0));
+    ui_handle_t level = ui_bar(4, 50, 127, 10, 0, 100, COLOR(3), COLOR(8));
+    ui_handle_t temp = ui_gauge(67, 130, 50, 10, -20, 80, COLOR(2), COLOR(8), COLOR(0));
+    ui_handle_t status = ui_label(4, 200, 15, 1, COLOR(7), COLOR(0), "charging");
+    ui_set_value(volts, 412);
+    ui_set_value(level, 40);
+    ui_set_value(temp, 25);
+    ui_update();
+    scene_done("ui", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    ui_set_value(volts, 413);
+    ui_set_value(level, 45);
+    ui_set_value(temp, 25);
+    ui_set_text(status, "charged");
+    ui_update();
+    scene_done("ui_change", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    ui_set_value(level, 45);
+    ui_update();
+    scene_done("ui_same", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+}
+
+#if FRAME_BUFFER_BPP == 16
+#define COMP_SPRITE 16
+#define COMP_PANEL_W 120
+#define COMP_PANEL_H 30
+static uint16_t *comp_back;
+static uint16_t comp_sprite[COMP_SPRITE * COMP_SPRITE];
+static uint16_t comp_panel[COMP_PANEL_W * COMP_PANEL_H];
+static int16_t sprite_x, sprite_y;
+
+/**
+ * @brief Composites one pixel bottom-up, the result the compositor must match.
+ */
+static uint16_t comp_pixel(uint16_t x, uint16_t y) {
+    uint16_t c = comp_back[y * TFT_WIDTH + x];
+    int16_t sx = x - sprite_x, sy = y - sprite_y;
+    if (sx >= 0 && sx < COMP_SPRITE && sy >= 0 && sy < COMP_SPRITE && comp_sprite[sy * COMP_SPRITE + sx] != 0x0000) {
+        c = comp_sprite[sy * COMP_SPRITE + sx];
+    }
+    int16_t px = x - 8, py = y - 200;
+    if (px >= 0 && px < COMP_PANEL_W && py >= 0 && py < COMP_PANEL_H) {
+        c = blend565(comp_panel[py * COMP_PANEL_W + px], c, ALPHA8_TO_5(160));
+    }
+    return c;
+}
+
+static void scene_compositor(const char *assets) {
+    comp_back = malloc(TFT_WIDTH * TFT_HEIGHT * 2);
+    for (uint32_t i = 0; i < TFT_WIDTH * TFT_HEIGHT; i++) {
+        comp_back[i] = rgb888_to_rgb565(i % TFT_WIDTH, (i / TFT_WIDTH) & 0xFF, 0x40);
+    }
+    for (int i = 0; i < COMP_SPRITE * COMP_SPRITE; i++) {
+        int x = i % COMP_SPRITE - 8, y = i / COMP_SPRITE - 8;
+        comp_sprite[i] = (x * x + y * y < 56) ? COLOR(5) : 0x0000;
+    }
+
+    comp_init(COLOR(0));
+    comp_layer_attach(0, comp_back, NULL, TFT_WIDTH, TFT_HEIGHT, COMP_OPAQUE);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/1.bin", assets);
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        fclose(file);
+        comp_layer_load(0, path);
+    }
+    comp_layer_attach(1, comp_sprite, NULL, COMP_SPRITE, COMP_SPRITE, COMP_KEYED);
+    sprite_x = 20;
+    sprite_y = 40;
+    comp_layer_move(1, sprite_x, sprite_y);
+    comp_layer_attach(2, comp_panel, NULL, COMP_PANEL_W, COMP_PANEL_H, COMP_ALPHA);
+    comp_layer_move(2, 8, 200);
+    comp_layer_set_alpha(2, 160);
+    comp_layer_fill(2, 0, 0, COMP_PANEL_W - 1, COMP_PANEL_H - 1, COLOR(4));
+    comp_layer_text(2, 4, 4, "score 0", COLOR(1), 2, font);
+    comp_update();
+    scene_done("comp", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, comp_pixel));
+
+    sprite_x = 30;
+    sprite_y = 195;
+    comp_layer_move(1, sprite_x, sprite_y);
+    comp_layer_fill(2, 4 + 6 * FONT_WIDTH * 2, 4, 4 + 7 * FONT_WIDTH * 2 - 1, 4 + FONT_HEIGHT * 2 - 1, COLOR(4));
+    comp_layer_text(2, 4 + 6 * FONT_WIDTH * 2, 4, "7", COLOR(1), 2, font);
+    comp_update();
+    scene_done("comp_move", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, comp_pixel));
+
+    comp_update();
+    scene_done("comp_same", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, comp_pixel));
+    free(comp_back);
+}
+#endif
+
+#define BACKING_DOTS 12
+#define BACKING_SQUARE 15
+
+/**
+ * @brief Returns the color of the checkerboard the backing store scenes draw on.
+ */
+static uint16_t checker_pixel(uint16_t x, uint16_t y) {
+    return colors[((x / BACKING_SQUARE) + (y / BACKING_SQUARE)) % 2 ? 8 : 4];
+}
+
+/**
+ * @brief Draws the dots of one frame over what the backing stores saved.
+ */
+static void backing_frame(backing_t *dots, uint16_t frame) {
+    backing_begin();
+    for (int i = BACKING_DOTS - 1; i >= 0; i--) backing_restore(&dots[i]);
+    for (int i = 0; i < BACKING_DOTS; i++) {
+        int16_t x = 10 + (i * 11 + frame * 3) % (TFT_WIDTH - 20);
+        int16_t y = 10 + (i * 19 + frame * 5) % (TFT_HEIGHT - 20);
+        backing_save(&dots[i], x - 4, y - 4, x + 4, y + 4);
+        draw_circle(x, y, 4, COLOR(2 + i % 6));
+    }
+    backing_flush();
+}
+
+static void scene_backing(void) {
+    backing_t dots[BACKING_DOTS];
+    for (int i = 0; i < BACKING_DOTS; i++) {
+        if (!backing_init(&dots[i], 9, 9)) {
+            ESP_LOGE(TAG, "no memory for the backing stores");
+            failures++;
+            return;
+        }
+    }
+    for (uint16_t y = 0; y < TFT_HEIGHT; y += BACKING_SQUARE) {
+        for (uint16_t x = 0; x < TFT_WIDTH; x += BACKING_SQUARE) {
+            bool dark = ((x / BACKING_SQUARE) + (y / BACKING_SQUARE)) % 2;
+            draw_rectangle(x, y, x + BACKING_SQUARE - 1, y + BACKING_SQUARE - 1, COLOR(dark ? 8 : 4));
+        }
+    }
+    backing_frame(dots, 0);
+    flush_frame_buffer();
+    scene_done("backing", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    for (uint16_t frame = 1; frame <= 4; frame++) backing_frame(dots, frame);
+    scene_done("backing_move", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+
+    backing_begin();
+    for (int i = BACKING_DOTS - 1; i >= 0; i--) backing_restore(&dots[i]);
+    backing_flush();
+    scene_done("backing_gone", compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, checker_pixel));
+    for (int i = 0; i < BACKING_DOTS; i++) backing_free(&dots[i]);
+}
+
+#if FRAME_BUFFER_BPP == 16
+static void scene_dither(void) {
+    static uint8_t rgb[TFT_WIDTH * 3];
+    uint16_t *fb = get_frame_buffer();
+    dither_t d;
+    if (!dither_init(&d, DITHER_DIFFUSION, TFT_WIDTH)) {
+        ESP_LOGE(TAG, "no memory for the error buffer");
+        failures++;
+        return;
+    }
+    uint32_t wrong = 0;
+    for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+        for (uint16_t x = 0; x < TFT_WIDTH; x++) {
+            rgb[3 * x] = x * 255 / (TFT_WIDTH - 1);
+            rgb[3 * x + 1] = y * 255 / (TFT_HEIGHT - 1);
+            rgb[3 * x + 2] = 0x60;
+        }
+        rgb888_to_rgb565_row(&d, rgb, &fb[y * TFT_WIDTH]);
+
+        uint16_t plain[TFT_WIDTH];
+        dither_t none = {.mode = DITHER_NONE, .width = TFT_WIDTH};
+        rgb888_to_rgb565_row(&none, rgb, plain);
+        for (uint16_t x = 0; x < TFT_WIDTH; x++) {
+            if (plain[x] != rgb888_to_rgb565(rgb[3 * x], rgb[3 * x + 1], rgb[3 * x + 2])) wrong++;
+        }
+    }
+    dither_free(&d);
+    flush_frame_buffer();
+    scene_done("dither", wrong + compare(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, frame_pixel));
+}
+#endif
+
+int main(int argc, char **argv) {
+    const char *assets = (argc > 1) ? argv[1] : "../spiffs_image";
+    out_dir = (argc > 2) ? argv[2] : ".";
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/font.bin", assets);
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        fread(font, 1, sizeof(font), file);
+        fclose(file);
+    } else {
+        ESP_LOGW(TAG, "no %s, text is not drawn", path);
+    }
+
+    printf("%-12s %8s %8s %9s %8s %6s %8s\n",
+           "scene", "commands", "trans", "bytes", "pixels", "window", "wire us");
+#if ST7789_TRACE
+    trace_start();
+#endif
+    INIT();
+#if FRAME_BUFFER_BPP != 16
+    palette_set(0, colors, NUM_COLORS);
+#endif
+    scene_done("init", 0);
+#if ST7789_RECORD
+    snprintf(path, sizeof(path), "%s/session.rec", out_dir);
+    record_start(path);
+#endif
+    scene_shapes();
+    scene_text();
+    scene_image(assets);
+    scene_jpeg(assets);
+    scene_direct_fill();
+#if FRAME_BUFFER_BPP == 16
+    scene_dlist();
+#endif
+    scene_ui();
+#if FRAME_BUFFER_BPP == 16
+    scene_compositor(assets);
+#endif
+    scene_backing();
+#if FRAME_BUFFER_BPP == 16
+    scene_dither();
+#endif
+#if ST7789_RECORD
+    record_stop();
+#endif
+#if ST7789_TRACE
+    trace_dump();
+#endif
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
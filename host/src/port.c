@@ -0,0 +1,37 @@
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include <time.h>
+
+//Host implementations of the few ESP-IDF and FreeRTOS calls the driver makes.
+
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds.
+ */
+static uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * @brief Does not sleep: the emulated panel needs no reset or wake-up time.
+ */
+void vTaskDelay(TickType_t ticks) {
+    (void)ticks;
+}
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds, truncated to 32 bits.
+ */
+uint32_t esp_cpu_get_cycle_count(void) {
+    return (uint32_t)host_now_ns();
+}
+
+/**
+ * @brief Returns the monotonic clock in microseconds.
+ */
+int64_t esp_timer_get_time(void) {
+    return host_now_ns() / 1000;
+}
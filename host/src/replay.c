@@ -0,0 +1,52 @@
+#include "st7789.h"
+#include "st7789_indexed.h"
+#include "st7789_record.h"
+#include "st7789_emulator.h"
+#include <stdlib.h>
+
+//Replays a draw call log on the panel emulator and prints the timings of
+//every pass and the wire cost of one pass. The palette of indexed builds is
+//the one of st7789_host.
+//Usage: st7789_replay <log> [assets dir] [passes]
+
+static uint8_t font[(FONT_END - FONT_START) * FONT_HEIGHT];
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: st7789_replay <log> [assets dir] [passes]\n");
+        return EXIT_FAILURE;
+    }
+    const char *assets = (argc > 2) ? argv[2] : "../spiffs_image";
+    int passes = (argc > 3) ? atoi(argv[3]) : 5;
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/font.bin", assets);
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        fread(font, 1, sizeof(font), file);
+        fclose(file);
+    }
+
+    INIT();
+#if FRAME_BUFFER_BPP != 16
+    static const uint16_t colors[] = {
+        0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F,
+        0xFFE0, 0xF81F, 0x07FF, 0xAAAA, 0x5555
+    };
+    palette_set(0, colors, sizeof(colors) / sizeof(colors[0]));
+#endif
+
+    for (int n = 0; n < passes; n++) {
+        emu_counters_t c;
+        emu_take_counters(&c);
+        replay_result_t result;
+        if (!record_replay(argv[1], font, assets, &result)) return EXIT_FAILURE;
+        record_log_result(&result);
+        emu_take_counters(&c);
+        if (n == 0) {
+            printf("one pass: %lu transactions, %lu bytes, %lu us on the wire\n",
+                   (unsigned long)c.transactions, (unsigned long)c.bytes, (unsigned long)emu_wire_us(&c));
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,354 @@
+#include "st7789_emulator.h"
+
+#define MAX_PARAMS 8
+
+static const char *TAG = "emulator";
+
+static uint8_t gram[EMU_GRAM_HEIGHT][EMU_GRAM_WIDTH][3]; //RGB888
+
+static uint32_t dc;
+static uint8_t cmd = NOP;
+static uint8_t params[MAX_PARAMS];
+static uint8_t param_count;
+static uint8_t pixel_bytes[3];
+static uint8_t pixel_fill;
+
+static bool sleeping, display_on, inverted;
+static uint8_t colmod, madctl, backlight_duty;
+static uint16_t xs, xe, ys, ye; //address window
+static uint16_t col, row; //write pointer inside the window
+static uint16_t scroll_top, scroll_height, scroll_start; //VSCRDEF TFA and VSA, VSCSAD
+
+static uint16_t view_x = X_OFFSET, view_y = Y_OFFSET;
+static uint16_t view_width = TFT_WIDTH, view_height = TFT_HEIGHT;
+
+static emu_counters_t totals, mark;
+
+
+/**
+ * @brief Puts the controller registers in their reset state. GRAM is kept.
+ */
+static void emu_reset(void) {
+    cmd = NOP;
+    param_count = 0;
+    pixel_fill = 0;
+    sleeping = true;
+    display_on = false;
+    inverted = false;
+    colmod = 0x66;
+    madctl = 0;
+    xs = 0; xe = EMU_GRAM_WIDTH - 1;
+    ys = 0; ye = EMU_GRAM_HEIGHT - 1;
+    col = 0; row = 0;
+    scroll_top = 0;
+    scroll_height = EMU_GRAM_HEIGHT;
+    scroll_start = 0;
+}
+
+/**
+ * @brief Clears GRAM and the counters and resets the controller.
+ */
+void emu_power_on(void) {
+    memset(gram, 0, sizeof(gram));
+    memset(&totals, 0, sizeof(totals));
+    memset(&mark, 0, sizeof(mark));
+    backlight_duty = 0;
+    dc = CMD_MODE;
+    emu_reset();
+}
+
+/**
+ * @brief Selects the part of GRAM that is visible on the board.
+ *
+ * Defaults to the 135x240 window of the TTGO T-Display at X_OFFSET, Y_OFFSET.
+ */
+void emu_set_viewport(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    view_x = x;
+    view_y = y;
+    view_width = width;
+    view_height = height;
+}
+
+/**
+ * @brief Returns the counters accumulated since the previous call.
+ *
+ * Called after every flush, this gives the wire cost of one frame.
+ */
+void emu_take_counters(emu_counters_t *out) {
+    out->commands = totals.commands - mark.commands;
+    out->transactions = totals.transactions - mark.transactions;
+    out->bytes = totals.bytes - mark.bytes;
+    out->pixels = totals.pixels - mark.pixels;
+    out->windows = totals.windows - mark.windows;
+    out->ram_writes = totals.ram_writes - mark.ram_writes;
+    out->unknown = totals.unknown - mark.unknown;
+    mark = totals;
+}
+
+/**
+ * @brief Returns the counters since power on.
+ */
+void emu_get_totals(emu_counters_t *out) {
+    *out = totals;
+}
+
+/**
+ * @brief Returns how long the counted bytes take on the wire at EMU_SPI_HZ.
+ */
+uint32_t emu_wire_us(const emu_counters_t *counters) {
+    return (uint64_t)counters->bytes * 8 * 1000000 / EMU_SPI_HZ;
+}
+
+/**
+ * @brief Stores one pixel at the write pointer and advances it.
+ *
+ * MADCTL mirroring is applied in logical coordinates before the row/column
+ * exchange, which matches the controller for the usual rotations.
+ */
+static void gram_store(uint8_t r, uint8_t g, uint8_t b) {
+    uint16_t width = (madctl & MADCTL_MV) ? EMU_GRAM_HEIGHT : EMU_GRAM_WIDTH;
+    uint16_t height = (madctl & MADCTL_MV) ? EMU_GRAM_WIDTH : EMU_GRAM_HEIGHT;
+    uint16_t c = (madctl & MADCTL_MX) ? width - 1 - col : col;
+    uint16_t l = (madctl & MADCTL_MY) ? height - 1 - row : row;
+    uint16_t x = (madctl & MADCTL_MV) ? l : c;
+    uint16_t y = (madctl & MADCTL_MV) ? c : l;
+
+    if (x < EMU_GRAM_WIDTH && y < EMU_GRAM_HEIGHT) {
+        uint8_t *p = gram[y][x];
+        p[0] = (madctl & MADCTL_BGR) ? b : r;
+        p[1] = g;
+        p[2] = (madctl & MADCTL_BGR) ? r : b;
+        totals.pixels++;
+    }
+
+    if (++col > xe) {
+        col = xs;
+        if (++row > ye) row = ys;
+    }
+}
+
+/**
+ * @brief Takes one byte of pixel data in the current COLMOD format.
+ */
+static void pixel_byte(uint8_t byte) {
+    pixel_bytes[pixel_fill++] = byte;
+
+    if ((colmod & 0x07) == 0x05) {
+        if (pixel_fill < 2) return;
+        uint16_t c = (pixel_bytes[0] << 8) | pixel_bytes[1];
+        uint8_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+        gram_store((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    } else {
+        if (pixel_fill < 3) return;
+        gram_store(pixel_bytes[0] & 0xFC, pixel_bytes[1] & 0xFC, pixel_bytes[2] & 0xFC);
+    }
+    pixel_fill = 0;
+}
+
+/**
+ * @brief Applies a command once all of its parameters have arrived.
+ */
+static void param_byte(uint8_t byte) {
+    if (param_count < MAX_PARAMS) params[param_count++] = byte;
+
+    switch (cmd) {
+        case CASET:
+            if (param_count == 4) {
+                xs = (params[0] << 8) | params[1];
+                xe = (params[2] << 8) | params[3];
+            }
+            break;
+        case RASET:
+            if (param_count == 4) {
+                ys = (params[0] << 8) | params[1];
+                ye = (params[2] << 8) | params[3];
+            }
+            break;
+        case COLMOD:
+            colmod = params[0];
+            break;
+        case MADCTL:
+            madctl = params[0];
+            break;
+        case VSCRDEF:
+            if (param_count == 6) {
+                scroll_top = (params[0] << 8) | params[1];
+                scroll_height = (params[2] << 8) | params[3];
+            }
+            break;
+        case VSCSAD:
+            if (param_count == 2) scroll_start = (params[0] << 8) | params[1];
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Starts a new command.
+ */
+static void command_byte(uint8_t byte) {
+    cmd = byte;
+    param_count = 0;
+    pixel_fill = 0;
+    totals.commands++;
+
+    switch (cmd) {
+        case NOP: break;
+        case SWRESET: emu_reset(); break;
+        case SLPIN: sleeping = true; break;
+        case SLPOUT: sleeping = false; break;
+        case PTLON: case NORON: break;
+        case INVOFF: inverted = false; break;
+        case INVON: inverted = true; break;
+        case DISPOFF: display_on = false; break;
+        case DISPON: display_on = true; break;
+        case CASET: case RASET: totals.windows++; break;
+        case RAMWR: col = xs; row = ys; totals.ram_writes++; break;
+        case RAMWRC: totals.ram_writes++; break;
+        case COLMOD: case MADCTL: case VSCRDEF: case VSCSAD: break;
+        case PORCTRL: case GCTRL: case VCOMS: case POWSAVE: case TEON: break;
+        default:
+            totals.unknown++;
+            ESP_LOGW(TAG, "unknown command 0x%02X", cmd);
+            break;
+    }
+}
+
+/**
+ * @brief Decodes one transaction. The D/C level tells commands from data.
+ */
+static void emu_write(const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    totals.transactions++;
+    totals.bytes += size;
+
+    for (size_t i = 0; i < size; i++) {
+        if (dc == CMD_MODE) {
+            command_byte(bytes[i]);
+        } else if (cmd == RAMWR || cmd == RAMWRC) {
+            pixel_byte(bytes[i]);
+        } else {
+            param_byte(bytes[i]);
+        }
+    }
+}
+
+static void emu_init(void) {
+    emu_power_on();
+}
+
+static void emu_set_dc(uint32_t level) {
+    dc = level;
+}
+
+/**
+ * @brief A low reset pin puts the controller back in its reset state.
+ */
+static void emu_set_reset(uint32_t level) {
+    if (level == 0) emu_reset();
+}
+
+/**
+ * @brief Queued writes are decoded at once, there is nothing to wait for.
+ */
+static void emu_wait(void) {
+}
+
+static void emu_backlight(uint8_t duty) {
+    backlight_duty = duty;
+}
+
+/**
+ * @brief Returns the last backlight duty cycle.
+ */
+uint8_t emu_get_backlight(void) {
+    return backlight_duty;
+}
+
+static const st7789_transport_t emu_transport = {
+    .init = emu_init,
+    .set_dc = emu_set_dc,
+    .set_reset = emu_set_reset,
+    .write = emu_write,
+    .queue = emu_write,
+    .wait = emu_wait,
+    .backlight = emu_backlight,
+};
+
+/**
+ * @brief Returns the transport of the host build: the panel emulator.
+ */
+const st7789_transport_t *st7789_default_transport(void) {
+    return &emu_transport;
+}
+
+/**
+ * @brief Returns a GRAM pixel as RGB565.
+ *
+ * @param x Physical column, 0 to EMU_GRAM_WIDTH - 1.
+ * @param y Physical line, 0 to EMU_GRAM_HEIGHT - 1.
+ */
+uint16_t emu_get_gram(uint16_t x, uint16_t y) {
+    if (x >= EMU_GRAM_WIDTH || y >= EMU_GRAM_HEIGHT) return 0;
+    const uint8_t *p = gram[y][x];
+    return ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+}
+
+/**
+ * @brief Returns the RGB888 color a panel line shows at a column.
+ *
+ * Applies vertical scrolling, inversion, sleep and display off.
+ */
+static void displayed_rgb(uint16_t x, uint16_t y, uint8_t rgb[3]) {
+    if (sleeping || !display_on || x >= EMU_GRAM_WIDTH || y >= EMU_GRAM_HEIGHT) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+    if (y >= scroll_top && y < scroll_top + scroll_height && scroll_height) {
+        y = scroll_top + (y - scroll_top + scroll_start - scroll_top + scroll_height) % scroll_height;
+    }
+    const uint8_t *p = gram[y][x];
+    bool invert = inverted != EMU_PANEL_INVERTED;
+    for (int i = 0; i < 3; i++) rgb[i] = invert ? 255 - p[i] : p[i];
+}
+
+/**
+ * @brief Returns the pixel the board shows, as RGB565.
+ *
+ * @param x Column inside the viewport.
+ * @param y Line inside the viewport.
+ */
+uint16_t emu_get_pixel(uint16_t x, uint16_t y) {
+    uint8_t rgb[3];
+    displayed_rgb(view_x + x, view_y + y, rgb);
+    return ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+}
+
+/**
+ * @brief Writes what the panel shows as a binary PPM file.
+ *
+ * @param path The file to write.
+ * @param full_gram true for all of GRAM, false for the viewport only.
+ * @return false if the file could not be written.
+ */
+bool emu_write_ppm(const char *path, bool full_gram) {
+    uint16_t x0 = full_gram ? 0 : view_x, y0 = full_gram ? 0 : view_y;
+    uint16_t width = full_gram ? EMU_GRAM_WIDTH : view_width;
+    uint16_t height = full_gram ? EMU_GRAM_HEIGHT : view_height;
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "cannot write %s", path);
+        return false;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            uint8_t rgb[3];
+            displayed_rgb(x0 + x, y0 + y, rgb);
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    return fclose(file) == 0;
+}
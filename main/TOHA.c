@@ -1,21 +1,44 @@
 #include "st7789.h"
+#include "st7789_shapes.h"
+#include "st7789_indexed.h"
+#include "st7789_fxmath.h"
+#include "st7789_fields.h"
+#include "st7789_parallel.h"
+#include "st7789_particles.h"
+#include "st7789_perf.h"
+#include "st7789_trace.h"
+#include "st7789_record.h"
+#include "st7789_backing.h"
+#include "effect.h"
+#include "workload.h"
+#include "bench.h"
 #include "esp_timer.h"
 #include <stdio.h>
 #include <string.h>
-#include <math.h>
+#include <stdlib.h>
 
 
 uint8_t font_data[(FONT_END - FONT_START) * FONT_HEIGHT]; 
 
 
 #define TEST_DURATION_SEC 999
-#define M_PI 3.14159265358979323846
-void draw_circle(uint16_t x0, uint16_t y0, uint16_t r, uint16_t color);
+#define RUN_BENCHMARKS 0
+#define RUN_WORKLOADS 0 //loop the benchmark workloads instead of the demo
+#define RECORD_SESSION "/spiffs/session.rec" //first demo cycle with ST7789_RECORD, replayed after every cycle
+#define ASSET_STORAGE STORAGE_SPIFFS //where the font and images are read from, see ixora_storage.h
 
 uint16_t colors[] = {
     0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F,
     0xFFE0, 0xF81F, 0x07FF, 0xAAAA, 0x5555
 };
+#define NUM_COLORS (sizeof(colors) / sizeof(colors[0]))
+
+//palette effects draw colors[i]; with an indexed frame buffer they draw index i
+#if FRAME_BUFFER_BPP == 16
+#define EFFECT_COLOR(i) colors[i]
+#else
+#define EFFECT_COLOR(i) (i)
+#endif
 
 static uint16_t frame_buffer[TFT_WIDTH * TFT_HEIGHT];
 
@@ -23,181 +46,115 @@ static uint16_t frame_buffer[TFT_WIDTH * TFT_HEIGHT];
 
 static uint16_t frame_buffer[TFT_WIDTH * TFT_HEIGHT];
 
-void draw_tunnel_3d() {
-    uint32_t start_time = esp_timer_get_time() / 1000000;
-    while ((esp_timer_get_time() / 1000000 - start_time) < 5) {  
-        clear_frame_buffer(0x0000);
-        float t = (esp_timer_get_time() / 1000000 - start_time) * 0.5f;  
-        for (int y = 0; y < TFT_HEIGHT; y++) {
-            for (int x = 0; x < TFT_WIDTH; x++) {
-                float fx = (x - TFT_WIDTH / 2.0f) / (TFT_WIDTH / 2.0f);
-                float fy = (y - TFT_HEIGHT / 2.0f) / (TFT_HEIGHT / 2.0f);
-                float radius = sqrtf(fx * fx + fy * fy);
-                float value = logf(radius * 20 + 1) + t;
-                int color_index = ((int)(value * 10)) % 10;
-                if (color_index < 0) color_index = -color_index;
-                draw_pixel(x, y, colors[color_index]);
-            }
-        }
-        flush_frame_buffer();
-    }
+//Cycles through the effect colors once per 256 field phase units
+static void effect_lut_init(uint16_t *lut) {
+    uint16_t cycle[NUM_COLORS];
+    for (int i = 0; i < NUM_COLORS; i++) cycle[i] = EFFECT_COLOR(i);
+    field_lut_cycle(lut, cycle, NUM_COLORS);
 }
 
+typedef struct {
+    const uint8_t *map;
+    const uint16_t *lut;
+    uint8_t offset;
+} field_frame_t;
 
-void draw_matrix_effect() {
-    char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    int columns = TFT_WIDTH / 8;
-    int drops[columns];
-    for (int i = 0; i < columns; i++) drops[i] = rand() % TFT_HEIGHT;
-    uint32_t start_time = esp_timer_get_time() / 1000000;
-    while ((esp_timer_get_time() / 1000000 - start_time) < 10) {
-        clear_frame_buffer(0x0000);
-        for (int i = 0; i < columns; i++) {
-            int char_index = rand() % (sizeof(charset) - 1);
-            draw_char_scaled(i * 8, drops[i], charset[char_index], 0x07E0, 1, font_data);
-            if (++drops[i] * 8 >= TFT_HEIGHT) drops[i] = 0;
-        }
-        flush_frame_buffer();
-        vTaskDelay(pdMS_TO_TICKS(100));
+//Row shader for parallel_rows that renders one row of a field map
+static void field_row(int16_t y, void *arg) {
+    const field_frame_t *frame = arg;
+    field_render_rows(frame->map, frame->offset, frame->lut, y, y);
+}
+
+
+//Effect state lives in file-scope statics, the scheduler runs one effect at a time
+
+static uint32_t effect_frame;
+static uint8_t *effect_map;
+static uint16_t effect_lut[FIELD_LUT_SIZE];
+static uint32_t effect_time_ms;
+
+static bool effect_frame_init(void) {
+    effect_frame = 0;
+    return true;
+}
+
+static void effect_frame_step(uint32_t dt_ms) {
+    effect_frame++;
+}
+
+static void effect_time_step(uint32_t dt_ms) {
+    effect_time_ms += dt_ms;
+}
+
+static void effect_map_teardown(void) {
+    free(effect_map);
+    effect_map = NULL;
+}
+
+
+static void bars_render(void) {
+    uint16_t phase = (effect_frame * 3) % TFT_WIDTH;
+    for (uint16_t x = 0; x < TFT_WIDTH; x++) {
+        draw_rectangle(x, 0, x, TFT_HEIGHT - 1, EFFECT_COLOR((abs(x - phase) / 20) % NUM_COLORS));
     }
 }
 
-void draw_bouncing_ball() {
-    float x = TFT_WIDTH / 2, y = TFT_HEIGHT / 2, vx = 2, vy = 2;
-    float radius = 10;
-    uint32_t start_time = esp_timer_get_time() / 1000000;
-    while ((esp_timer_get_time() / 1000000 - start_time) < 15) {
-        clear_frame_buffer(0x0000);
-        x += vx; y += vy;
-        if (x - radius < 0 || x + radius > TFT_WIDTH) vx = -vx;
-        if (y - radius < 0 || y + radius > TFT_HEIGHT) vy = -vy;
-          draw_circle(x, y, radius, 0xF800);
-          flush_frame_buffer();
-          vTaskDelay(pdMS_TO_TICKS(33));
-      }
-  }
-  
-
-  void draw_water_filling() {
-      const int NUM_PARTICLES = 50;
-      
-      struct Particle {
-          int x;          
-          float y;
-          float speed;
-          bool active;    
-      };
-      struct Particle particles[NUM_PARTICLES];
-  
-
-      int water_level[TFT_WIDTH];
-      for (int x = 0; x < TFT_WIDTH; x++) {
-          water_level[x] = TFT_HEIGHT;
-      }
-      
-      for (int i = 0; i < NUM_PARTICLES; i++) {
-          particles[i].x = rand() % TFT_WIDTH;
-          particles[i].y = 0;
-          particles[i].speed = (rand() % 3) + 4;
-          particles[i].active = true;
-      }
-      
-      uint32_t start_time = esp_timer_get_time() / 1000000;
-      
-      while ((esp_timer_get_time() / 1000000 - start_time) < 30) {
-          clear_frame_buffer(0x0000);
-          
-          for (int x = 0; x < TFT_WIDTH; x++) {
-              if (water_level[x] < TFT_HEIGHT) {
-                  draw_rectangle(x, water_level[x], x, TFT_HEIGHT - 1, 0x001F);
-              }
-          }
-          
-          for (int i = 0; i < NUM_PARTICLES; i++) {
-              if (particles[i].active) {
-                  particles[i].y += particles[i].speed;
-                  int col = particles[i].x;
-                  if ((int)particles[i].y >= water_level[col] - 1) {
-                      particles[i].y = water_level[col] - 1;
-                      if (water_level[col] > 0) {
-                          water_level[col] = (int)particles[i].y;
-                      }
-                      particles[i].active = false;
-                  } else {
-                      draw_pixel(particles[i].x, (int)particles[i].y, 0x001F);
-                  }
-              } else {
-                  int col = rand() % TFT_WIDTH;
-                  if (water_level[col] > 0) {
-                      particles[i].x = col;
-                      particles[i].y = 0;
-                      particles[i].speed = (rand() % 3) + 4;
-                      particles[i].active = true;
-                  }
-              }
-          }
-          
-          flush_frame_buffer();
-          vTaskDelay(pdMS_TO_TICKS(33));
-      }
-  }
-  
-
-  void draw_plasma_effect() {
-    uint32_t start_time = esp_timer_get_time() / 1000000;
-    while ((esp_timer_get_time() / 1000000 - start_time) < 15) {
-        clear_frame_buffer(0x0000);
-        
-        float t = (esp_timer_get_time() / 1000000 - start_time) * 0.1f;
-        
-        for (int y = 0; y < TFT_HEIGHT; y++) {
-            for (int x = 0; x < TFT_WIDTH; x++) {
-                float v = sinf(x / 10.0f + t) + sinf(y / 15.0f + t) + sinf((x + y) / 20.0f + t);
-                int color_index = ((int)((v + 3) * 1.5f)) % 10;
-                if (color_index < 0) color_index = -color_index;
-                draw_pixel(x, y, colors[color_index]);
-            }
-        }
-        flush_frame_buffer();
+static const effect_t effect_bars = {
+    .name = "bars", .duration_ms = 2000, .step_ms = 16,
+    .init = effect_frame_init, .step = effect_frame_step, .render = bars_render,
+};
 
+
+static void spiral_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    for (int r = 0; r < 60; r += 2) {
+        uint16_t angle = FX_ANGLE_FROM_DEG(effect_frame * 5 + r * 3);
+        uint16_t x = TFT_WIDTH / 2 + ((r * fx_cos(angle)) >> 15);
+        uint16_t y = TFT_HEIGHT / 2 + ((r * fx_sin(angle)) >> 15);
+        draw_circle(x, y, 5, EFFECT_COLOR(r % NUM_COLORS));
     }
 }
 
+static const effect_t effect_spiral = {
+    .name = "spiral", .duration_ms = 4000, .step_ms = 30,
+    .init = effect_frame_init, .step = effect_frame_step, .render = spiral_render,
+};
 
-void draw_fireworks() {
-    struct Particle {
-        float x, y, vx, vy;
-        uint16_t color;
-    } particles[50];
 
-    for (int i = 0; i < 50; i++) {
-        particles[i].x = TFT_WIDTH / 2;
-        particles[i].y = TFT_HEIGHT / 2;
-        particles[i].vx = (rand() % 200 - 100) / 50.0;
-        particles[i].vy = (rand() % 200 - 100) / 50.0;
-        particles[i].color = colors[rand() % 10];
+static void rectangles_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(1));
+    for (int n = 0; n < 8; n++) {
+        uint16_t pos = rand() % TFT_WIDTH;
+        draw_rectangle(pos, 0, pos, TFT_HEIGHT - 1, EFFECT_COLOR(0));
+        pos = rand() % TFT_HEIGHT;
+        draw_rectangle(0, pos, TFT_WIDTH - 1, pos, EFFECT_COLOR(0));
     }
-    
-    uint32_t start_time = esp_timer_get_time() / 1000000;
-    while ((esp_timer_get_time() / 1000000 - start_time) < 10) {
-        clear_frame_buffer(0x0000);
-        for (int i = 0; i < 50; i++) {
-            particles[i].x += particles[i].vx;
-            particles[i].y += particles[i].vy;
-            particles[i].vy += 0.05;  
-            if (particles[i].y > TFT_HEIGHT) {
-                particles[i].x = TFT_WIDTH / 2;
-                particles[i].y = TFT_HEIGHT / 2;
-                particles[i].vx = (rand() % 200 - 100) / 50.0;
-                particles[i].vy = (rand() % 200 - 100) / 50.0;
-            }
-            draw_pixel((int)particles[i].x, (int)particles[i].y, particles[i].color);
-        }
-        flush_frame_buffer();
-        vTaskDelay(pdMS_TO_TICKS(33));
+    for (int n = 0; n < 15; n++) {
+        uint16_t color = EFFECT_COLOR(rand() % 4 + 2);
+        uint16_t x1 = rand() % (TFT_WIDTH - 20);
+        uint16_t y1 = rand() % (TFT_HEIGHT - 20);
+        draw_rectangle(x1, y1, x1 + rand() % 30 + 10, y1 + rand() % 30 + 10, color);
     }
 }
 
+static const effect_t effect_rectangles = {
+    .name = "rectangles", .duration_ms = 5000, .step_ms = 250,
+    .render = rectangles_render,
+};
+
+
+static void scroll_text_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    draw_text_scaled(TFT_WIDTH / 4, (int)effect_frame * 2 - 20, "STRESS TEST",
+                     EFFECT_COLOR(1), 1, font_data);
+}
+
+static const effect_t effect_scroll_text = {
+    .name = "scroll text", .duration_ms = 3900, .step_ms = 30,
+    .init = effect_frame_init, .step = effect_frame_step, .render = scroll_text_render,
+};
+
+
 void draw_chessboard(uint16_t square_size, uint16_t color1, uint16_t color2) {
     for (uint16_t y = 0; y < TFT_HEIGHT; y += square_size) {
         for (uint16_t x = 0; x < TFT_WIDTH; x += square_size) {
@@ -205,260 +162,618 @@ void draw_chessboard(uint16_t square_size, uint16_t color1, uint16_t color2) {
             draw_rectangle(x, y, x + square_size - 1, y + square_size - 1, color);
         }
     }
-    flush_frame_buffer();
 }
 
-void draw_moving_dots() {
-    for (int t = 0; t < 100; t++) {
-        clear_frame_buffer(0x0000);
-        for (int i = 0; i < 20; i++) {
-            int x = (sin(t * 0.1 + i) * 40) + (TFT_WIDTH / 2);
-            int y = (cos(t * 0.1 + i) * 40) + (TFT_HEIGHT / 2);
-            draw_circle(x, y, 2, 0xFFFF);
+static void chessboard_render(void) {
+    draw_chessboard(20, EFFECT_COLOR(0), EFFECT_COLOR(1));
+}
+
+static const effect_t effect_chessboard = {
+    .name = "chessboard", .duration_ms = 100, .step_ms = 100, .hold_ms = 2000,
+    .render = chessboard_render,
+};
+
+
+//The dots and the ball move over a static background. Every object has a
+//backing store that puts back what was under it before it moves, and only
+//the boxes the objects left and entered are sent
+
+#define BACKING_IMAGE "/spiffs/1.bin"
+#define DOT_COUNT 20
+#define DOT_RADIUS 2
+
+static backing_t effect_backing[DOT_COUNT];
+static uint8_t effect_backing_count;
+
+static void backing_effect_teardown(void) {
+    for (uint8_t i = 0; i < effect_backing_count; i++) backing_free(&effect_backing[i]);
+    effect_backing_count = 0;
+}
+
+//Allocates the stores of count objects of up to box x box pixels and sends
+//the background, the image with an RGB565 frame buffer, else a chessboard
+static bool backing_effect_init(uint8_t count, uint16_t box) {
+    effect_frame = 0;
+    for (effect_backing_count = 0; effect_backing_count < count; effect_backing_count++) {
+        if (!backing_init(&effect_backing[effect_backing_count], box, box)) {
+            backing_effect_teardown();
+            return false;
         }
-        flush_frame_buffer();
-        vTaskDelay(pdMS_TO_TICKS(50));
     }
+#if FRAME_BUFFER_BPP == 16
+    bool loaded = backing_load(BACKING_IMAGE);
+#else
+    bool loaded = false;
+#endif
+    if (!loaded) draw_chessboard(20, EFFECT_COLOR(8), EFFECT_COLOR(9));
+    flush_frame_buffer();
+    return true;
 }
 
-void draw_pixel_explosion() {
-    clear_frame_buffer(0x0000);
-    for (int i = 0; i < 333; i++) {
+static void backing_effect_present(void) {
+    backing_flush();
+}
+
+static bool moving_dots_init(void) {
+    return backing_effect_init(DOT_COUNT, 2 * DOT_RADIUS + 1);
+}
+
+static void moving_dots_render(void) {
+    backing_begin();
+    for (int i = DOT_COUNT - 1; i >= 0; i--) backing_restore(&effect_backing[i]);
+    for (int i = 0; i < DOT_COUNT; i++) {
+        uint16_t angle = (effect_frame * FX_ANGLE_PER_RAD) / 10 + i * FX_ANGLE_PER_RAD;
+        int x = ((fx_sin(angle) * 40) >> 15) + (TFT_WIDTH / 2);
+        int y = ((fx_cos(angle) * 40) >> 15) + (TFT_HEIGHT / 2);
+        backing_save(&effect_backing[i], x - DOT_RADIUS, y - DOT_RADIUS, x + DOT_RADIUS, y + DOT_RADIUS);
+        draw_circle(x, y, DOT_RADIUS, EFFECT_COLOR(1));
+    }
+}
+
+static const effect_t effect_moving_dots = {
+    .name = "moving dots", .duration_ms = 5000, .step_ms = 50, .hold_ms = 2000,
+    .init = moving_dots_init, .step = effect_frame_step, .render = moving_dots_render,
+    .present = backing_effect_present, .teardown = backing_effect_teardown,
+};
+
+
+//The explosion and moire effects accumulate: their steps draw straight into
+//the frame buffer and there is nothing to render
+
+static bool accumulate_init(void) {
+    effect_frame = 0;
+    clear_frame_buffer(EFFECT_COLOR(0));
+    return true;
+}
+
+static void pixel_explosion_step(uint32_t dt_ms) {
+    for (uint32_t n = 0; n < dt_ms / 5; n++) {
+        int i = effect_frame++;
         int x = TFT_WIDTH / 2 + (rand() % (i + 1) - i / 2);
         int y = TFT_HEIGHT / 2 + (rand() % (i + 1) - i / 2);
-        draw_pixel(x, y, 0xFFFF);
-        flush_frame_buffer();
-        vTaskDelay(pdMS_TO_TICKS(5));
+        draw_pixel(x, y, EFFECT_COLOR(1));
+    }
+}
+
+static const effect_t effect_pixel_explosion = {
+    .name = "pixel explosion", .duration_ms = 1670, .step_ms = 10, .hold_ms = 2000,
+    .init = accumulate_init, .step = pixel_explosion_step,
+};
+
+
+static void moire_step(uint32_t dt_ms) {
+    int i = effect_frame++;
+    for (int angle = 0; angle < 360; angle += 10) {
+        int x = TFT_WIDTH / 2 + ((i * fx_cos(FX_ANGLE_FROM_DEG(angle))) >> 15);
+        int y = TFT_HEIGHT / 2 + ((i * fx_sin(FX_ANGLE_FROM_DEG(angle))) >> 15);
+        draw_pixel(x, y, EFFECT_COLOR(1));
+    }
+    for (int angle = 0; angle < 360; angle += 10) {
+        int x = TFT_WIDTH / 3 + ((i * fx_cos((angle * FX_ANGLE_TURN) / 540)) >> 15);
+        int y = TFT_HEIGHT / 3 + ((i * fx_sin((angle * FX_ANGLE_TURN) / 540)) >> 15);
+        draw_pixel(x, y, EFFECT_COLOR(6));
+    }
+}
+
+static const effect_t effect_moire = {
+    .name = "moire", .duration_ms = 4500, .step_ms = 50, .hold_ms = 2000,
+    .init = accumulate_init, .step = moire_step,
+};
+
+
+#define FIREWORK_PARTICLES 2000
+#define FIREWORK_BURST 250
+
+static particle_system_t sparks;
+static uint16_t spark_colors[NUM_COLORS];
+static particle_emitter_t burst = {
+    .spread_x = 2 * PARTICLE_ONE,
+    .spread_y = 2 * PARTICLE_ONE,
+    .life = 60,
+    .life_spread = 30,
+    .colors = spark_colors,
+    .color_count = NUM_COLORS,
+};
+
+static bool fireworks_init(void) {
+    for (int i = 0; i < NUM_COLORS; i++) spark_colors[i] = EFFECT_COLOR(i);
+    if (!particle_system_init(&sparks, FIREWORK_PARTICLES, esp_timer_get_time())) return false;
+    sparks.ay = 3; //about 0.05 pixels per frame squared
+    effect_frame = 0;
+    return true;
+}
+
+static void fireworks_step(uint32_t dt_ms) {
+    if (effect_frame++ % 10 == 0) {
+        burst.x = PARTICLE_FROM_INT(particle_rand(&sparks) % TFT_WIDTH);
+        burst.y = PARTICLE_FROM_INT(particle_rand(&sparks) % (TFT_HEIGHT / 2));
+        particle_emit(&sparks, &burst, FIREWORK_BURST);
+    }
+    particle_update(&sparks);
+}
+
+static void fireworks_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    particle_render(&sparks);
+}
+
+static void fireworks_teardown(void) {
+    particle_system_free(&sparks);
+}
+
+static const effect_t effect_fireworks = {
+    .name = "fireworks", .duration_ms = 10000, .step_ms = 33, .hold_ms = 2000,
+    .init = fireworks_init, .step = fireworks_step, .render = fireworks_render, .teardown = fireworks_teardown,
+};
+
+
+static bool tunnel_init(void) {
+    effect_map = malloc(FIELD_MAP_SIZE);
+    if (effect_map == NULL) return false;
+    field_tunnel(effect_map, 20);
+    effect_lut_init(effect_lut);
+    effect_time_ms = 0;
+    return true;
+}
+
+static void tunnel_render(void) {
+    field_frame_t frame = {effect_map, effect_lut, effect_time_ms * 128 / 1000}; //half a cycle per second
+    parallel_rows(0, TFT_HEIGHT - 1, field_row, &frame);
+}
+
+static const effect_t effect_tunnel = {
+    .name = "tunnel", .duration_ms = 5000, .step_ms = 33, .hold_ms = 2000,
+    .init = tunnel_init, .step = effect_time_step, .render = tunnel_render, .teardown = effect_map_teardown,
+};
+
+
+//Plasma waves x / 10, y / 15 and (x + y) / 20 radians, in binary angle units * 256
+static const field_wave_t plasma_waves[] = {
+    {267018, 0},
+    {0, 178012},
+    {133508, 133508},
+};
+
+static bool plasma_init(void) {
+    effect_map = malloc(FIELD_MAP_SIZE);
+    if (effect_map == NULL) return false;
+    field_sines(effect_map, plasma_waves, 3, 9830); //1.5 colors per unit of the sum
+    effect_lut_init(effect_lut);
+    effect_time_ms = 0;
+    return true;
+}
+
+static void plasma_render(void) {
+    field_frame_t frame = {effect_map, effect_lut, effect_time_ms * 26 / 1000}; //about one color per second
+    parallel_rows(0, TFT_HEIGHT - 1, field_row, &frame);
+}
+
+static const effect_t effect_plasma = {
+    .name = "plasma", .duration_ms = 15000, .step_ms = 33, .hold_ms = 2000,
+    .init = plasma_init, .step = effect_time_step, .render = plasma_render, .teardown = effect_map_teardown,
+};
+
+
+#define WATER_DROPS 200
+
+static uint16_t drop_color; //set by water_init, EFFECT_COLOR is not a constant
+static particle_system_t drops;
+static int water_level[TFT_WIDTH];
+static particle_emitter_t drop = {
+    .vy = PARTICLE_FROM_INT(5),
+    .spread_y = PARTICLE_ONE, //4 to 6 pixels per frame
+    .life = TFT_HEIGHT,
+    .colors = &drop_color,
+    .color_count = 1,
+};
+
+static bool water_init(void) {
+    drop_color = EFFECT_COLOR(4);
+    if (!particle_system_init(&drops, WATER_DROPS, esp_timer_get_time())) return false;
+    for (int x = 0; x < TFT_WIDTH; x++) {
+        water_level[x] = TFT_HEIGHT;
     }
+    return true;
 }
 
-void draw_moire_pattern() {
-    clear_frame_buffer(0x0000);
-    for (int i = 0; i < 90; i++) {
-        for (int angle = 0; angle < 360; angle += 10) {
-            int x = TFT_WIDTH / 2 + (i * cos(angle * M_PI / 180));
-            int y = TFT_HEIGHT / 2 + (i * sin(angle * M_PI / 180));
-            draw_pixel(x, y, 0xFFFF);
+static void water_step(uint32_t dt_ms) {
+    particle_update(&drops);
+    for (uint16_t i = 0; i < drops.span; i++) {
+        if (drops.life[i] == 0) continue;
+        int col = PARTICLE_TO_INT(drops.x[i]);
+        if (PARTICLE_TO_INT(drops.y[i]) >= water_level[col] - 1) {
+            if (water_level[col] > 0) water_level[col]--;
+            particle_kill(&drops, i);
+        }
+    }
+
+    //one try per free slot to start a drop over a column that is not full yet
+    for (uint16_t tries = drops.free_count; tries; tries--) {
+        int col = (particle_rand(&drops) >> 16) % TFT_WIDTH;
+        if (water_level[col] > 0) {
+            drop.x = PARTICLE_FROM_INT(col);
+            particle_emit(&drops, &drop, 1);
         }
-        for (int angle = 0; angle < 360; angle += 10) {
-            int x = TFT_WIDTH / 3 + (i * cos(angle * M_PI / 270));
-            int y = TFT_HEIGHT / 3 + (i * sin(angle * M_PI / 270));
-            draw_pixel(x, y, rgb888_to_rgb565(210, 135,220));
+    }
+}
+
+static void water_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    for (int x = 0; x < TFT_WIDTH; x++) {
+        if (water_level[x] < TFT_HEIGHT) {
+            draw_rectangle(x, water_level[x], x, TFT_HEIGHT - 1, EFFECT_COLOR(4));
         }
-        flush_frame_buffer();
-        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    particle_render(&drops);
+}
+
+static void water_teardown(void) {
+    particle_system_free(&drops);
+}
+
+static const effect_t effect_water = {
+    .name = "water", .duration_ms = 30000, .step_ms = 33, .hold_ms = 2000,
+    .init = water_init, .step = water_step, .render = water_render, .teardown = water_teardown,
+};
+
+
+#define MATRIX_COLUMNS (TFT_WIDTH / 8)
+
+static const char matrix_charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static int matrix_drops[MATRIX_COLUMNS];
+
+static bool matrix_init(void) {
+    for (int i = 0; i < MATRIX_COLUMNS; i++) matrix_drops[i] = rand() % TFT_HEIGHT;
+    return true;
+}
+
+static void matrix_render(void) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    for (int i = 0; i < MATRIX_COLUMNS; i++) {
+        int char_index = rand() % (sizeof(matrix_charset) - 1);
+        draw_char_scaled(i * 8, matrix_drops[i], matrix_charset[char_index], EFFECT_COLOR(3), 1, font_data);
+        if (++matrix_drops[i] * 8 >= TFT_HEIGHT) matrix_drops[i] = 0;
+    }
+}
+
+static const effect_t effect_matrix = {
+    .name = "matrix", .duration_ms = 10000, .step_ms = 100, .hold_ms = 2000,
+    .init = matrix_init, .render = matrix_render,
+};
+
+
+#define BALL_RADIUS 10
+
+static int16_t ball_x, ball_y, ball_vx, ball_vy;
+
+static bool ball_init(void) {
+    ball_x = TFT_WIDTH / 2;
+    ball_y = TFT_HEIGHT / 2;
+    ball_vx = 2;
+    ball_vy = 2;
+    return backing_effect_init(1, 2 * BALL_RADIUS + 1);
+}
+
+static void ball_step(uint32_t dt_ms) {
+    ball_x += ball_vx;
+    ball_y += ball_vy;
+    if (ball_x - BALL_RADIUS < 0 || ball_x + BALL_RADIUS > TFT_WIDTH) ball_vx = -ball_vx;
+    if (ball_y - BALL_RADIUS < 0 || ball_y + BALL_RADIUS > TFT_HEIGHT) ball_vy = -ball_vy;
+}
+
+static void ball_render(void) {
+    backing_begin();
+    backing_restore(&effect_backing[0]);
+    backing_save(&effect_backing[0], ball_x - BALL_RADIUS, ball_y - BALL_RADIUS,
+                 ball_x + BALL_RADIUS, ball_y + BALL_RADIUS);
+    draw_circle(ball_x, ball_y, BALL_RADIUS, EFFECT_COLOR(2));
+}
+
+static const effect_t effect_ball = {
+    .name = "bouncing ball", .duration_ms = 15000, .step_ms = 33, .hold_ms = 2000,
+    .init = ball_init, .step = ball_step, .render = ball_render,
+    .present = backing_effect_present, .teardown = backing_effect_teardown,
+};
+
+
+#if FRAME_BUFFER_BPP != 16
+//The tunnel is drawn once and animated only by rotating the palette
+static bool tunnel_cycling_init(void) {
+    if (!tunnel_init()) return false;
+    field_render(effect_map, 0, effect_lut);
+    effect_map_teardown();
+    return true;
+}
+
+static void tunnel_cycling_step(uint32_t dt_ms) {
+    palette_rotate(1, NUM_COLORS - 1, 1);
+}
+
+static void tunnel_cycling_teardown(void) {
+    palette_set(0, colors, NUM_COLORS);
+}
+
+static const effect_t effect_tunnel_cycling = {
+    .name = "tunnel cycling", .duration_ms = 5000, .step_ms = 33, .hold_ms = 2000,
+    .init = tunnel_cycling_init, .step = tunnel_cycling_step, .teardown = tunnel_cycling_teardown,
+};
+#endif
+
+
+static const effect_t *const stress_effects[] = {
+    &effect_bars,
+    &effect_spiral,
+    &effect_rectangles,
+    &effect_scroll_text,
+    &effect_chessboard,
+    &effect_moving_dots,
+    &effect_pixel_explosion,
+    &effect_moire,
+    &effect_fireworks,
+    &effect_tunnel,
+    &effect_plasma,
+    &effect_water,
+    &effect_matrix,
+    &effect_ball,
+#if FRAME_BUFFER_BPP != 16
+    &effect_tunnel_cycling,
+#endif
+};
+
+void register_effects() {
+    for (int i = 0; i < sizeof(stress_effects) / sizeof(stress_effects[0]); i++) {
+        effect_register(stress_effects[i]);
+    }
+}
+
+//Benchmark workloads: fixed frame counts, no delays, random numbers only from workload_rand
+
+static void fill_frame(uint32_t n) {
+    clear_frame_buffer(EFFECT_COLOR(n % NUM_COLORS));
+    flush_frame_buffer();
+}
+
+static const workload_t workload_fill = {
+    .name = "fill", .frames = 120, .seed = 1, .frame = fill_frame,
+};
+
+
+static void direct_fill_frame(uint32_t n) {
+    fill_rect_direct(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, colors[n % NUM_COLORS]);
+}
+
+static const workload_t workload_direct_fill = {
+    .name = "direct fill", .frames = 120, .seed = 2, .frame = direct_fill_frame,
+};
+
+
+#define RECT_STORM_RECTS 200
+
+static void rect_storm_frame(uint32_t n) {
+    clear_frame_buffer(EFFECT_COLOR(0));
+    for (int i = 0; i < RECT_STORM_RECTS; i++) {
+        uint16_t x = workload_rand() % TFT_WIDTH;
+        uint16_t y = workload_rand() % TFT_HEIGHT;
+        uint16_t x2 = x + workload_rand() % 40;
+        uint16_t y2 = y + workload_rand() % 40;
+        draw_rectangle(x, y, (x2 < TFT_WIDTH) ? x2 : TFT_WIDTH - 1, (y2 < TFT_HEIGHT) ? y2 : TFT_HEIGHT - 1,
+                       EFFECT_COLOR(1 + workload_rand() % (NUM_COLORS - 1)));
+    }
+    flush_frame_buffer();
+}
+
+static const workload_t workload_rect_storm = {
+    .name = "rect storm", .frames = 120, .seed = 3, .frame = rect_storm_frame,
+};
+
+
+#define TEXT_WALL_COLUMNS (TFT_WIDTH / FONT_WIDTH)
+#define TEXT_WALL_ROWS (TFT_HEIGHT / (FONT_HEIGHT + 2))
+
+static void text_wall_frame(uint32_t n) {
+    static char text[TEXT_WALL_ROWS * (TEXT_WALL_COLUMNS + 1) + 1];
+    char *c = text;
+    for (int row = 0; row < TEXT_WALL_ROWS; row++) {
+        for (int col = 0; col < TEXT_WALL_COLUMNS; col++) *c++ = '!' + workload_rand() % 94;
+        *c++ = '\n';
+    }
+    *c = '\0';
+    clear_frame_buffer(EFFECT_COLOR(0));
+    draw_text_scaled(0, 0, text, EFFECT_COLOR(1 + n % (NUM_COLORS - 1)), 1, font_data);
+    flush_frame_buffer();
+}
+
+static const workload_t workload_text_wall = {
+    .name = "text wall", .frames = 60, .seed = 4, .frame = text_wall_frame,
+};
+
+
+//Two fixed-point sines per pixel, mapped onto the effect colors
+static void shader_frame(uint32_t n) {
+    uint16_t t = n * FX_ANGLE_PER_RAD / 8;
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            int32_t v = fx_sin(x * 1500 + t) + fx_cos(y * 1100 - t) + 65536;
+            draw_pixel(x, y, EFFECT_COLOR((v * NUM_COLORS) >> 17));
+        }
+    }
+    flush_frame_buffer();
+}
+
+static const workload_t workload_shader = {
+    .name = "shader", .frames = 60, .seed = 5, .frame = shader_frame,
+};
+
+
+#define WORKLOAD_IMAGES 14
+
+static void image_frame(uint32_t n) {
+    char path[24];
+    snprintf(path, sizeof(path), "/spiffs/%lu.bin", (unsigned long)(n % WORKLOAD_IMAGES + 1));
+    load_image(path);
+}
+
+static const workload_t workload_images = {
+    .name = "image load", .frames = 2 * WORKLOAD_IMAGES, .seed = 6, .frame = image_frame,
+};
+
+
+#define SPARSE_RECTS 16
+#define SPARSE_SIZE 8
+
+//A few small rectangles per frame sent straight to the panel, as a UI updating indicators would
+static void sparse_frame(uint32_t n) {
+    for (int i = 0; i < SPARSE_RECTS; i++) {
+        uint16_t x = workload_rand() % (TFT_WIDTH - SPARSE_SIZE);
+        uint16_t y = workload_rand() % (TFT_HEIGHT - SPARSE_SIZE);
+        fill_rect_direct(x, y, x + SPARSE_SIZE - 1, y + SPARSE_SIZE - 1, colors[workload_rand() % NUM_COLORS]);
+    }
+}
+
+static const workload_t workload_sparse = {
+    .name = "sparse", .frames = 240, .seed = 7, .frame = sparse_frame,
+};
+
+
+static const workload_t *const benchmark_workloads[] = {
+    &workload_fill,
+    &workload_direct_fill,
+    &workload_rect_storm,
+    &workload_text_wall,
+    &workload_shader,
+    &workload_images,
+    &workload_sparse,
+};
+
+void register_workloads() {
+    for (int i = 0; i < sizeof(benchmark_workloads) / sizeof(benchmark_workloads[0]); i++) {
+        workload_register(benchmark_workloads[i]);
     }
 }
 
 void stress_test() {
     uint32_t start_time = esp_timer_get_time() / 1000000;
-    uint8_t test_pattern = 0;
-    const uint8_t TOTAL_PATTERNS = 15;
-    uint16_t colors[] = {
-        0x0000, 0xFFFF, 0xF800, 0x07E0, 0x001F,
-        0xFFE0, 0xF81F, 0x07FF, 0xAAAA, 0x5555
-    };
-
-    while((esp_timer_get_time() / 1000000 - start_time) < TEST_DURATION_SEC) {
-        uint32_t pattern_start = esp_timer_get_time();
-        
-        switch(test_pattern) {
-            case 0: 
-                for(int i = 0; i < 120; i++) {  
-                    if((esp_timer_get_time()/1000 - pattern_start) > 2000) break;
-                    
-                    clear_frame_buffer(0x0000);
-                    uint16_t phase = (i * 3) % TFT_WIDTH;
-                    for(uint16_t x = 0; x < TFT_WIDTH; x++) {
-                        uint16_t color = colors[(abs(x - phase)/20) % (sizeof(colors)/sizeof(uint16_t))];
-                        draw_rectangle(x, 0, x, TFT_HEIGHT-1, color);
-                    }
-                    flush_frame_buffer();
-                    vTaskDelay(pdMS_TO_TICKS(16));  
-                }
-                break;
-
-
-            case 1: 
-                for(int i = 0; i < 360*2; i += 5) {  
-                    if((esp_timer_get_time()/1000 - pattern_start) > 4000) break;
-                    
-                    clear_frame_buffer(0x0000);
-                    uint16_t center_x = TFT_WIDTH/2;
-                    uint16_t center_y = TFT_HEIGHT/2;
-                    
-                    for(int r = 0; r < 60; r += 2) {
-                        float angle = (i + r*3) * M_PI / 180.0;
-                        uint16_t x = center_x + r * cos(angle);
-                        uint16_t y = center_y + r * sin(angle);
-                        draw_circle(x, y, 5, colors[r % (sizeof(colors)/sizeof(uint16_t))]);
-                    }
-                    flush_frame_buffer();
-                    vTaskDelay(pdMS_TO_TICKS(30));
-                }
-                break;
-
-
-
-            case 2: 
-                for(int i = 0; i < 20; i++) {  
-                    if((esp_timer_get_time()/1000 - pattern_start) > 5000) break;
-                    
-                    clear_frame_buffer(0xFFFF);
-                    
-                    
-                    for(int n = 0; n < 8; n++) {
-                        uint16_t pos = rand() % TFT_WIDTH;
-                        draw_rectangle(pos, 0, pos, TFT_HEIGHT-1, 0x0000);
-                        pos = rand() % TFT_HEIGHT;
-                        draw_rectangle(0, pos, TFT_WIDTH-1, pos, 0x0000);
-                    }
-                    
-
-                    for(int n = 0; n < 15; n++) {
-                        uint16_t color = colors[rand() % 4 + 2];  
-                        uint16_t x1 = rand() % (TFT_WIDTH-20);
-                        uint16_t y1 = rand() % (TFT_HEIGHT-20);
-                        draw_rectangle(x1, y1, x1 + rand()%30 +10, y1 + rand()%30 +10, color);
-                    }
-                    flush_frame_buffer();
-                    vTaskDelay(pdMS_TO_TICKS(250));
-                }
-                break;
-
-
-            case 3: 
-                clear_frame_buffer(0x0000);
-                for(int i = 0; i < 1; i++) {  
-                    for(int y_off = -20; y_off < TFT_HEIGHT; y_off += 2) {
-                        clear_frame_buffer(0x0000);
-                        draw_text_scaled(TFT_WIDTH/4, y_off, "STRESS TEST", 
-                                      rgb888_to_rgb565(255, 255, 255), 1, font_data);
-                        flush_frame_buffer();
-                        vTaskDelay(pdMS_TO_TICKS(30));
-                    }
-                }
-                break;
-            case 4:
-                draw_chessboard(20, 0x0000, 0xFFFF);
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 5:
-                draw_moving_dots();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 6:
-                draw_pixel_explosion();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 7:
-                draw_moire_pattern();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 8:
-                draw_fireworks();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            
-            case 9:
-                draw_tunnel_3d();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            
-            case 10: 
-                draw_plasma_effect();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 11: 
-                draw_water_filling();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 12: 
-                draw_matrix_effect();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-            case 13: 
-                draw_bouncing_ball();
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                break;
-
-
-
-            
-        }
+    uint8_t index = 0;
+
+    while ((esp_timer_get_time() / 1000000 - start_time) < TEST_DURATION_SEC) {
+        effect_run(index);
 
         for(int i = 0; i < 3; i++) {
-            clear_frame_buffer(0x0000);
-            flush_frame_buffer();
+            fill_rect_direct(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, 0x0000);
             vTaskDelay(pdMS_TO_TICKS(50));
-            clear_frame_buffer(0xFFFF);
-            flush_frame_buffer();
+            fill_rect_direct(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, 0xFFFF);
             vTaskDelay(pdMS_TO_TICKS(50));
         }
-        
-        test_pattern = (test_pattern + 1) % TOTAL_PATTERNS;
-        if((esp_timer_get_time() / 1000000 - start_time) >= TEST_DURATION_SEC) break;
-    }
-}
-void draw_circle(uint16_t x0, uint16_t y0, uint16_t r, uint16_t color) {
-    int x = r;
-    int y = 0;
-    int err = 0;
-
-    while(x >= y) {
-        draw_pixel(x0 + x, y0 + y, color);
-        draw_pixel(x0 + y, y0 + x, color);
-        draw_pixel(x0 - y, y0 + x, color);
-        draw_pixel(x0 - x, y0 + y, color);
-        draw_pixel(x0 - x, y0 - y, color);
-        draw_pixel(x0 - y, y0 - x, color);
-        draw_pixel(x0 + y, y0 - x, color);
-        draw_pixel(x0 + x, y0 - y, color);
-
-        if(err <= 0) {
-            y += 1;
-            err += 2*y + 1;
-        }
-        if(err > 0) {
-            x -= 1;
-            err -= 2*x + 1;
+
+        index = (index + 1) % effect_count();
+        if (index == 0) {
+            effect_log_stats();
+#if ST7789_PERF
+            perf_log_stats();
+#endif
+#if ST7789_TRACE
+            trace_dump();
+            trace_start();
+#endif
+#if ST7789_RECORD
+            record_stop();
+            replay_result_t replay;
+            if (record_replay(RECORD_SESSION, font_data, NULL, &replay)) record_log_result(&replay);
+#endif
         }
     }
 }
 
-
 void app_main() {
-    mount_spiffs();  
+    storage_mount(ASSET_STORAGE);
     load_font(font_data);     
     INIT();  
+    parallel_init();
+    register_effects();
+    register_workloads();
+#if FRAME_BUFFER_BPP != 16
+    palette_set(0, colors, NUM_COLORS);
+#endif
+#if ST7789_TRACE
+    trace_start();
+#endif
+#if ST7789_PERF
+    perf_reset();
+    perf_overlay_enable(font_data, 0, 0, EFFECT_COLOR(1), EFFECT_COLOR(0));
+#endif
+#if RUN_BENCHMARKS
+    bench_shapes();
+    bench_fxmath();
+    bench_fields();
+    bench_parallel();
+    bench_particles();
+    bench_images();
+    bench_storage();
+#if FRAME_BUFFER_BPP == 16
+    bench_fill();
+    bench_blit();
+    bench_blend();
+#endif
+#endif
+#if RUN_WORKLOADS
+    while (1) {
+        workload_run_all();
+#if ST7789_PERF
+        perf_log_stats();
+#endif
+    }
+#endif
+#if ST7789_RECORD
+    record_start(RECORD_SESSION);
+#endif
     while (1)
     {
         load_image("/spiffs/1.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/2.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/3.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/4.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/5.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/6.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/7.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/8.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/9.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/10.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/11.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/12.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/13.bin");
-        vTaskDelay(pdMS_TO_TICKS(1));
+        vTaskDelay(1);
         load_image("/spiffs/14.bin");
         stress_test();
     }
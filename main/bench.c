@@ -0,0 +1,504 @@
+#include "bench.h"
+#include "bench_cases.h"
+#include "st7789_fxmath.h"
+#include "st7789_fields.h"
+#include "st7789_parallel.h"
+#include "st7789_jpeg.h"
+#include "ixora_storage.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <math.h>
+
+
+static const char *TAG = "bench";
+
+#define BENCH_SHAPE_ITERATIONS 2000
+#define BENCH_FILL_ITERATIONS 200
+#define BENCH_BLIT_ITERATIONS 1000
+#define BENCH_BLEND_ITERATIONS 100
+#define BENCH_FXMATH_ITERATIONS 100000
+#define BENCH_EFFECT_ITERATIONS 10
+#define BENCH_PARTICLE_UPDATES 200
+#define BENCH_FRAME_US 33333 //one frame at 30 FPS
+#define BENCH_IMAGES 4 //spiffs images that come as both /spiffs/n.bin and /spiffs/n.jpg
+#define BENCH_STORAGE_OPENS 20
+#define BENCH_STORAGE_CHUNK 4096 //bytes per fread in the sequential pass
+#define BENCH_STORAGE_RANDOM_READS 200
+#define BENCH_STORAGE_RANDOM_SIZE (TFT_HEIGHT * 2) //one screen column of a raw image
+
+typedef void (*bench_fn_t)(uint32_t i);
+
+
+/**
+ * @brief Runs a benchmark case and logs its throughput.
+ *
+ * The case is called with an increasing index so every call can place its
+ * primitive somewhere else on the screen. The task yields once afterwards so
+ * long runs do not trip the idle task watchdog.
+ *
+ * @param name The name printed in the log.
+ * @param fn The function that draws one primitive.
+ * @param iterations How many times the function is called.
+ * @return The measured operations per second.
+ */
+static double bench_run(const char *name, bench_fn_t fn, uint32_t iterations) {
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    if (elapsed <= 0) elapsed = 1;
+
+    double ops = iterations * 1000000.0 / elapsed;
+    ESP_LOGI(TAG, "%-28s %6lu ops %10.1f ops/s", name, (unsigned long)iterations, ops);
+    vTaskDelay(1);
+    return ops;
+}
+
+static void case_pixel_circle(uint32_t i) { case_ref_circle(i, 20, 0); }
+static void case_span_circle(uint32_t i) { case_circle(i, 20, 0); }
+static void case_pixel_fill_circle(uint32_t i) { case_ref_fill_circle(i, 20, 0); }
+static void case_span_fill_circle(uint32_t i) { case_fill_circle(i, 20, 0); }
+static void case_pixel_fill_triangle(uint32_t i) { case_ref_fill_triangle(i, 40, 0); }
+static void case_span_fill_triangle(uint32_t i) { case_fill_triangle(i, 40, 0); }
+static void case_ellipse_30x15(uint32_t i) { case_fill_ellipse(i, 30, 15); }
+static void case_round_rect_40x30(uint32_t i) { case_fill_round_rect(i, 40, 30); }
+static void case_arc_20_12(uint32_t i) { case_fill_arc(i, 20, 12); }
+
+
+/**
+ * @brief Measures primitives per second of the span rasterizers.
+ *
+ * Every span primitive is run next to a per-pixel version built on
+ * draw_pixel, which is how shapes were drawn before, so the log shows the
+ * speed-up directly. Only the frame buffer is touched, nothing is flushed.
+ */
+void bench_shapes(void) {
+    ESP_LOGI(TAG, "shapes: %d iterations per case", BENCH_SHAPE_ITERATIONS);
+    bench_run("circle r20 (per-pixel)", case_pixel_circle, BENCH_SHAPE_ITERATIONS);
+    bench_run("circle r20 (spans)", case_span_circle, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill circle r20 (per-pixel)", case_pixel_fill_circle, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill circle r20 (spans)", case_span_fill_circle, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill triangle (per-pixel)", case_pixel_fill_triangle, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill triangle (spans)", case_span_fill_triangle, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill ellipse 30x15", case_ellipse_30x15, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill round rect 40x30 r8", case_round_rect_40x30, BENCH_SHAPE_ITERATIONS);
+    bench_run("fill arc r20-12 220deg", case_arc_20_12, BENCH_SHAPE_ITERATIONS);
+}
+
+
+/**
+ * @brief Checks the fixed-point math library against libm and times both.
+ *
+ * The maximum error of every function is measured over a sweep of its input
+ * range, then each function is timed next to its float counterpart. The
+ * tunnel and plasma cases render a whole frame the way the effects in TOHA
+ * do, once with float math and once with the fixed-point version.
+ */
+void bench_fxmath(void) {
+    float err_sin = 0, err_atan = 0, err_sqrt = 0, err_ln = 0;
+
+    for (uint32_t a = 0; a < FX_ANGLE_TURN; a += 3) {
+        float e = fabsf(fx_sin(a) / 32767.0f - sinf(a * (2 * (float)M_PI / FX_ANGLE_TURN)));
+        err_sin = (e > err_sin) ? e : err_sin;
+    }
+    for (int32_t y = -1000; y <= 1000; y += 7) {
+        for (int32_t x = -1000; x <= 1000; x += 89) {
+            if (x == 0 && y == 0) continue;
+            float ref = atan2f(y, x) * (180.0f / (float)M_PI);
+            float got = fx_atan2(y, x) * (360.0f / FX_ANGLE_TURN);
+            float e = fabsf(got - ((ref < 0) ? ref + 360.0f : ref));
+            e = (e > 180.0f) ? 360.0f - e : e;
+            err_atan = (e > err_atan) ? e : err_atan;
+        }
+    }
+    for (uint32_t v = 1; v < 0x7FFFFFFF / 2; v = v * 3 / 2 + 1) {
+        float ref = sqrtf(v / 65536.0f);
+        float e = fabsf(fx_sqrt(v) / 65536.0f - ref) / ref;
+        err_sqrt = (e > err_sqrt) ? e : err_sqrt;
+    }
+    for (uint32_t v = 64; v < 0x7FFFFFFF / 2; v = v * 5 / 4 + 1) {
+        float e = fabsf(fx_ln(v) / 65536.0f - logf(v / 65536.0f));
+        err_ln = (e > err_ln) ? e : err_ln;
+    }
+    ESP_LOGI(TAG, "fxmath max error: sin %.6f, atan2 %.4f deg, sqrt %.6f rel, ln %.6f",
+             err_sin, err_atan, err_sqrt, err_ln);
+
+    ESP_LOGI(TAG, "fxmath: %d iterations per case", BENCH_FXMATH_ITERATIONS);
+    bench_run("sinf", case_sinf, BENCH_FXMATH_ITERATIONS);
+    bench_run("fx_sin", case_fx_sin, BENCH_FXMATH_ITERATIONS);
+    bench_run("atan2f", case_atan2f, BENCH_FXMATH_ITERATIONS);
+    bench_run("fx_atan2", case_fx_atan2, BENCH_FXMATH_ITERATIONS);
+    bench_run("sqrtf", case_sqrtf, BENCH_FXMATH_ITERATIONS);
+    bench_run("fx_isqrt", case_fx_isqrt, BENCH_FXMATH_ITERATIONS);
+    bench_run("logf", case_logf, BENCH_FXMATH_ITERATIONS);
+    bench_run("fx_ln", case_fx_ln, BENCH_FXMATH_ITERATIONS);
+
+    ESP_LOGI(TAG, "effects: %d frames per case", BENCH_EFFECT_ITERATIONS);
+    bench_run("tunnel frame (float)", ref_tunnel_float, BENCH_EFFECT_ITERATIONS);
+    bench_run("tunnel frame (fixed)", ref_tunnel_fixed, BENCH_EFFECT_ITERATIONS);
+    bench_run("plasma frame (float)", ref_plasma_float, BENCH_EFFECT_ITERATIONS);
+    bench_run("plasma frame (fixed)", ref_plasma_fixed, BENCH_EFFECT_ITERATIONS);
+}
+
+
+/**
+ * @brief Measures the frame rate of the tunnel and plasma effects with field maps.
+ *
+ * Each effect is rendered per pixel with float math, per pixel with the
+ * fixed-point functions, and as a precomputed field map plus a phase offset.
+ * The ops/s column is the render-only frame rate; the flush is not included.
+ * The time to build each map once is logged as well.
+ */
+void bench_fields(void) {
+    if (!bench_field_init()) {
+        ESP_LOGE(TAG, "fields: no memory for the field map");
+        return;
+    }
+
+    ESP_LOGI(TAG, "fields: %d frames per case", BENCH_EFFECT_ITERATIONS);
+    int64_t start = esp_timer_get_time();
+    case_tunnel_map(0);
+    ESP_LOGI(TAG, "tunnel map built in %ld us", (long)(esp_timer_get_time() - start));
+    bench_run("tunnel fps (float)", ref_tunnel_float, BENCH_EFFECT_ITERATIONS);
+    bench_run("tunnel fps (fixed)", ref_tunnel_fixed, BENCH_EFFECT_ITERATIONS);
+    bench_run("tunnel fps (field map)", case_field_frame, BENCH_EFFECT_ITERATIONS * 10);
+
+    start = esp_timer_get_time();
+    case_plasma_map(0);
+    ESP_LOGI(TAG, "plasma map built in %ld us", (long)(esp_timer_get_time() - start));
+    bench_run("plasma fps (float)", ref_plasma_float, BENCH_EFFECT_ITERATIONS);
+    bench_run("plasma fps (fixed)", ref_plasma_fixed, BENCH_EFFECT_ITERATIONS);
+    bench_run("plasma fps (field map)", case_field_frame, BENCH_EFFECT_ITERATIONS * 10);
+
+    bench_field_free();
+}
+
+
+static uint32_t parallel_frame;
+
+//Moving-wave plasma row, three fx_sin per pixel
+static void plasma_row(int16_t y, void *arg) {
+    uint16_t t = parallel_frame * FX_ANGLE_PER_RAD / 10;
+    uint16_t ay = ((y * 178012) >> 8) + t;
+    for (int x = 0; x < TFT_WIDTH; x++) {
+        uint16_t ax = ((x * 267018) >> 8) + t;
+        uint16_t axy = (((x + y) * 133508) >> 8) + t;
+        int32_t v = fx_sin(ax) + fx_sin(ay) + fx_sin(axy);
+        draw_pixel(x, y, (((v + 3 * FX_TRIG_ONE) * 3) >> 16) % 10);
+    }
+}
+
+static void field_map_row(int16_t y, void *arg) {
+    field_render_rows(bench_field_map, parallel_frame * 26, bench_field_lut, y, y);
+}
+
+//Rows in the top quarter cost about 20 times more than the rest
+static void uneven_row(int16_t y, void *arg) {
+    if (y < TFT_HEIGHT / 4) {
+        for (int i = 0; i < 20; i++) plasma_row(y, arg);
+    } else {
+        plasma_row(y, arg);
+    }
+}
+
+static void case_parallel_plasma(uint32_t i) { parallel_frame = i; parallel_rows(0, TFT_HEIGHT - 1, plasma_row, NULL); }
+static void case_parallel_field(uint32_t i) { parallel_frame = i; parallel_rows(0, TFT_HEIGHT - 1, field_map_row, NULL); }
+static void case_parallel_uneven(uint32_t i) { parallel_frame = i; parallel_rows(0, TFT_HEIGHT - 1, uneven_row, NULL); }
+
+
+/**
+ * @brief Reports how the row-parallel renderer scales from 1 to 2 workers.
+ *
+ * The per-pixel plasma is compute bound, the field map render is mostly
+ * memory bound, and the uneven case puts most of the work in the top rows,
+ * where an even split without work stealing would leave one core idle.
+ */
+void bench_parallel(void) {
+    static const struct {
+        const char *name;
+        bench_fn_t fn;
+        uint32_t frames;
+    } cases[] = {
+        {"plasma per-pixel", case_parallel_plasma, BENCH_EFFECT_ITERATIONS},
+        {"plasma field map", case_parallel_field, BENCH_EFFECT_ITERATIONS * 10},
+        {"uneven rows", case_parallel_uneven, BENCH_EFFECT_ITERATIONS / 2},
+    };
+    uint8_t max_workers = parallel_get_workers();
+    char name[40];
+
+    if (!bench_field_init()) {
+        ESP_LOGE(TAG, "parallel: no memory for the field map");
+        return;
+    }
+    case_plasma_map(0);
+
+    ESP_LOGI(TAG, "parallel: up to %d workers", max_workers);
+    for (uint8_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        double base = 0;
+        for (uint8_t w = 1; w <= max_workers; w++) {
+            parallel_set_workers(w);
+            snprintf(name, sizeof(name), "%s, %d worker%s", cases[c].name, w, (w > 1) ? "s" : "");
+            double fps = bench_run(name, cases[c].fn, cases[c].frames);
+            if (w == 1) base = fps;
+            else ESP_LOGI(TAG, "  speed-up x%.2f", fps / base);
+        }
+    }
+    parallel_set_workers(max_workers);
+
+    bench_field_free();
+}
+
+
+/**
+ * @brief Measures particles updated and rendered per millisecond.
+ *
+ * The SoA fixed-point engine is compared with float array-of-structs
+ * particles updated the way draw_fireworks did before, for several
+ * population sizes. Updates include emitting replacements for dead
+ * particles, so the population stays constant.
+ */
+void bench_particles(void) {
+    static const uint16_t sizes[] = {50, 500, 2000, BENCH_PARTICLE_MAX};
+    char name[40];
+
+    ESP_LOGI(TAG, "particles: %d updates per case", BENCH_PARTICLE_UPDATES);
+    for (uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint16_t n = sizes[s];
+        if (!bench_particles_init(n)) {
+            ESP_LOGE(TAG, "particles: no memory for %d", n);
+            break;
+        }
+
+        snprintf(name, sizeof(name), "%d update (AoS float)", n);
+        double ops = bench_run(name, case_aos_update, BENCH_PARTICLE_UPDATES);
+        ESP_LOGI(TAG, "  %.0f particles/ms", ops * n / 1000.0);
+        snprintf(name, sizeof(name), "%d update (SoA fixed)", n);
+        ops = bench_run(name, case_soa_update, BENCH_PARTICLE_UPDATES);
+        ESP_LOGI(TAG, "  %.0f particles/ms", ops * n / 1000.0);
+        snprintf(name, sizeof(name), "%d render (draw_pixel)", n);
+        ops = bench_run(name, case_aos_render, BENCH_PARTICLE_UPDATES);
+        ESP_LOGI(TAG, "  %.0f particles/ms", ops * n / 1000.0);
+        snprintf(name, sizeof(name), "%d render (bulk)", n);
+        ops = bench_run(name, case_soa_render, BENCH_PARTICLE_UPDATES);
+        ESP_LOGI(TAG, "  %.0f particles/ms", ops * n / 1000.0);
+    }
+
+    bench_particles_free();
+}
+
+
+/**
+ * @brief Compares the raw and the JPEG image paths.
+ *
+ * Every image is shown once from its raw RGB565 file and once from its
+ * JPEG, and for each path the bytes read from flash and the time until the
+ * image is on the panel are logged. The raw path reads the whole file.
+ */
+void bench_images(void) {
+    ESP_LOGI(TAG, "%-8s %10s %10s %10s %10s", "image", "raw bytes", "raw us", "jpeg bytes", "jpeg us");
+    for (uint8_t n = 1; n <= BENCH_IMAGES; n++) {
+        char raw[32], jpeg[32];
+        snprintf(raw, sizeof(raw), "/spiffs/%u.bin", n);
+        snprintf(jpeg, sizeof(jpeg), "/spiffs/%u.jpg", n);
+
+        int64_t start = esp_timer_get_time();
+        load_image(raw);
+        uint32_t raw_us = esp_timer_get_time() - start;
+        vTaskDelay(1);
+
+        jpeg_stats_t st;
+        bool ok = load_jpeg(jpeg, 0, 0, JPEG_TO_PANEL, DITHER_NONE);
+        jpeg_get_stats(&st);
+        vTaskDelay(1);
+        if (!ok) continue;
+        ESP_LOGI(TAG, "%-8u %10u %10lu %10lu %10lu", n, TFT_WIDTH * TFT_HEIGHT * 2, (unsigned long)raw_us,
+                 (unsigned long)st.bytes_read, (unsigned long)st.total_us);
+    }
+}
+
+
+/**
+ * @brief Measures one mounted backend on the raw images.
+ *
+ * Open latency is the time fopen takes, averaged over the images. The
+ * sequential pass reads every image whole in BENCH_STORAGE_CHUNK byte
+ * reads, the random pass reads screen columns at random offsets with a
+ * seek before each one. The offsets come from a fixed seed, so every
+ * backend sees the same ones.
+ */
+static void bench_storage_backend(storage_backend_t backend, uint8_t *buffer) {
+    char path[32];
+    uint32_t open_us = 0, open_max = 0;
+    for (uint16_t i = 0; i < BENCH_STORAGE_OPENS; i++) {
+        snprintf(path, sizeof(path), STORAGE_BASE_PATH "/%u.bin", i % BENCH_IMAGES + 1);
+        int64_t start = esp_timer_get_time();
+        FILE *f = fopen(path, "rb");
+        uint32_t us = esp_timer_get_time() - start;
+        if (!f) {
+            ESP_LOGW(TAG, "%-9s %s missing", storage_name(backend), path);
+            return;
+        }
+        fclose(f);
+        open_us += us;
+        if (us > open_max) open_max = us;
+    }
+
+    uint32_t seq_bytes = 0;
+    int64_t start = esp_timer_get_time();
+    for (uint8_t n = 1; n <= BENCH_IMAGES; n++) {
+        snprintf(path, sizeof(path), STORAGE_BASE_PATH "/%u.bin", n);
+        FILE *f = fopen(path, "rb");
+        if (!f) continue;
+        size_t got;
+        while ((got = fread(buffer, 1, BENCH_STORAGE_CHUNK, f)) > 0) seq_bytes += got;
+        fclose(f);
+    }
+    int64_t seq_us = esp_timer_get_time() - start;
+
+    uint32_t rand_bytes = 0;
+    int64_t rand_us = 0;
+    uint32_t columns = TFT_WIDTH * TFT_HEIGHT * 2 / BENCH_STORAGE_RANDOM_SIZE;
+    srand(1);
+    for (uint8_t n = 1; n <= BENCH_IMAGES; n++) {
+        snprintf(path, sizeof(path), STORAGE_BASE_PATH "/%u.bin", n);
+        FILE *f = fopen(path, "rb");
+        if (!f) continue;
+        start = esp_timer_get_time();
+        for (uint16_t i = 0; i < BENCH_STORAGE_RANDOM_READS / BENCH_IMAGES; i++) {
+            fseek(f, (rand() % columns) * BENCH_STORAGE_RANDOM_SIZE, SEEK_SET);
+            rand_bytes += fread(buffer, 1, BENCH_STORAGE_RANDOM_SIZE, f);
+        }
+        rand_us += esp_timer_get_time() - start;
+        fclose(f);
+    }
+
+    if (seq_us <= 0) seq_us = 1;
+    if (rand_us <= 0) rand_us = 1;
+    ESP_LOGI(TAG, "%-9s %9lu %9lu %10.2f %10.2f", storage_name(backend),
+             (unsigned long)(open_us / BENCH_STORAGE_OPENS), (unsigned long)open_max,
+             (double)seq_bytes / seq_us, (double)rand_bytes / rand_us);
+}
+
+/**
+ * @brief Compares the asset storage backends.
+ *
+ * Every backend is mounted in turn and timed on the raw images: open
+ * latency in µs (mean and worst), sequential and random read throughput in
+ * MB/s. Backends that fail to mount are skipped. The backend mounted
+ * before is mounted again at the end.
+ */
+void bench_storage(void) {
+    storage_backend_t current;
+    bool was_mounted = storage_mounted(&current);
+    uint8_t *buffer = malloc(BENCH_STORAGE_CHUNK);
+    if (buffer == NULL) {
+        ESP_LOGE(TAG, "No memory for the storage benchmark");
+        return;
+    }
+
+    ESP_LOGI(TAG, "%-9s %9s %9s %10s %10s", "storage", "open us", "open max", "seq MB/s", "rand MB/s");
+    for (storage_backend_t b = 0; b < STORAGE_COUNT; b++) {
+        if (!storage_mount(b)) {
+            ESP_LOGW(TAG, "%-9s not mounted", storage_name(b));
+            continue;
+        }
+        bench_storage_backend(b, buffer);
+        vTaskDelay(1);
+    }
+
+    free(buffer);
+    storage_unmount();
+    if (was_mounted) storage_mount(current);
+}
+
+//The remaining benchmarks work on the RGB565 frame buffer directly
+#if FRAME_BUFFER_BPP == 16
+
+static void case_naive_band(uint32_t i) { case_ref_rect(i, TFT_WIDTH, 80); }
+static void case_band(uint32_t i) { case_rect(i, TFT_WIDTH, 80); }
+static void case_naive_rect_64(uint32_t i) { case_ref_rect(i, 64, 64); }
+static void case_rect_64(uint32_t i) { case_rect(i, 64, 64); }
+static void case_naive_rect_16(uint32_t i) { case_ref_rect(i, 16, 16); }
+static void case_rect_16(uint32_t i) { case_rect(i, 16, 16); }
+static void case_naive_rect_3x40(uint32_t i) { case_ref_rect(i, 3, 40); }
+static void case_rect_3x40(uint32_t i) { case_rect(i, 3, 40); }
+
+static void case_naive_blend_fill(uint32_t i) { case_ref_blend_fill(i, 96); }
+static void case_packed_blend_fill(uint32_t i) { case_blend_fill(i, 96); }
+static void case_naive_blend_rows(uint32_t i) { case_ref_blend_rows(i, 160); }
+static void case_packed_blend_rows(uint32_t i) { case_blend_rows(i, 160); }
+
+
+/**
+ * @brief Measures the frame buffer fill kernels.
+ *
+ * Each rectangle shape is run with the word-wide kernels (clear_frame_buffer,
+ * draw_rectangle) and with the old per-pixel loop. "135 columns" is the
+ * workload of stress_test pattern 0, one draw_rectangle per column.
+ */
+void bench_fill(void) {
+    ESP_LOGI(TAG, "fill: %d iterations per case", BENCH_FILL_ITERATIONS);
+    bench_run("full screen (per-pixel)", case_ref_clear, BENCH_FILL_ITERATIONS);
+    bench_run("full screen (clear)", case_clear, BENCH_FILL_ITERATIONS);
+    bench_run("135 columns (per-pixel)", case_ref_columns, BENCH_FILL_ITERATIONS);
+    bench_run("135 columns (strided)", case_columns, BENCH_FILL_ITERATIONS);
+    bench_run("full-width 80 rows (per-pixel)", case_naive_band, BENCH_FILL_ITERATIONS);
+    bench_run("full-width 80 rows", case_band, BENCH_FILL_ITERATIONS);
+    bench_run("rect 64x64 (per-pixel)", case_naive_rect_64, BENCH_FILL_ITERATIONS * 10);
+    bench_run("rect 64x64", case_rect_64, BENCH_FILL_ITERATIONS * 10);
+    bench_run("rect 16x16 (per-pixel)", case_naive_rect_16, BENCH_FILL_ITERATIONS * 50);
+    bench_run("rect 16x16", case_rect_16, BENCH_FILL_ITERATIONS * 50);
+    bench_run("rect 3x40 (per-pixel)", case_naive_rect_3x40, BENCH_FILL_ITERATIONS * 50);
+    bench_run("rect 3x40", case_rect_3x40, BENCH_FILL_ITERATIONS * 50);
+}
+
+/**
+ * @brief Measures how many sprites fit in one 30 FPS frame.
+ *
+ * Each sprite size is blitted opaque, color-keyed and alpha blended, plus the
+ * draw_pixel loop it replaces. Positions wrap around the screen so part of
+ * the blits are clipped.
+ */
+void bench_blit(void) {
+    static const uint16_t sizes[] = {16, 32, 64};
+    char name[32];
+
+    for (uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint16_t size = sizes[s];
+        bench_make_sprite(size);
+        ESP_LOGI(TAG, "blit %dx%d: %d iterations per case", size, size, BENCH_BLIT_ITERATIONS);
+
+        snprintf(name, sizeof(name), "%dx%d draw_pixel", size, size);
+        double ops = bench_run(name, case_ref_blit, BENCH_BLIT_ITERATIONS);
+        ESP_LOGI(TAG, "  %.0f sprites/frame", ops * BENCH_FRAME_US / 1000000.0);
+        snprintf(name, sizeof(name), "%dx%d opaque", size, size);
+        ops = bench_run(name, case_blit, BENCH_BLIT_ITERATIONS);
+        ESP_LOGI(TAG, "  %.0f sprites/frame", ops * BENCH_FRAME_US / 1000000.0);
+        snprintf(name, sizeof(name), "%dx%d color-key", size, size);
+        ops = bench_run(name, case_blit_keyed, BENCH_BLIT_ITERATIONS);
+        ESP_LOGI(TAG, "  %.0f sprites/frame", ops * BENCH_FRAME_US / 1000000.0);
+        snprintf(name, sizeof(name), "%dx%d alpha", size, size);
+        ops = bench_run(name, case_blit_alpha, BENCH_BLIT_ITERATIONS);
+        ESP_LOGI(TAG, "  %.0f sprites/frame", ops * BENCH_FRAME_US / 1000000.0);
+    }
+}
+
+/**
+ * @brief Compares the packed RGB565 blend kernels with per-channel blending.
+ *
+ * Cases cover a translucent full-screen rectangle (constant alpha, two pixels
+ * per word), 64-pixel wide rows with constant alpha and with per-pixel alpha.
+ */
+void bench_blend(void) {
+    bench_make_sprite(BENCH_SPRITE_MAX);
+    ESP_LOGI(TAG, "blend: %d iterations per case", BENCH_BLEND_ITERATIONS);
+    bench_run("full screen a=96 (naive)", case_naive_blend_fill, BENCH_BLEND_ITERATIONS);
+    bench_run("full screen a=96 (packed)", case_packed_blend_fill, BENCH_BLEND_ITERATIONS);
+    bench_run("64x240 rows a=160 (naive)", case_naive_blend_rows, BENCH_BLEND_ITERATIONS);
+    bench_run("64x240 rows a=160 (packed)", case_packed_blend_rows, BENCH_BLEND_ITERATIONS);
+    bench_run("64x240 alpha plane (naive)", case_ref_blend_alpha8, BENCH_BLEND_ITERATIONS);
+    bench_run("64x240 alpha plane (packed)", case_blend_alpha8, BENCH_BLEND_ITERATIONS);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include "st7789.h"
+
+void bench_shapes(void);
+void bench_fxmath(void);
+void bench_fields(void);
+void bench_parallel(void);
+void bench_particles(void);
+void bench_images(void);
+void bench_storage(void);
+#if FRAME_BUFFER_BPP == 16
+void bench_fill(void);
+void bench_blit(void);
+void bench_blend(void);
+#endif
@@ -0,0 +1,231 @@
+#include "bench_cases.h"
+#include "st7789_shapes.h"
+#include "st7789_blit.h"
+#include "st7789_blend.h"
+#include "st7789_fxmath.h"
+#include "st7789_fields.h"
+#include "st7789_particles.h"
+#include <stdlib.h>
+#include <math.h>
+
+
+static inline uint16_t rect_x(uint32_t i, int16_t a) { return (TFT_WIDTH - a) ? bench_x(i) % (TFT_WIDTH - a + 1) : 0; }
+static inline uint16_t rect_y(uint32_t i, int16_t b) { return (TFT_HEIGHT - b) ? bench_y(i) % (TFT_HEIGHT - b + 1) : 0; }
+
+void case_clear(uint32_t i) { clear_frame_buffer(BENCH_COLOR(i)); }
+void case_columns(uint32_t i) {
+    for (uint16_t x = 0; x < TFT_WIDTH; x++) {
+        draw_rectangle(x, 0, x, TFT_HEIGHT - 1, BENCH_COLOR(i + x));
+    }
+}
+void case_rect(uint32_t i, int16_t a, int16_t b) {
+    uint16_t x = rect_x(i, a), y = rect_y(i, b);
+    draw_rectangle(x, y, x + a - 1, y + b - 1, BENCH_COLOR(i));
+}
+
+
+void case_circle(uint32_t i, int16_t a, int16_t b) { draw_circle(bench_x(i), bench_y(i), a, BENCH_COLOR(i)); }
+void case_ref_circle(uint32_t i, int16_t a, int16_t b) { ref_circle(bench_x(i), bench_y(i), a, BENCH_COLOR(i)); }
+void case_fill_circle(uint32_t i, int16_t a, int16_t b) { fill_circle(bench_x(i), bench_y(i), a, BENCH_COLOR(i)); }
+void case_ref_fill_circle(uint32_t i, int16_t a, int16_t b) { ref_fill_circle(bench_x(i), bench_y(i), a, BENCH_COLOR(i)); }
+void case_fill_triangle(uint32_t i, int16_t a, int16_t b) {
+    int16_t x = bench_x(i), y = bench_y(i);
+    fill_triangle(x, y, x + a, y + a / 4, x + a / 4, y + a, BENCH_COLOR(i));
+}
+void case_ref_fill_triangle(uint32_t i, int16_t a, int16_t b) {
+    int16_t x = bench_x(i), y = bench_y(i);
+    ref_fill_triangle(x, y, x + a, y + a / 4, x + a / 4, y + a, BENCH_COLOR(i));
+}
+void case_fill_ellipse(uint32_t i, int16_t a, int16_t b) { fill_ellipse(bench_x(i), bench_y(i), a, b, BENCH_COLOR(i)); }
+void case_fill_round_rect(uint32_t i, int16_t a, int16_t b) { fill_round_rect(bench_x(i), bench_y(i), a, b, 8, BENCH_COLOR(i)); }
+void case_fill_arc(uint32_t i, int16_t a, int16_t b) { fill_arc(bench_x(i), bench_y(i), a, b, 30, 250, BENCH_COLOR(i)); }
+
+
+static volatile uint32_t fx_sink; //keeps the math cases from being optimized away
+
+void case_sinf(uint32_t i) { fx_sink += (int32_t)(sinf(i * 0.001f) * 32767.0f); }
+void case_fx_sin(uint32_t i) { fx_sink += fx_sin(i * 7); }
+void case_atan2f(uint32_t i) { fx_sink += (int32_t)(atan2f((int32_t)(i & 1023) - 512, 300.0f) * 10430.378f); }
+void case_fx_atan2(uint32_t i) { fx_sink += fx_atan2((int32_t)(i & 1023) - 512, 300); }
+void case_sqrtf(uint32_t i) { fx_sink += (int32_t)sqrtf((float)(i * 4099)); }
+void case_fx_isqrt(uint32_t i) { fx_sink += fx_isqrt(i * 4099); }
+void case_logf(uint32_t i) { fx_sink += (int32_t)(logf(1.0f + i * 0.01f) * 65536.0f); }
+void case_fx_ln(uint32_t i) { fx_sink += fx_ln(FX_ONE + i * 655); }
+
+
+uint8_t *bench_field_map;
+uint16_t bench_field_lut[FIELD_LUT_SIZE];
+
+static const field_wave_t plasma_waves[] = {
+    {267018, 0},
+    {0, 178012},
+    {133508, 133508},
+};
+
+/**
+ * @brief Allocates the field map, if not done yet, and builds the color LUT.
+ *
+ * @return false if there is no memory for the map.
+ */
+bool bench_field_init(void) {
+    uint16_t cycle[10];
+    for (uint16_t k = 0; k < 10; k++) cycle[k] = BENCH_COLOR(k);
+    field_lut_cycle(bench_field_lut, cycle, 10);
+
+    if (bench_field_map == NULL) bench_field_map = malloc(FIELD_MAP_SIZE);
+    return bench_field_map != NULL;
+}
+
+void bench_field_free(void) {
+    free(bench_field_map);
+    bench_field_map = NULL;
+}
+
+void case_tunnel_map(uint32_t i) { field_tunnel(bench_field_map, 20); }
+void case_plasma_map(uint32_t i) { field_sines(bench_field_map, plasma_waves, 3, 9830); }
+void case_field_frame(uint32_t i) { field_render(bench_field_map, i * 26, bench_field_lut); }
+
+
+static particle_system_t ps;
+static aos_particle_t *aos;
+static uint16_t aos_count;
+
+static const uint16_t spark_colors[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+static const particle_emitter_t burst = {
+    .x = PARTICLE_FROM_INT(TFT_WIDTH / 2),
+    .y = PARTICLE_FROM_INT(TFT_HEIGHT / 2),
+    .spread_x = 2 * PARTICLE_ONE,
+    .spread_y = 2 * PARTICLE_ONE,
+    .life = 60,
+    .life_spread = 30,
+    .colors = spark_colors,
+    .color_count = sizeof(spark_colors) / sizeof(spark_colors[0]),
+};
+
+/**
+ * @brief Sets up both particle systems with count live particles.
+ *
+ * The AoS particles start at the center with random speeds, the SoA system
+ * gets one burst of the same size. The seed is fixed so every run starts
+ * from the same particles. Earlier systems are freed first.
+ *
+ * @return false if there is no memory for them.
+ */
+bool bench_particles_init(uint16_t count) {
+    bench_particles_free();
+    aos = malloc(count * sizeof(aos_particle_t));
+    if (aos == NULL || !particle_system_init(&ps, count, 1)) {
+        bench_particles_free();
+        return false;
+    }
+    aos_count = count;
+
+    srand(1);
+    for (uint16_t p = 0; p < count; p++) {
+        aos[p] = (aos_particle_t){TFT_WIDTH / 2, TFT_HEIGHT / 2,
+                                  (rand() % 200 - 100) / 50.0f, (rand() % 200 - 100) / 50.0f, 1 + p % 9};
+    }
+    ps.ay = 3;
+    particle_emit(&ps, &burst, count);
+    return true;
+}
+
+void bench_particles_free(void) {
+    particle_system_free(&ps);
+    free(aos);
+    aos = NULL;
+    aos_count = 0;
+}
+
+//keeps the system full, as the AoS version does by respawning in place
+void case_soa_update(uint32_t i) {
+    particle_emit(&ps, &burst, ps.free_count);
+    particle_update(&ps);
+}
+void case_soa_render(uint32_t i) { particle_render(&ps); }
+void case_aos_update(uint32_t i) { ref_aos_update(aos, aos_count); }
+void case_aos_render(uint32_t i) { ref_aos_render(aos, aos_count); }
+
+
+#if FRAME_BUFFER_BPP == 16
+void case_ref_clear(uint32_t i) { ref_rectangle(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, BENCH_COLOR(i)); }
+void case_ref_columns(uint32_t i) {
+    for (uint16_t x = 0; x < TFT_WIDTH; x++) {
+        ref_rectangle(x, 0, x, TFT_HEIGHT - 1, BENCH_COLOR(i + x));
+    }
+}
+void case_ref_rect(uint32_t i, int16_t a, int16_t b) {
+    uint16_t x = rect_x(i, a), y = rect_y(i, b);
+    ref_rectangle(x, y, x + a - 1, y + b - 1, BENCH_COLOR(i));
+}
+
+
+static uint16_t sprite_pixels[BENCH_SPRITE_MAX * BENCH_SPRITE_MAX];
+static uint8_t sprite_alpha[BENCH_SPRITE_MAX * BENCH_SPRITE_MAX];
+static sprite_t sprite;
+
+/**
+ * @brief Builds a round test sprite of size x size pixels.
+ *
+ * Pixels outside the circle get the key color and zero alpha, the rim is
+ * half transparent and the inside is opaque, so all three blit modes hit
+ * their skip, copy and blend paths. Sizes of 0 or over BENCH_SPRITE_MAX
+ * build the largest sprite, which the blend cases read their rows from.
+ */
+void bench_make_sprite(uint16_t size) {
+    if (size == 0 || size > BENCH_SPRITE_MAX) size = BENCH_SPRITE_MAX;
+    int32_t r = size / 2;
+    for (int32_t y = 0; y < size; y++) {
+        for (int32_t x = 0; x < size; x++) {
+            int32_t d = (x - r) * (x - r) + (y - r) * (y - r);
+            uint32_t i = y * size + x;
+            sprite_pixels[i] = (d > r * r) ? BENCH_SPRITE_KEY : rgb888_to_rgb565(x * 255 / size, y * 255 / size, 128);
+            sprite_alpha[i] = (d > r * r) ? 0 : (d > (r - 2) * (r - 2)) ? 128 : 255;
+        }
+    }
+    sprite = (sprite_t){sprite_pixels, sprite_alpha, size, size, size};
+}
+
+void case_blit(uint32_t i) { blit(&sprite, 0, 0, BLIT_FULL_W, BLIT_FULL_H, bench_x(i) - 16, bench_y(i) - 16); }
+void case_blit_keyed(uint32_t i) {
+    blit_keyed(&sprite, 0, 0, BLIT_FULL_W, BLIT_FULL_H, bench_x(i) - 16, bench_y(i) - 16, BENCH_SPRITE_KEY);
+}
+void case_blit_alpha(uint32_t i) { blit_alpha(&sprite, 0, 0, BLIT_FULL_W, BLIT_FULL_H, bench_x(i) - 16, bench_y(i) - 16); }
+void case_ref_blit(uint32_t i) {
+    int16_t x0 = bench_x(i) - 16, y0 = bench_y(i) - 16;
+    for (uint16_t y = 0; y < sprite.height; y++) {
+        for (uint16_t x = 0; x < sprite.width; x++) {
+            draw_pixel(x0 + x, y0 + y, sprite.pixels[y * sprite.stride + x]);
+        }
+    }
+}
+
+void case_blend_fill(uint32_t i, uint8_t alpha) { fill_rect_alpha(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, 0xF800, alpha); }
+void case_ref_blend_fill(uint32_t i, uint8_t alpha) { ref_fill_rect_alpha(0, 0, TFT_WIDTH - 1, TFT_HEIGHT - 1, 0xF800, alpha); }
+void case_blend_rows(uint32_t i, uint8_t alpha) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+        blend_row(&fb[y * TFT_WIDTH], &sprite_pixels[(y & 63) * BENCH_SPRITE_MAX], BENCH_SPRITE_MAX, alpha);
+    }
+}
+void case_ref_blend_rows(uint32_t i, uint8_t alpha) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+        ref_blend_row(&fb[y * TFT_WIDTH], &sprite_pixels[(y & 63) * BENCH_SPRITE_MAX], BENCH_SPRITE_MAX, alpha);
+    }
+}
+void case_blend_alpha8(uint32_t i) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+        uint32_t s = (y & 63) * BENCH_SPRITE_MAX;
+        blend_row_alpha8(&fb[y * TFT_WIDTH], &sprite_pixels[s], &sprite_alpha[s], BENCH_SPRITE_MAX);
+    }
+}
+void case_ref_blend_alpha8(uint32_t i) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = 0; y < TFT_HEIGHT; y++) {
+        uint32_t s = (y & 63) * BENCH_SPRITE_MAX;
+        ref_blend_row_alpha8(&fb[y * TFT_WIDTH], &sprite_pixels[s], &sprite_alpha[s], BENCH_SPRITE_MAX);
+    }
+}
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include "bench_ref.h"
+
+//Benchmark cases and fixtures shared by the on-device benchmarks (bench.c)
+//and the host suite (host/src/bench.c), so both time the same code. Every
+//case takes the call index i, which moves the primitive around the screen
+//and picks its color; sized cases take their size in a and b.
+
+#define BENCH_SPRITE_MAX 64
+#define BENCH_SPRITE_KEY 0xF81F
+#define BENCH_PARTICLE_MAX 4000
+
+#if FRAME_BUFFER_BPP == 16
+#define BENCH_COLOR(i) ((uint16_t)((i) * 0x2965 + 0x0841))
+#else
+#define BENCH_COLOR(i) ((i) & ((1 << FRAME_BUFFER_BPP) - 1))
+#endif
+
+static inline int16_t bench_x(uint32_t i) { return (i * 37) % TFT_WIDTH; }
+static inline int16_t bench_y(uint32_t i) { return (i * 53) % TFT_HEIGHT; }
+
+//Fills: the whole screen, one rectangle per column, an a x b rectangle
+void case_clear(uint32_t i);
+void case_columns(uint32_t i);
+void case_rect(uint32_t i, int16_t a, int16_t b);
+
+//Shapes: radius a (inner radius b for the arc), triangle side a, ellipse
+//radii a and b, rounded rectangle a x b
+void case_circle(uint32_t i, int16_t a, int16_t b);
+void case_ref_circle(uint32_t i, int16_t a, int16_t b);
+void case_fill_circle(uint32_t i, int16_t a, int16_t b);
+void case_ref_fill_circle(uint32_t i, int16_t a, int16_t b);
+void case_fill_triangle(uint32_t i, int16_t a, int16_t b);
+void case_ref_fill_triangle(uint32_t i, int16_t a, int16_t b);
+void case_fill_ellipse(uint32_t i, int16_t a, int16_t b);
+void case_fill_round_rect(uint32_t i, int16_t a, int16_t b);
+void case_fill_arc(uint32_t i, int16_t a, int16_t b);
+
+//Fixed-point math next to libm
+void case_sinf(uint32_t i);
+void case_fx_sin(uint32_t i);
+void case_atan2f(uint32_t i);
+void case_fx_atan2(uint32_t i);
+void case_sqrtf(uint32_t i);
+void case_fx_isqrt(uint32_t i);
+void case_logf(uint32_t i);
+void case_fx_ln(uint32_t i);
+
+//Field maps of the tunnel and plasma effects
+extern uint8_t *bench_field_map;
+extern uint16_t bench_field_lut[];
+bool bench_field_init(void);
+void bench_field_free(void);
+void case_tunnel_map(uint32_t i);
+void case_plasma_map(uint32_t i);
+void case_field_frame(uint32_t i);
+
+//Particles: the SoA engine and float AoS particles with the same population
+bool bench_particles_init(uint16_t count);
+void bench_particles_free(void);
+void case_soa_update(uint32_t i);
+void case_soa_render(uint32_t i);
+void case_aos_update(uint32_t i);
+void case_aos_render(uint32_t i);
+
+#if FRAME_BUFFER_BPP == 16
+void case_ref_clear(uint32_t i);
+void case_ref_columns(uint32_t i);
+void case_ref_rect(uint32_t i, int16_t a, int16_t b);
+
+//Sprites of bench_make_sprite's size, and 64-pixel wide rows blended over the screen
+void bench_make_sprite(uint16_t size);
+void case_blit(uint32_t i);
+void case_blit_keyed(uint32_t i);
+void case_blit_alpha(uint32_t i);
+void case_ref_blit(uint32_t i);
+void case_blend_fill(uint32_t i, uint8_t alpha);
+void case_ref_blend_fill(uint32_t i, uint8_t alpha);
+void case_blend_rows(uint32_t i, uint8_t alpha);
+void case_ref_blend_rows(uint32_t i, uint8_t alpha);
+void case_blend_alpha8(uint32_t i);
+void case_ref_blend_alpha8(uint32_t i);
+#endif
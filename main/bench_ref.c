@@ -0,0 +1,177 @@
+#include "bench_ref.h"
+#include "st7789_shapes.h"
+#include "st7789_fxmath.h"
+#include <stdlib.h>
+#include <math.h>
+
+//Straightforward versions of the optimized kernels, as the code drew before
+//each optimization. The benchmarks run them next to the real kernels.
+
+
+void ref_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+    int x = r;
+    int y = 0;
+    int err = 0;
+
+    while (x >= y) {
+        draw_pixel(x0 + x, y0 + y, color);
+        draw_pixel(x0 + y, y0 + x, color);
+        draw_pixel(x0 - y, y0 + x, color);
+        draw_pixel(x0 - x, y0 + y, color);
+        draw_pixel(x0 - x, y0 - y, color);
+        draw_pixel(x0 - y, y0 - x, color);
+        draw_pixel(x0 + y, y0 - x, color);
+        draw_pixel(x0 + x, y0 - y, color);
+
+        if (err <= 0) {
+            y += 1;
+            err += 2 * y + 1;
+        }
+        if (err > 0) {
+            x -= 1;
+            err -= 2 * x + 1;
+        }
+    }
+}
+
+void ref_fill_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+    int32_t limit = (int32_t)r * r + r;
+    for (int dy = -r; dy <= r; dy++) {
+        for (int dx = -r; dx <= r; dx++) {
+            if (dx * dx + dy * dy <= limit) draw_pixel(x0 + dx, y0 + dy, color);
+        }
+    }
+}
+
+void ref_fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+    int16_t min_x = (x0 < x1) ? x0 : x1;
+    int16_t max_x = (x0 > x1) ? x0 : x1;
+    int16_t min_y = (y0 < y1) ? y0 : y1;
+    int16_t max_y = (y0 > y1) ? y0 : y1;
+    min_x = (x2 < min_x) ? x2 : min_x;
+    max_x = (x2 > max_x) ? x2 : max_x;
+    min_y = (y2 < min_y) ? y2 : min_y;
+    max_y = (y2 > max_y) ? y2 : max_y;
+
+    int32_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0) return;
+
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+            int32_t w0 = (x1 - x) * (y2 - y) - (y1 - y) * (x2 - x);
+            int32_t w1 = (x2 - x) * (y0 - y) - (y2 - y) * (x0 - x);
+            int32_t w2 = (x0 - x) * (y1 - y) - (y0 - y) * (x1 - x);
+            if (area < 0) { w0 = -w0; w1 = -w1; w2 = -w2; }
+            if (w0 >= 0 && w1 >= 0 && w2 >= 0) draw_pixel(x, y, color);
+        }
+    }
+}
+
+
+void ref_tunnel_float(uint32_t frame) {
+    float t = frame * 0.5f;
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            float fx = (x - TFT_WIDTH / 2.0f) / (TFT_WIDTH / 2.0f);
+            float fy = (y - TFT_HEIGHT / 2.0f) / (TFT_HEIGHT / 2.0f);
+            float value = logf(sqrtf(fx * fx + fy * fy) * 20 + 1) + t;
+            draw_pixel(x, y, ((int)(value * 10)) % 10);
+        }
+    }
+}
+
+void ref_tunnel_fixed(uint32_t frame) {
+    fx16_t t = FX_FROM_INT(frame) / 2;
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        int32_t ny = ((2 * y - TFT_HEIGHT) << 12) / TFT_HEIGHT;
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            int32_t nx = ((2 * x - TFT_WIDTH) << 12) / TFT_WIDTH;
+            uint32_t radius = fx_isqrt(nx * nx + ny * ny);
+            fx16_t value = fx_ln(((radius * 20) << 4) + FX_ONE) + t;
+            draw_pixel(x, y, FX_TO_INT(value * 10) % 10);
+        }
+    }
+}
+
+void ref_plasma_float(uint32_t frame) {
+    float t = frame * 0.1f;
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            float v = sinf(x / 10.0f + t) + sinf(y / 15.0f + t) + sinf((x + y) / 20.0f + t);
+            draw_pixel(x, y, ((int)((v + 3) * 1.5f)) % 10);
+        }
+    }
+}
+
+void ref_plasma_fixed(uint32_t frame) {
+    uint16_t t = frame * FX_ANGLE_PER_RAD / 10;
+    for (int y = 0; y < TFT_HEIGHT; y++) {
+        uint16_t ay = ((y * 178012) >> 8) + t;
+        for (int x = 0; x < TFT_WIDTH; x++) {
+            uint16_t ax = ((x * 267018) >> 8) + t;
+            uint16_t axy = (((x + y) * 133508) >> 8) + t;
+            int32_t v = fx_sin(ax) + fx_sin(ay) + fx_sin(axy);
+            draw_pixel(x, y, (((v + 3 * FX_TRIG_ONE) * 3) >> 16) % 10);
+        }
+    }
+}
+
+
+void ref_aos_update(aos_particle_t *particles, uint16_t count) {
+    for (uint16_t p = 0; p < count; p++) {
+        particles[p].x += particles[p].vx;
+        particles[p].y += particles[p].vy;
+        particles[p].vy += 0.05f;
+        if (particles[p].y > TFT_HEIGHT) {
+            particles[p].x = TFT_WIDTH / 2;
+            particles[p].y = TFT_HEIGHT / 2;
+            particles[p].vx = (rand() % 200 - 100) / 50.0f;
+            particles[p].vy = (rand() % 200 - 100) / 50.0f;
+        }
+    }
+}
+void ref_aos_render(const aos_particle_t *particles, uint16_t count) {
+    for (uint16_t p = 0; p < count; p++) {
+        draw_pixel((int)particles[p].x, (int)particles[p].y, particles[p].color);
+    }
+}
+
+
+#if FRAME_BUFFER_BPP == 16
+void ref_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = y1; y <= y2; y++) {
+        for (uint16_t x = x1; x <= x2; x++) {
+            fb[y * TFT_WIDTH + x] = color;
+        }
+    }
+}
+
+static inline uint16_t ref_blend(uint16_t fg, uint16_t bg, uint8_t alpha) {
+    uint8_t r = (((fg >> 11) & 0x1F) * alpha + ((bg >> 11) & 0x1F) * (255 - alpha)) / 255;
+    uint8_t g = (((fg >> 5) & 0x3F) * alpha + ((bg >> 5) & 0x3F) * (255 - alpha)) / 255;
+    uint8_t b = ((fg & 0x1F) * alpha + (bg & 0x1F) * (255 - alpha)) / 255;
+    return (r << 11) | (g << 5) | b;
+}
+
+void ref_fill_rect_alpha(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha) {
+    uint16_t *fb = get_frame_buffer();
+    for (uint16_t y = y1; y <= y2; y++) {
+        for (uint16_t x = x1; x <= x2; x++) {
+            fb[y * TFT_WIDTH + x] = ref_blend(color, fb[y * TFT_WIDTH + x], alpha);
+        }
+    }
+}
+
+void ref_blend_row(uint16_t *dst, const uint16_t *src, uint32_t count, uint8_t alpha) {
+    for (uint32_t x = 0; x < count; x++) {
+        dst[x] = ref_blend(src[x], dst[x], alpha);
+    }
+}
+
+void ref_blend_row_alpha8(uint16_t *dst, const uint16_t *src, const uint8_t *alpha, uint32_t count) {
+    for (uint32_t x = 0; x < count; x++) {
+        dst[x] = ref_blend(src[x], dst[x], alpha[x]);
+    }
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+#include "st7789.h"
+
+//Reference kernels for the benchmarks: per-pixel shapes and fills, float
+//effect frames and array-of-structs particles, as the code was before each
+//optimization. Shared by the on-device benchmarks and the host suite.
+
+//Array-of-structs float particles as draw_fireworks kept them before the engine
+typedef struct {
+    float x, y, vx, vy;
+    uint16_t color;
+} aos_particle_t;
+
+void ref_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void ref_fill_circle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+void ref_fill_triangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
+
+//Tunnel and plasma frames as TOHA drew them: float math, then fixed point per pixel
+void ref_tunnel_float(uint32_t frame);
+void ref_tunnel_fixed(uint32_t frame);
+void ref_plasma_float(uint32_t frame);
+void ref_plasma_fixed(uint32_t frame);
+
+void ref_aos_update(aos_particle_t *particles, uint16_t count);
+void ref_aos_render(const aos_particle_t *particles, uint16_t count);
+
+#if FRAME_BUFFER_BPP == 16
+//Per-pixel rectangle fill as draw_rectangle did it before the word-wide kernels
+void ref_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+
+//Per-channel blends as they would be written without the spread trick, with
+//the same arguments as fill_rect_alpha, blend_row and blend_row_alpha8
+void ref_fill_rect_alpha(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, uint8_t alpha);
+void ref_blend_row(uint16_t *dst, const uint16_t *src, uint32_t count, uint8_t alpha);
+void ref_blend_row_alpha8(uint16_t *dst, const uint16_t *src, const uint8_t *alpha, uint32_t count);
+#endif
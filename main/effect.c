@@ -0,0 +1,178 @@
+#include "effect.h"
+#include "st7789_pacer.h"
+#include "st7789_perf.h"
+#include "esp_timer.h"
+
+
+static const char *TAG = "effect";
+
+static const effect_t *effects[EFFECT_MAX];
+static effect_stats_t stats[EFFECT_MAX];
+static uint8_t count = 0;
+
+static int64_t frame_start_us;
+static int64_t frame_budget_us;
+
+
+/**
+ * @brief Adds an effect to the registry.
+ *
+ * The effect is referenced, not copied, so it must stay valid.
+ *
+ * @param effect The effect to add.
+ * @return false if the registry is full or the effect has no timestep.
+ */
+bool effect_register(const effect_t *effect) {
+    if (count >= EFFECT_MAX || effect->step_ms == 0) return false;
+    effects[count] = effect;
+    memset(&stats[count], 0, sizeof(effect_stats_t));
+    stats[count].min_us = UINT32_MAX;
+    count++;
+    return true;
+}
+
+/**
+ * @brief Returns the number of registered effects.
+ */
+uint8_t effect_count(void) {
+    return count;
+}
+
+/**
+ * @brief Returns a registered effect, NULL if the index is out of range.
+ */
+const effect_t *effect_get(uint8_t index) {
+    return (index < count) ? effects[index] : NULL;
+}
+
+/**
+ * @brief Returns the frame statistics of an effect, NULL if the index is out of range.
+ */
+const effect_stats_t *effect_get_stats(uint8_t index) {
+    return (index < count) ? &stats[index] : NULL;
+}
+
+/**
+ * @brief Clears the statistics of every effect.
+ */
+void effect_reset_stats(void) {
+    for (uint8_t i = 0; i < count; i++) {
+        memset(&stats[i], 0, sizeof(effect_stats_t));
+        stats[i].min_us = UINT32_MAX;
+    }
+}
+
+/**
+ * @brief Tells whether the current frame has used up its CPU budget.
+ */
+static bool frame_over_budget(void) {
+    return esp_timer_get_time() - frame_start_us > frame_budget_us;
+}
+
+/**
+ * @brief Runs the due steps of one frame, renders it and flushes it, or
+ * hands it to the effect's present().
+ *
+ * At most EFFECT_MAX_CATCHUP steps are run, the rest are dropped. Catch-up
+ * steps also stop once the frame is over its CPU budget, so a slow step is
+ * not repeated back to back; the first due step always runs.
+ */
+static void effect_frame(const effect_t *e, effect_stats_t *st, uint32_t due) {
+    frame_start_us = esp_timer_get_time();
+    PERF_FRAME_BEGIN();
+
+    if (due > EFFECT_MAX_CATCHUP) {
+        st->dropped_steps += due - EFFECT_MAX_CATCHUP;
+        due = EFFECT_MAX_CATCHUP;
+    }
+    uint32_t n = 0;
+    for (; n < due; n++) {
+        if (n > 0 && frame_over_budget()) break;
+        if (e->step) e->step(e->step_ms);
+    }
+    st->steps += n;
+    st->dropped_steps += due - n;
+
+    if (e->render) e->render();
+    if (e->present) {
+        e->present();
+    } else {
+        flush_frame_buffer();
+    }
+
+    uint32_t used = esp_timer_get_time() - frame_start_us;
+    st->frames++;
+    st->total_us += used;
+    if (used < st->min_us) st->min_us = used;
+    if (used > st->max_us) st->max_us = used;
+    if (used > frame_budget_us) st->over_budget++;
+}
+
+/**
+ * @brief Runs one effect for its duration with a fixed timestep.
+ *
+ * Frames are paced by a frame_pacer_t with the effect's timestep as period.
+ * Every frame runs one step, plus one for every frame the pacer had to drop,
+ * then renders and flushes. Waiting for the deadline blocks the task, so
+ * other tasks run between frames; a late frame still blocks for one tick,
+ * counted in the steps dropped for it.
+ * Frames that take longer than EFFECT_BUDGET_PERCENT of the timestep are
+ * counted as over budget.
+ *
+ * @param index The registry index of the effect.
+ * @return false if the index is out of range or the effect failed to start.
+ */
+bool effect_run(uint8_t index) {
+    if (index >= count) return false;
+
+    const effect_t *e = effects[index];
+    effect_stats_t *st = &stats[index];
+    if (e->init && !e->init()) {
+        ESP_LOGW(TAG, "%s: init failed", e->name);
+        return false;
+    }
+    //created after init, so the first deadline does not count the time init took
+    frame_pacer_t pacer;
+    if (!frame_pacer_init(&pacer, e->step_ms * 1000)) {
+        ESP_LOGW(TAG, "%s: no frame timer", e->name);
+        if (e->teardown) e->teardown();
+        return false;
+    }
+    st->runs++;
+    frame_budget_us = (int64_t)e->step_ms * 1000 * EFFECT_BUDGET_PERCENT / 100;
+
+    int64_t start = esp_timer_get_time();
+    effect_frame(e, st, 0); //the first frame shows the initial state
+    while (esp_timer_get_time() - start < (int64_t)e->duration_ms * 1000) {
+        uint32_t dropped = frame_pacer_wait(&pacer);
+        effect_frame(e, st, 1 + dropped);
+    }
+
+    st->late_frames += pacer.late_frames;
+    st->jitter_total_us += pacer.jitter_total_us;
+    st->paced_frames += pacer.frames;
+    if (pacer.jitter_max_us > st->jitter_max_us) st->jitter_max_us = pacer.jitter_max_us;
+    frame_pacer_deinit(&pacer);
+
+    if (e->teardown) e->teardown();
+    if (e->hold_ms) vTaskDelay(pdMS_TO_TICKS(e->hold_ms));
+    return true;
+}
+
+/**
+ * @brief Logs the frame statistics of every effect that has run.
+ */
+void effect_log_stats(void) {
+    ESP_LOGI(TAG, "%-16s %5s %7s %8s %8s %8s %6s %6s %6s %8s %8s",
+             "effect", "runs", "frames", "min us", "avg us", "max us", "over", "late", "drop", "jit avg", "jit max");
+    for (uint8_t i = 0; i < count; i++) {
+        const effect_stats_t *st = &stats[i];
+        if (st->frames == 0) continue;
+        uint32_t jitter_avg = st->paced_frames ? st->jitter_total_us / st->paced_frames : 0;
+        ESP_LOGI(TAG, "%-16s %5lu %7lu %8lu %8lu %8lu %6lu %6lu %6lu %8lu %8lu", effects[i]->name,
+                 (unsigned long)st->runs, (unsigned long)st->frames, (unsigned long)st->min_us,
+                 (unsigned long)(st->total_us / st->frames), (unsigned long)st->max_us,
+                 (unsigned long)st->over_budget, (unsigned long)st->late_frames,
+                 (unsigned long)st->dropped_steps, (unsigned long)jitter_avg, (unsigned long)st->jitter_max_us);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "st7789.h"
+
+//Effect registry and fixed-timestep scheduler. An effect never loops or
+//delays on its own: the scheduler calls step() once per elapsed timestep,
+//then render() and the flush, and blocks until the next frame deadline.
+//Effects that send only what they changed provide present(), which replaces
+//the full flush_frame_buffer.
+
+#define EFFECT_MAX 24
+#define EFFECT_MAX_CATCHUP 4 //steps run at most per frame, the rest of the backlog is dropped
+#define EFFECT_BUDGET_PERCENT 80 //share of the timestep one frame may use, catch-up steps stop beyond it
+
+typedef struct {
+    const char *name;
+    uint32_t duration_ms; //how long the scheduler runs the effect
+    uint32_t step_ms; //fixed timestep, also the frame interval
+    uint32_t hold_ms; //pause on the last frame before the next effect
+    bool (*init)(void); //optional, false aborts the effect
+    void (*step)(uint32_t dt_ms); //optional, advances the state by one timestep
+    void (*render)(void); //optional, draws the current state into the frame buffer
+    void (*present)(void); //optional, sends the frame instead of flush_frame_buffer
+    void (*teardown)(void); //optional
+} effect_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t frames;
+    uint32_t steps;
+    uint32_t dropped_steps; //timesteps skipped because the effect fell behind
+    uint32_t over_budget; //frames that used more than the CPU budget
+    uint32_t late_frames; //frames that started after their deadline
+    uint32_t min_us; //frame time: steps, render and flush
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t paced_frames; //frames started by the pacer, the first frame of each run is not
+    uint32_t jitter_max_us; //largest deviation of a frame interval from the timestep
+    uint64_t jitter_total_us;
+} effect_stats_t;
+
+bool effect_register(const effect_t *effect);
+uint8_t effect_count(void);
+const effect_t *effect_get(uint8_t index);
+const effect_stats_t *effect_get_stats(uint8_t index);
+void effect_reset_stats(void);
+bool effect_run(uint8_t index);
+void effect_log_stats(void);
@@ -0,0 +1,196 @@
+#include "workload.h"
+#include "st7789_transport.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include <stdlib.h>
+
+
+static const char *TAG = "workload";
+
+static const workload_t *workloads[WORKLOAD_MAX];
+static workload_result_t results[WORKLOAD_MAX];
+static uint8_t count = 0;
+
+static uint32_t rng = 1;
+static uint32_t frame_us[WORKLOAD_MAX_FRAMES];
+
+//Transport that forwards to the one in use and counts bytes and blocked cycles
+static const st7789_transport_t *inner;
+static uint64_t bus_bytes;
+static uint64_t bus_wait_cycles;
+
+
+static void counting_init(void) {
+    inner->init();
+}
+
+static void counting_set_dc(uint32_t level) {
+    inner->set_dc(level);
+}
+
+static void counting_set_reset(uint32_t level) {
+    inner->set_reset(level);
+}
+
+static void counting_write(const void *data, size_t size) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    inner->write(data, size);
+    bus_wait_cycles += esp_cpu_get_cycle_count() - start;
+    bus_bytes += size;
+}
+
+static void counting_queue(const void *data, size_t size) {
+    inner->queue(data, size);
+    bus_bytes += size;
+}
+
+static void counting_wait(void) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    inner->wait();
+    bus_wait_cycles += esp_cpu_get_cycle_count() - start;
+}
+
+static void counting_backlight(uint8_t duty) {
+    inner->backlight(duty);
+}
+
+static const st7789_transport_t counting_transport = {
+    .init = counting_init,
+    .set_dc = counting_set_dc,
+    .set_reset = counting_set_reset,
+    .write = counting_write,
+    .queue = counting_queue,
+    .wait = counting_wait,
+    .backlight = counting_backlight,
+};
+
+
+/**
+ * @brief Adds a workload to the registry.
+ *
+ * @param workload The workload to add, referenced, not copied.
+ * @return false if the registry is full or the workload has no frames.
+ */
+bool workload_register(const workload_t *workload) {
+    if (count >= WORKLOAD_MAX || workload->frames == 0 || workload->frame == NULL) return false;
+    workloads[count] = workload;
+    memset(&results[count], 0, sizeof(workload_result_t));
+    count++;
+    return true;
+}
+
+/**
+ * @brief Returns the next number of the workload's xorshift32 sequence.
+ *
+ * The sequence restarts from the workload's seed every run, so workloads must
+ * draw their random positions and colors from here and not from rand().
+ */
+uint32_t workload_rand(void) {
+    uint32_t s = rng;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    rng = s;
+    return s;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the nearest-rank percentile of a sorted array.
+ */
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t p) {
+    uint32_t rank = (p * n + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/**
+ * @brief Runs one workload for its frame count and measures every frame.
+ *
+ * The driver's transport is wrapped for the duration of the run so the bytes
+ * sent and the time spent blocked on the bus are counted for any transport.
+ * The frames run back to back; the task only yields before and after.
+ *
+ * @param index The registry index of the workload.
+ * @param result Filled with the measurements, may be NULL.
+ * @return false if the index is out of range, init failed or INIT has not run.
+ */
+bool workload_run(uint8_t index, workload_result_t *result) {
+    if (index >= count || st7789_get_transport() == NULL) return false;
+
+    const workload_t *w = workloads[index];
+    rng = w->seed ? w->seed : 1;
+    if (w->init && !w->init()) {
+        ESP_LOGW(TAG, "%s: init failed", w->name);
+        return false;
+    }
+    vTaskDelay(1);
+
+    inner = st7789_get_transport();
+    st7789_set_transport(&counting_transport);
+    bus_bytes = 0;
+    bus_wait_cycles = 0;
+
+    uint32_t frames = (w->frames < WORKLOAD_MAX_FRAMES) ? w->frames : WORKLOAD_MAX_FRAMES;
+    int64_t start = esp_timer_get_time();
+    int64_t last = start;
+    for (uint32_t n = 0; n < frames; n++) {
+        w->frame(n);
+        int64_t now = esp_timer_get_time();
+        frame_us[n] = now - last;
+        last = now;
+    }
+
+    st7789_set_transport(inner);
+    if (w->teardown) w->teardown();
+
+    workload_result_t *r = &results[index];
+    r->frames = frames;
+    r->total_us = last - start;
+    r->bus_bytes = bus_bytes;
+    r->bus_wait_us = bus_wait_cycles / esp_rom_get_cpu_ticks_per_us();
+    qsort(frame_us, frames, sizeof(uint32_t), compare_u32);
+    r->p50_us = percentile(frame_us, frames, 50);
+    r->p90_us = percentile(frame_us, frames, 90);
+    r->p99_us = percentile(frame_us, frames, 99);
+    r->max_us = frame_us[frames - 1];
+    if (result) *result = *r;
+
+    vTaskDelay(1);
+    return true;
+}
+
+/**
+ * @brief Runs every registered workload once, then logs the results.
+ */
+void workload_run_all(void) {
+    for (uint8_t i = 0; i < count; i++) {
+        workload_run(i, NULL);
+    }
+    workload_log_results();
+}
+
+/**
+ * @brief Logs the last result of every workload that has run.
+ *
+ * MB/s is the transport byte rate over the whole run. cpu % is the share of
+ * the run not spent blocked in transport writes and waits, so a workload at
+ * 100 % is bound by drawing and one well below it by the bus.
+ */
+void workload_log_results(void) {
+    ESP_LOGI(TAG, "%-14s %6s %7s %8s %8s %8s %8s %7s %6s", "workload", "frames", "fps", "p50 ms", "p90 ms",
+             "p99 ms", "max ms", "MB/s", "cpu %");
+    for (uint8_t i = 0; i < count; i++) {
+        const workload_result_t *r = &results[i];
+        if (r->frames == 0 || r->total_us == 0) continue;
+        uint32_t busy_us = (r->bus_wait_us < r->total_us) ? r->total_us - r->bus_wait_us : 0;
+        ESP_LOGI(TAG, "%-14s %6lu %7.1f %8.2f %8.2f %8.2f %8.2f %7.2f %6.1f", workloads[i]->name,
+                 (unsigned long)r->frames, r->frames * 1000000.0 / r->total_us, r->p50_us / 1000.0,
+                 r->p90_us / 1000.0, r->p99_us / 1000.0, r->max_us / 1000.0,
+                 (double)r->bus_bytes / r->total_us, busy_us * 100.0 / r->total_us);
+    }
+}
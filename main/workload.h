@@ -0,0 +1,32 @@
+#pragma once
+#include "st7789.h"
+
+//Deterministic benchmark workloads. Each one draws a fixed number of frames
+//back to back, with no delays, from its own seed, so two runs of the same
+//build send the same pixels and their numbers can be compared.
+
+#define WORKLOAD_MAX 12
+#define WORKLOAD_MAX_FRAMES 240
+
+typedef struct {
+    const char *name;
+    uint32_t frames;
+    uint32_t seed; //seeds workload_rand before init
+    bool (*init)(void); //optional, false skips the workload
+    void (*frame)(uint32_t n); //draws frame n and sends it to the panel
+    void (*teardown)(void); //optional
+} workload_t;
+
+typedef struct {
+    uint32_t frames;
+    uint64_t total_us;
+    uint32_t p50_us, p90_us, p99_us, max_us; //frame time percentiles
+    uint64_t bus_bytes; //bytes written to the transport
+    uint64_t bus_wait_us; //time blocked in transport writes and waits
+} workload_result_t;
+
+bool workload_register(const workload_t *workload);
+uint32_t workload_rand(void);
+bool workload_run(uint8_t index, workload_result_t *result);
+void workload_run_all(void);
+void workload_log_results(void);
@@ -0,0 +1,48 @@
+import math
+import sys
+
+# Genera las tablas de st7789_fxmath en tiempo de compilacion.
+# Uso: python gen_fxmath_tables.py <salida.c>
+
+SIN_BITS = 10          # entradas por vuelta = 2^SIN_BITS
+ATAN_BITS = 8          # entradas en [0, 1]
+SQRT_BITS = 8          # indice con los 8 bits altos normalizados
+LOG_BITS = 8           # entradas de la mantisa en [1, 2)
+
+ANGLE_ONE_TURN = 65536
+
+
+def table(name, ctype, values, per_line=8):
+    lines = [f"const {ctype} {name}[{len(values)}] = {{"]
+    for i in range(0, len(values), per_line):
+        chunk = ", ".join(str(v) for v in values[i:i + per_line])
+        lines.append(f"    {chunk},")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main(out_path):
+    n = 1 << SIN_BITS
+    # una entrada extra para interpolar sin comprobar el final de la tabla
+    sin_q15 = [round(math.sin(2 * math.pi * i / n) * 32767) for i in range(n + 1)]
+
+    n = 1 << ATAN_BITS
+    atan_angle = [round(math.atan(i / n) * ANGLE_ONE_TURN / (2 * math.pi)) for i in range(n + 1)]
+
+    # sqrt(i / 256) * 65536 para i en [64, 256], los valores normalizados caen en [0.25, 1)
+    sqrt_q16 = [min(65535, round(math.sqrt(i / 256) * 65536)) for i in range(64, 257)]
+
+    n = 1 << LOG_BITS
+    log2_q16 = [round(math.log2(1 + i / n) * 65536) for i in range(n + 1)]
+
+    with open(out_path, "w") as f:
+        f.write("// Generado por tools/gen_fxmath_tables.py, no editar\n")
+        f.write("#include <stdint.h>\n\n")
+        f.write(table("fx_sin_table", "int16_t", sin_q15) + "\n\n")
+        f.write(table("fx_atan_table", "uint16_t", atan_angle) + "\n\n")
+        f.write(table("fx_sqrt_table", "uint16_t", sqrt_q16) + "\n\n")
+        f.write(table("fx_log2_table", "uint32_t", log2_q16) + "\n")
+
+
+if __name__ == "__main__":
+    main(sys.argv[1])
@@ -1,14 +1,133 @@
 from PIL import Image
+import argparse
 import struct
 
-# Abrir imagen
-img = Image.open('tools/14.jpg')
-img = img.convert('RGB')
-img = img.resize((240, 135))  
+# Conversion RGB888 -> RGB565 identica a st7789_dither.c: mismos modos, misma
+# aritmetica entera y mismo recorrido (filas de arriba a abajo, pixeles de
+# izquierda a derecha), para que una imagen convertida aqui salga igual, bit
+# a bit, que las mismas filas convertidas en el dispositivo.
 
-with open('spiffs_image/14.bin', 'wb') as f:
+BAYER = [
+    [0, 8, 2, 10],
+    [12, 4, 14, 6],
+    [3, 11, 1, 9],
+    [15, 7, 13, 5],
+]
+CHANNEL_BITS = (5, 6, 5)
+
+
+def saturate(v):
+    return 0 if v < 0 else 255 if v > 255 else v
+
+
+def row_none(row):
+    return [((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3) for r, g, b in row]
+
+
+def row_ordered(row, y):
+    # El umbral cubre un paso del canal alrededor de 0: -4..3 con 5 bits y
+    # -2..1 con 6, asi la pantalla muestra en promedio el valor RGB888
+    threshold = BAYER[y % 4]
+    out = []
+    for x, (r, g, b) in enumerate(row):
+        t = threshold[x % 4] - 8
+        r = saturate(r + (t >> 1))
+        g = saturate(g + (t >> 2))
+        b = saturate(b + (t >> 1))
+        out.append(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3))
+    return out
+
+
+def row_diffusion(row, error):
+    # Floyd-Steinberg con un buffer de una linea, en 1/16: las entradas a la
+    # izquierda de x ya guardan el error que esta fila empuja a la siguiente.
+    # Python redondea >> hacia abajo igual que el desplazamiento aritmetico de C
+    width = len(row)
+    right = [0, 0, 0]
+    below = [0, 0, 0]
+    below_right = [0, 0, 0]
+    out = []
+    for x in range(width):
+        color = 0
+        for ch in range(3):
+            bits = CHANNEL_BITS[ch]
+            v = saturate(row[x][ch] + ((error[3 * x + ch] + right[ch] + 8) >> 4))
+            q = v >> (8 - bits)
+            shown = (q << (8 - bits)) | (q >> (2 * bits - 8))
+            err = v - shown
+
+            right[ch] = 7 * err
+            if x > 0:
+                error[3 * (x - 1) + ch] = below[ch] + 3 * err
+            below[ch] = below_right[ch] + 5 * err
+            below_right[ch] = err
+            color = (color << bits) | q
+        out.append(color)
+    if width > 0:
+        for ch in range(3):
+            error[3 * (width - 1) + ch] = below[ch]
+    return out
+
+
+def convert(img, mode):
+    # Devuelve los valores RGB565 de la imagen fila a fila
+    img = img.convert('RGB')
+    error = [0] * (img.width * 3)
+    pixels = img.load()
+    out = []
     for y in range(img.height):
-        for x in range(img.width):
-            r, g, b = img.getpixel((x, y))
-            rgb565 = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
-            f.write(struct.pack('H', rgb565))  
+        row = [pixels[x, y] for x in range(img.width)]
+        if mode == 'bayer':
+            out.extend(row_ordered(row, y))
+        elif mode == 'fs':
+            out.extend(row_diffusion(row, error))
+        else:
+            out.extend(row_none(row))
+    return out
+
+
+def read_bin(path):
+    # Lee una imagen ya convertida (RGB565 de load_image, 240x135) como RGB888
+    data = open(path, 'rb').read()
+    img = Image.new('RGB', (240, 135))
+    pixels = img.load()
+    for i, (c,) in enumerate(struct.iter_unpack('<H', data[:240 * 135 * 2])):
+        r, g, b = c >> 11, (c >> 5) & 0x3F, c & 0x1F
+        pixels[i % 240, i // 240] = ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+    return img
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convierte una imagen al formato de load_image')
+    parser.add_argument('input', nargs='?', default='tools/14.jpg')
+    parser.add_argument('output', nargs='?', default='spiffs_image/14.bin')
+    parser.add_argument('--dither', choices=('none', 'bayer', 'fs'), default='none')
+    parser.add_argument('--raw', action='store_true',
+                        help='guardar RGB888 sin convertir, para comparar con el dispositivo')
+    parser.add_argument('--jpeg', action='store_true',
+                        help='guardar un JPEG secuencial 4:2:0 para load_jpeg en vez de RGB565')
+    parser.add_argument('--quality', type=int, default=85)
+    args = parser.parse_args()
+
+    # Abrir imagen; un .bin es una imagen ya convertida
+    if args.input.endswith('.bin'):
+        img = read_bin(args.input)
+    else:
+        img = Image.open(args.input)
+        img = img.convert('RGB')
+        img = img.resize((240, 135))
+
+    if args.jpeg:
+        img.save(args.output, 'JPEG', quality=args.quality, subsampling=2, progressive=False, optimize=True)
+        return
+
+    with open(args.output, 'wb') as f:
+        if args.raw:
+            f.write(img.tobytes())
+        else:
+            for rgb565 in convert(img, args.dither):
+                f.write(struct.pack('H', rgb565))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,71 @@
+import argparse
+import os
+import struct
+import sys
+
+# Empaqueta los archivos de un directorio para la particion cruda de
+# ixora_storage.h (STORAGE_RAW). El dispositivo mapea la particion en memoria
+# y lee los archivos sin sistema de archivos.
+# Uso: python pack_assets.py spiffs_image assets.bin [--size 0x140000]
+#
+# Formato, little endian:
+#   cabecera  magic 'ASST' (u32), version (u16), numero de archivos (u16),
+#             tamano total de la imagen (u32)
+#   entradas  nombre (24 bytes, terminado en 0), offset (u32), tamano (u32)
+#   datos     cada archivo alineado a 4 bytes
+
+MAGIC = b'ASST'
+VERSION = 1
+NAME_LEN = 24
+HEADER = struct.Struct('<4sHHI')
+ENTRY = struct.Struct('<%dsII' % NAME_LEN)
+ALIGN = 4
+
+
+def align(n):
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+
+def pack(directory):
+    names = sorted(n for n in os.listdir(directory) if os.path.isfile(os.path.join(directory, n)))
+    for name in names:
+        if len(name.encode()) >= NAME_LEN:
+            sys.exit('nombre demasiado largo: %s' % name)
+
+    offset = align(HEADER.size + ENTRY.size * len(names))
+    entries = []
+    blobs = []
+    for name in names:
+        data = open(os.path.join(directory, name), 'rb').read()
+        entries.append(ENTRY.pack(name.encode(), offset, len(data)))
+        blobs.append((offset, data))
+        offset = align(offset + len(data))
+
+    image = bytearray(offset)
+    image[0:HEADER.size] = HEADER.pack(MAGIC, VERSION, len(names), offset)
+    for i, entry in enumerate(entries):
+        start = HEADER.size + i * ENTRY.size
+        image[start:start + ENTRY.size] = entry
+    for start, data in blobs:
+        image[start:start + len(data)] = data
+    return bytes(image), len(names)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Empaqueta archivos para la particion cruda de assets')
+    parser.add_argument('directory')
+    parser.add_argument('output')
+    parser.add_argument('--size', type=lambda s: int(s, 0), default=0,
+                        help='tamano de la particion, para fallar si no cabe')
+    args = parser.parse_args()
+
+    image, count = pack(args.directory)
+    if args.size and len(image) > args.size:
+        sys.exit('%d bytes no caben en la particion de %d' % (len(image), args.size))
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print('%d archivos, %d bytes' % (count, len(image)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,266 @@
+import argparse
+import re
+import sys
+
+# Analiza el volcado de trace_dump (st7789_trace.h) capturado del puerto serie.
+# Uso: python trace.py <log.txt | -> [--spi-hz 80000000] [--small 16] [--top 10] [--csv frames.csv]
+#
+# Da estadisticas por frame (transacciones, comandos, ventanas, bytes, tiempo
+# en el bus) y un analisis de huecos: el tiempo del flush que el bus pasa
+# parado entre transacciones y el coste de las transacciones pequenas, que es
+# lo que se puede recuperar juntando escrituras o encolandolas.
+
+TRACE_WRITE, TRACE_QUEUE, TRACE_WAIT, TRACE_FRAME = range(4)
+CMD_MODE = 0
+
+COMMANDS = {
+    0x00: "NOP", 0x01: "SWRESET", 0x10: "SLPIN", 0x11: "SLPOUT", 0x12: "PTLON", 0x13: "NORON",
+    0x20: "INVOFF", 0x21: "INVON", 0x28: "DISPOFF", 0x29: "DISPON", 0x2A: "CASET", 0x2B: "RASET",
+    0x2C: "RAMWR", 0x33: "VSCRDEF", 0x35: "TEON", 0x36: "MADCTL", 0x37: "VSCSAD", 0x3A: "COLMOD",
+    0x3C: "RAMWRC", 0xB2: "PORCTRL", 0xB7: "GCTRL", 0xBB: "VCOMS", 0xBC: "POWSAVE",
+}
+
+HEADER = re.compile(r"#TRACE cycles_per_us=(\d+) records=(\d+) overwritten=(\d+)")
+RECORD = re.compile(r"^T (\d+) (\d+) (\d) (\d) (\d+) ([0-9a-f]{8})\s*$")
+
+
+class Tx:
+    def __init__(self, start, dur, kind, dc, length, head):
+        self.start = start      # us
+        self.dur = dur          # us que la llamada bloqueo
+        self.kind = kind
+        self.dc = dc
+        self.length = length
+        self.head = head
+        self.cmd = None         # comando al que pertenecen los datos
+        self.bus_start = start  # intervalo estimado del bus
+        self.bus_end = start
+
+    def name(self):
+        if self.kind == TRACE_WAIT:
+            return "wait"
+        if self.dc == CMD_MODE:
+            return COMMANDS.get(self.head[0], "0x%02X" % self.head[0])
+        return "%s data" % COMMANDS.get(self.cmd, "?") if self.cmd is not None else "data"
+
+
+def parse(lines):
+    # se queda con el ultimo volcado completo del log
+    dumps = []
+    current = None
+    for line in lines:
+        m = HEADER.search(line)
+        if m:
+            current = {"cycles_per_us": int(m.group(1)), "overwritten": int(m.group(3)), "records": []}
+            continue
+        if current is None:
+            continue
+        if line.startswith("#END"):
+            dumps.append(current)
+            current = None
+            continue
+        m = RECORD.match(line)
+        if m:
+            current["records"].append(tuple(int(g) for g in m.groups()[:5]) + (bytes.fromhex(m.group(6)),))
+    if current is not None and current["records"]:
+        dumps.append(current)  # volcado cortado, se usa lo que haya
+    if not dumps:
+        sys.exit("no hay ningun volcado #TRACE en la entrada")
+    return dumps[-1]
+
+
+def build(dump, spi_hz):
+    cpu = dump["cycles_per_us"]
+    txs = []
+    base = None
+    offset = 0
+    last = None
+    for start, cycles, kind, dc, length, head in dump["records"]:
+        # el contador de ciclos es de 32 bits y da la vuelta
+        if last is not None and start < last and last - start > 1 << 31:
+            offset += 1 << 32
+        last = start
+        start += offset
+        if base is None:
+            base = start
+        txs.append(Tx((start - base) / cpu, cycles / cpu, kind, dc, length, head))
+
+    # tiempo estimado en el bus: las escrituras bloqueantes ocupan su duracion,
+    # las encoladas su tiempo de cable, siempre detras de lo que ya habia en cola
+    bus_free = 0.0
+    cmd = None
+    for t in txs:
+        if t.kind in (TRACE_WRITE, TRACE_QUEUE):
+            if t.dc == CMD_MODE:
+                cmd = t.head[0]
+            else:
+                t.cmd = cmd
+        wire = t.length * 8e6 / spi_hz
+        if t.kind == TRACE_WRITE:
+            # nunca menos que el tiempo de cable, el emulador del host no espera
+            t.bus_start = max(t.start, bus_free)
+            t.bus_end = t.bus_start + max(t.dur, wire)
+        elif t.kind == TRACE_QUEUE:
+            t.bus_start = max(t.start, bus_free)
+            t.bus_end = t.bus_start + wire
+        elif t.kind == TRACE_FRAME:
+            # el flush no puede empezar en el bus antes de que acabe el anterior
+            t.bus_start = t.bus_end = max(t.start, bus_free)
+        if t.kind in (TRACE_WRITE, TRACE_QUEUE):
+            bus_free = max(bus_free, t.bus_end)
+    return txs
+
+
+def split_frames(txs):
+    frames = []
+    current = []
+    for t in txs:
+        if t.kind == TRACE_FRAME:
+            if current:
+                frames.append(current)
+            current = [t]
+        else:
+            current.append(t)
+    if current:
+        frames.append(current)
+    return frames
+
+
+def frame_stats(frame, spi_hz, small):
+    bus = [t for t in frame if t.kind in (TRACE_WRITE, TRACE_QUEUE)]
+    s = {
+        "marker": frame[0].kind == TRACE_FRAME,
+        "start": frame[0].start,
+        "transactions": len(bus),
+        "commands": sum(1 for t in bus if t.dc == CMD_MODE),
+        "windows": sum(1 for t in bus if t.dc == CMD_MODE and t.head[0] in (0x2A, 0x2B)) // 2,
+        "small": sum(1 for t in bus if t.length <= small),
+        "bytes": sum(t.length for t in bus),
+        "busy_us": sum(t.bus_end - t.bus_start for t in bus),
+        "flush_us": 0.0,
+        "gap_us": 0.0,
+    }
+    s["wire_us"] = s["bytes"] * 8e6 / spi_hz
+    if bus:
+        s["flush_us"] = max(t.bus_end for t in bus) - frame[0].bus_start
+        s["gap_us"] = max(0.0, s["flush_us"] - s["busy_us"])
+    return s
+
+
+def gaps(frames):
+    # huecos del bus entre transacciones consecutivas de un mismo frame
+    out = []
+    for n, frame in enumerate(frames):
+        bus = [t for t in frame if t.kind in (TRACE_WRITE, TRACE_QUEUE)]
+        prev_end = frame[0].bus_start if frame[0].kind == TRACE_FRAME else None
+        prev = None
+        for t in bus:
+            if prev_end is not None and t.bus_start > prev_end:
+                out.append((t.bus_start - prev_end, n, prev, t))
+            prev_end = t.bus_end if prev_end is None else max(prev_end, t.bus_end)
+            prev = t
+    return out
+
+
+def size_class(length):
+    if length <= 1:
+        return "1 B"
+    if length <= 16:
+        return "2-16 B"
+    if length <= 256:
+        return "17-256 B"
+    return ">256 B"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Analiza un volcado de trace_dump")
+    parser.add_argument("log", help="log del puerto serie, - para la entrada estandar")
+    parser.add_argument("--spi-hz", type=float, default=80e6, help="reloj del SPI (clock_speed_hz)")
+    parser.add_argument("--small", type=int, default=16, help="bytes hasta los que una transaccion es pequena")
+    parser.add_argument("--top", type=int, default=10, help="huecos mas largos que se listan")
+    parser.add_argument("--csv", help="escribe las estadisticas por frame en este fichero")
+    args = parser.parse_args()
+
+    src = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    dump = parse(src)
+    txs = build(dump, args.spi_hz)
+    frames = split_frames(txs)
+    stats = [frame_stats(f, args.spi_hz, args.small) for f in frames]
+    flushes = [s for s in stats if s["marker"]]
+
+    print("%d registros, %d perdidos por la vuelta del anillo, %d flushes" %
+          (len(txs), dump["overwritten"], len(flushes)))
+    print()
+    print("%5s %10s %6s %5s %6s %6s %8s %9s %9s %9s %6s" % ("frame", "inicio us", "trans", "cmd", "vent",
+          "peq", "bytes", "flush us", "cable us", "hueco us", "efic"))
+    for n, s in enumerate(stats):
+        eff = 100 * s["wire_us"] / s["flush_us"] if s["flush_us"] > 0 else 0
+        print("%5s %10.0f %6d %5d %6d %6d %8d %9.1f %9.1f %9.1f %5.0f%%" % (
+            n if s["marker"] else "-", s["start"], s["transactions"], s["commands"], s["windows"],
+            s["small"], s["bytes"], s["flush_us"], s["wire_us"], s["gap_us"], eff))
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("frame,start_us,transactions,commands,windows,small,bytes,flush_us,wire_us,gap_us\n")
+            for n, s in enumerate(stats):
+                f.write("%d,%.1f,%d,%d,%d,%d,%d,%.1f,%.1f,%.1f\n" % (n, s["start"], s["transactions"], s["commands"],
+                        s["windows"], s["small"], s["bytes"], s["flush_us"], s["wire_us"], s["gap_us"]))
+
+    # coste de cada transaccion por encima de su tiempo de cable, por tamano
+    print()
+    print("Transacciones bloqueantes por tamano:")
+    print("%10s %7s %10s %10s %10s" % ("tamano", "n", "total us", "cable us", "extra us"))
+    classes = {}
+    for t in txs:
+        if t.kind != TRACE_WRITE:
+            continue
+        c = classes.setdefault(size_class(t.length), [0, 0.0, 0.0])
+        c[0] += 1
+        c[1] += t.dur
+        c[2] += t.length * 8e6 / args.spi_hz
+    for name in ("1 B", "2-16 B", "17-256 B", ">256 B"):
+        if name in classes:
+            n, total, wire = classes[name]
+            print("%10s %7d %10.1f %10.1f %10.1f" % (name, n, total, wire, total - wire))
+
+    # huecos agrupados por la transaccion que los sigue
+    found = gaps(frames)
+    print()
+    print("Huecos del bus dentro de los flushes:")
+    groups = {}
+    for gap, n, prev, t in found:
+        key = "%s -> %s" % (prev.name() if prev else "inicio", t.name())
+        g = groups.setdefault(key, [0, 0.0, 0.0])
+        g[0] += 1
+        g[1] += gap
+        g[2] = max(g[2], gap)
+    print("%-32s %7s %10s %9s %9s" % ("entre", "n", "total us", "media us", "max us"))
+    for key, (n, total, worst) in sorted(groups.items(), key=lambda kv: -kv[1][1])[:args.top]:
+        print("%-32s %7d %10.1f %9.2f %9.1f" % (key, n, total, total / n, worst))
+
+    print()
+    print("Huecos mas largos:")
+    for gap, n, prev, t in sorted(found, key=lambda g: -g[0])[:args.top]:
+        print("  frame %3d  %8.1f us  %10.0f us  %s -> %s" % (n, gap, t.bus_start,
+              prev.name() if prev else "inicio", t.name()))
+
+    # resumen de lo que se pierde
+    if flushes:
+        flush_us = sum(s["flush_us"] for s in flushes)
+        wire_us = sum(s["wire_us"] for s in flushes)
+        gap_us = sum(s["gap_us"] for s in flushes)
+        small = sum(s["small"] for s in flushes)
+        trans = sum(s["transactions"] for s in flushes)
+        windows = sum(s["windows"] for s in flushes)
+        extra = sum(c[1] - c[2] for name, c in classes.items() if name in ("1 B", "2-16 B"))
+        print()
+        print("Resumen de %d flushes: %.1f us de flush, %.1f us de cable (%.0f%%), %.1f us de bus parado (%.0f%%)" % (
+            len(flushes), flush_us, wire_us, 100 * wire_us / flush_us if flush_us else 0,
+            gap_us, 100 * gap_us / flush_us if flush_us else 0))
+        print("  %.1f ventanas y %.1f transacciones por flush, %d de %d de %d bytes o menos" % (
+            windows / len(flushes), trans / len(flushes), small, trans, args.small))
+        print("  las transacciones de 16 bytes o menos cuestan %.1f us por encima de su tiempo de cable" % extra)
+
+
+if __name__ == "__main__":
+    main()